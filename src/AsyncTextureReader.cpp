@@ -0,0 +1,47 @@
+#include "AsyncTextureReader.h"
+
+
+//--------------------------------------------------------------
+void AsyncTextureReader::allocate(int _width, int _height, int _numBuffers) {
+    width = _width;
+    height = _height;
+    fbo.allocate(width, height, GL_RGBA32F);
+    buffers.resize(max(_numBuffers, 2));
+    for (ofBufferObject& buffer : buffers)
+        buffer.allocate((size_t)width * height * 4 * sizeof(float), GL_STREAM_READ);
+    pixels.allocate(width, height, 4);
+    nextBuffer = 0;
+    numInFlight = 0;
+}
+
+//--------------------------------------------------------------
+const float* AsyncTextureReader::read(ofTexture& _texture) {
+    if (buffers.empty())
+        return nullptr;
+
+    // blending would scale the values by alpha
+    ofPushStyle();
+    ofEnableBlendMode(OF_BLENDMODE_DISABLED);
+    fbo.begin();
+    ofClear(0, 0);
+    ofSetColor(255);
+    _texture.draw(0, 0, width, height);
+    fbo.end();
+    ofPopStyle();
+
+    fbo.getTexture().copyTo(buffers[nextBuffer]);
+    nextBuffer = (nextBuffer + 1) % buffers.size();
+    if (numInFlight < (int)buffers.size()) {
+        numInFlight++;
+        if (numInFlight < (int)buffers.size())
+            return nullptr;
+    }
+
+    // the next one to be written is the oldest
+    ofBufferObject& oldest = buffers[nextBuffer];
+    const float* data = oldest.map<float>(GL_READ_ONLY);
+    if (data)
+        memcpy(pixels.getData(), data, pixels.getTotalBytes());
+    oldest.unmap();
+    return pixels.getData();
+}
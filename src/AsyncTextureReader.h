@@ -0,0 +1,29 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Reads textures back to the CPU as RGBA floats at a fixed size, like
+// TextureReader, without waiting for the GPU. Each read() draws the texture
+// into a float buffer and starts copying it into one of a ring of pixel
+// buffers; what comes back is the read from a full ring ago, long finished
+// by then.
+class AsyncTextureReader {
+public:
+    AsyncTextureReader() : width(0), height(0), nextBuffer(0), numInFlight(0) {}
+
+    void			allocate(int _width, int _height, int _numBuffers = 3);
+    const float*	read(ofTexture& _texture);		// numBuffers - 1 reads old, null until the ring is full; valid until the next read
+
+    int				getWidth() const		{ return width; }
+    int				getHeight() const		{ return height; }
+    int				getLatency() const		{ return buffers.size() - 1; }		// in reads
+
+protected:
+    int				width;
+    int				height;
+    ofFbo			fbo;
+    vector<ofBufferObject> buffers;
+    int				nextBuffer;
+    int				numInFlight;
+    ofFloatPixels	pixels;
+};
@@ -0,0 +1,286 @@
+#include "BlobFinder.h"
+
+
+//--------------------------------------------------------------
+BlobFinder::BlobFinder() {
+    minArea = 0;
+    maxArea = numeric_limits<int>::max();
+    maxDistance = 64;
+    persistence = 15;
+    bTraceContours = false;
+    nextId = 1;
+}
+
+//--------------------------------------------------------------
+void BlobFinder::reset() {
+    tracks.clear();
+    blobs.clear();
+}
+
+//--------------------------------------------------------------
+void BlobFinder::update(const ofPixels& _mask, const ofShortPixels* _depth) {
+    int width = _mask.getWidth();
+    int height = _mask.getHeight();
+    int channels = _mask.getNumChannels();
+    const unsigned char* mask = _mask.getData();
+    if (_depth && ((int)_depth->getWidth() != width || (int)_depth->getHeight() != height))
+        _depth = nullptr;
+
+    runs.clear();
+    regions.clear();
+    int previousBegin = 0;
+    int previousEnd = 0;
+    for (int y=0; y<height; y++) {
+        const unsigned char* row = mask + (size_t)y * width * channels;
+        const unsigned short* depthRow = _depth ? _depth->getData() + (size_t)y * width : nullptr;
+        int rowBegin = runs.size();
+        int previous = previousBegin;
+        int x = 0;
+        while (x < width) {
+            while (x < width && row[x * channels] < 128)
+                x++;
+            if (x == width)
+                break;
+            int x0 = x;
+            while (x < width && row[x * channels] >= 128)
+                x++;
+
+            // runs of the row above touching this one, diagonals included
+            while (previous < previousEnd && runs[previous].x1 < x0)
+                previous++;
+            int label = -1;
+            for (int i=previous; i<previousEnd && runs[i].x0 <= x; i++) {
+                if (label < 0)
+                    label = findRoot(runs[i].label);
+                else
+                    join(label, runs[i].label);
+            }
+            if (label < 0)
+                label = newRegion(x0, y);
+
+            addRun(regions[label], x0, x, y, depthRow);
+            Run run = { x0, x, label };
+            runs.push_back(run);
+        }
+        previousBegin = rowBegin;
+        previousEnd = runs.size();
+    }
+
+    // roots have the lowest label of their region, which is also where it starts in scan order
+    for (int i=0; i<(int)regions.size(); i++) {
+        int root = findRoot(i);
+        if (root != i)
+            merge(regions[root], regions[i]);
+    }
+
+    blobs.clear();
+    for (int i=0; i<(int)regions.size(); i++) {
+        const Region& region = regions[i];
+        if (region.parent != i || region.area < minArea || region.area > maxArea)
+            continue;
+        Blob blob;
+        blob.area = region.area;
+        blob.centroid.set(region.sumX / region.area, region.sumY / region.area);
+        blob.bounds.set(region.minX, region.minY, region.maxX - region.minX + 1, region.maxY - region.minY + 1);
+        blob.startX = region.startX;
+        blob.startY = region.startY;
+        if (region.numDepth > 0) {
+            blob.minDepth = region.minDepth;
+            blob.maxDepth = region.maxDepth;
+            blob.meanDepth = region.sumDepth / region.numDepth;
+        }
+        blobs.push_back(blob);
+    }
+
+    track();
+
+    if (bTraceContours) {
+        for (Blob& blob : blobs)
+            traceContour(_mask, blob.startX, blob.startY, blob.contour);
+    }
+}
+
+//--------------------------------------------------------------
+int BlobFinder::newRegion(int _x, int _y) {
+    Region region;
+    region.parent = regions.size();
+    region.area = 0;
+    region.sumX = 0;
+    region.sumY = 0;
+    region.minX = _x;
+    region.minY = _y;
+    region.maxX = _x;
+    region.maxY = _y;
+    region.startX = _x;
+    region.startY = _y;
+    region.numDepth = 0;
+    region.sumDepth = 0;
+    region.minDepth = numeric_limits<int>::max();
+    region.maxDepth = 0;
+    regions.push_back(region);
+    return region.parent;
+}
+
+//--------------------------------------------------------------
+int BlobFinder::findRoot(int _label) {
+    while (regions[_label].parent != _label) {
+        regions[_label].parent = regions[regions[_label].parent].parent;	// path halving
+        _label = regions[_label].parent;
+    }
+    return _label;
+}
+
+//--------------------------------------------------------------
+void BlobFinder::join(int _a, int _b) {
+    int rootA = findRoot(_a);
+    int rootB = findRoot(_b);
+    if (rootA < rootB)
+        regions[rootB].parent = rootA;
+    else if (rootB < rootA)
+        regions[rootA].parent = rootB;
+}
+
+//--------------------------------------------------------------
+void BlobFinder::addRun(Region& _region, int _x0, int _x1, int _y, const unsigned short* _depthRow) {
+    int length = _x1 - _x0;
+    _region.area += length;
+    _region.sumX += (_x0 + _x1 - 1) * 0.5 * length;
+    _region.sumY += (double)_y * length;
+    _region.minX = min(_region.minX, _x0);
+    _region.maxX = max(_region.maxX, _x1 - 1);
+    _region.maxY = _y;
+    if (!_depthRow)
+        return;
+    for (int x=_x0; x<_x1; x++) {
+        int depth = _depthRow[x];
+        if (depth == 0)
+            continue;
+        _region.numDepth++;
+        _region.sumDepth += depth;
+        _region.minDepth = min(_region.minDepth, depth);
+        _region.maxDepth = max(_region.maxDepth, depth);
+    }
+}
+
+//--------------------------------------------------------------
+void BlobFinder::merge(Region& _root, const Region& _region) {
+    _root.area += _region.area;
+    _root.sumX += _region.sumX;
+    _root.sumY += _region.sumY;
+    _root.minX = min(_root.minX, _region.minX);
+    _root.minY = min(_root.minY, _region.minY);
+    _root.maxX = max(_root.maxX, _region.maxX);
+    _root.maxY = max(_root.maxY, _region.maxY);
+    _root.numDepth += _region.numDepth;
+    _root.sumDepth += _region.sumDepth;
+    _root.minDepth = min(_root.minDepth, _region.minDepth);
+    _root.maxDepth = max(_root.maxDepth, _region.maxDepth);
+}
+
+//--------------------------------------------------------------
+void BlobFinder::track() {
+    // closest pairs first, against where each track would be by now
+    struct Match {
+        float	distance;
+        int		blob;
+        int		track;
+        bool	operator<(const Match& _other) const	{ return distance < _other.distance; }
+    };
+    vector<Match> matches;
+    for (int i=0; i<(int)blobs.size(); i++) {
+        for (int j=0; j<(int)tracks.size(); j++) {
+            const Blob& tracked = tracks[j].blob;
+            ofVec2f predicted = tracked.centroid + tracked.velocity * (tracks[j].framesMissing + 1);
+            float distance = blobs[i].centroid.distance(predicted);
+            if (distance <= maxDistance) {
+                Match match = { distance, i, j };
+                matches.push_back(match);
+            }
+        }
+    }
+    sort(matches.begin(), matches.end());
+
+    vector<bool> isBlobMatched(blobs.size(), false);
+    vector<bool> isTrackMatched(tracks.size(), false);
+    for (const Match& match : matches) {
+        if (isBlobMatched[match.blob] || isTrackMatched[match.track])
+            continue;
+        isBlobMatched[match.blob] = true;
+        isTrackMatched[match.track] = true;
+
+        Blob& blob = blobs[match.blob];
+        const Track& track = tracks[match.track];
+        ofVec2f velocity = (blob.centroid - track.blob.centroid) / (track.framesMissing + 1);
+        blob.id = track.blob.id;
+        blob.age = track.blob.age + 1;
+        blob.velocity = track.blob.age > 0 ? (track.blob.velocity + velocity) * 0.5 : velocity;
+    }
+
+    vector<Track> current;
+    current.reserve(blobs.size() + tracks.size());
+    for (int i=0; i<(int)blobs.size(); i++) {
+        if (!isBlobMatched[i])
+            blobs[i].id = nextId++;
+        Track track = { blobs[i], 0 };
+        current.push_back(track);
+    }
+    for (int j=0; j<(int)tracks.size(); j++) {
+        if (isTrackMatched[j] || tracks[j].framesMissing >= persistence)
+            continue;
+        current.push_back(tracks[j]);
+        current.back().framesMissing++;
+    }
+    tracks.swap(current);
+}
+
+//--------------------------------------------------------------
+void BlobFinder::traceContour(const ofPixels& _mask, int _startX, int _startY, ofPolyline& _contour) {
+    // counterclockwise on screen, starting east
+    static const int dx[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+    static const int dy[8] = { 0, -1, -1, -1, 0, 1, 1, 1 };
+
+    int width = _mask.getWidth();
+    int height = _mask.getHeight();
+    int channels = _mask.getNumChannels();
+    const unsigned char* mask = _mask.getData();
+    auto isInside = [&](int _x, int _y) {
+        return _x >= 0 && _y >= 0 && _x < width && _y < height && mask[((size_t)_y * width + _x) * channels] >= 128;
+    };
+
+    // the start has nothing above it or to its left, so the walk goes around the outside (chain code boundary following);
+    // it ends when it leaves the start the same way a second time
+    _contour.clear();
+    int x = _startX;
+    int y = _startY;
+    int direction = 7;
+    int firstDirection = -1;
+    size_t maxSteps = (size_t)width * height * 2 + 8;
+    for (size_t step=0; step<maxSteps; step++) {
+        int search = direction % 2 == 0 ? (direction + 7) % 8 : (direction + 6) % 8;
+        int next = -1;
+        for (int i=0; i<8; i++) {
+            int candidate = (search + i) % 8;
+            if (isInside(x + dx[candidate], y + dy[candidate])) {
+                next = candidate;
+                break;
+            }
+        }
+        if (next < 0) {
+            _contour.addVertex(x, y);	// a single pixel
+            break;
+        }
+        if (x == _startX && y == _startY) {
+            if (firstDirection < 0)
+                firstDirection = next;
+            else if (next == firstDirection)
+                break;
+        }
+        // only the corners, straight runs are implied
+        if (step == 0 || next != direction)
+            _contour.addVertex(x, y);
+        x += dx[next];
+        y += dy[next];
+        direction = next;
+    }
+    _contour.close();
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "ofMain.h"
+
+// A connected region of the band mask
+struct Blob {
+    Blob() : id(0), age(0), area(0), startX(0), startY(0), minDepth(0), maxDepth(0), meanDepth(0) {}
+
+    unsigned int	id;			// kept while the blob is tracked, never 0
+    int				age;		// frames tracked
+    int				area;		// pixels
+    ofVec2f			centroid;	// pixels
+    ofRectangle		bounds;
+    ofVec2f			velocity;	// of the centroid, pixels per frame, smoothed
+    int				startX;		// first pixel in scan order, on the outer boundary
+    int				startY;
+    float			minDepth;	// millimetres, of the pixels with a reading; 0 if none has one
+    float			maxDepth;
+    float			meanDepth;
+    ofPolyline		contour;	// outer boundary, empty unless traced
+};
+
+// Labels the 8-connected regions of a binary mask and measures them in a
+// single pass over the frame. The mask is scanned as runs; every run joins
+// the runs it touches on the row above through union-find and carries its
+// pixel count, coordinate sums, bounds and depth statistics, which are
+// folded into the root of each region once the frame is done. No label
+// image is written.
+//
+// Blobs are matched to those of the last frames by centroid distance, so
+// each keeps its id, age and velocity while it is tracked; a blob missing
+// for a few frames keeps its id if it shows up again near where it was.
+// Contours cost a trace along each boundary and are only made when asked for.
+class BlobFinder {
+public:
+    BlobFinder();
+
+    void			setAreaRange(int _minArea, int _maxArea)		{ minArea = _minArea; maxArea = _maxArea; }		// pixels
+    void			setTracking(float _maxDistance, int _persistence)	{ maxDistance = _maxDistance; persistence = _persistence; }
+    void			setTraceContours(bool _value)					{ bTraceContours = _value; }
+    void			reset();		// forgets the tracked blobs
+
+    // _depth is optional, in millimetres and the size of the mask
+    void			update(const ofPixels& _mask, const ofShortPixels* _depth = nullptr);
+
+    const vector<Blob>&	getBlobs() const		{ return blobs; }
+    int				getNumRuns() const			{ return runs.size(); }
+
+    static void		traceContour(const ofPixels& _mask, int _startX, int _startY, ofPolyline& _contour);
+
+protected:
+    struct Run {
+        int			x0;
+        int			x1;			// exclusive
+        int			label;
+    };
+
+    // sums of one provisional label, merged into its root at the end of the frame
+    struct Region {
+        int			parent;
+        int			area;
+        double		sumX;
+        double		sumY;
+        int			minX;
+        int			minY;
+        int			maxX;
+        int			maxY;
+        int			startX;
+        int			startY;
+        int			numDepth;
+        double		sumDepth;
+        int			minDepth;
+        int			maxDepth;
+    };
+
+    int				newRegion(int _x, int _y);
+    int				findRoot(int _label);
+    void			join(int _a, int _b);
+    void			addRun(Region& _region, int _x0, int _x1, int _y, const unsigned short* _depthRow);
+    void			merge(Region& _root, const Region& _region);
+    void			track();
+
+    int				minArea;
+    int				maxArea;
+    float			maxDistance;
+    int				persistence;
+    bool			bTraceContours;
+
+    vector<Run>		runs;
+    vector<Region>	regions;
+    vector<Blob>	blobs;
+
+    struct Track {
+        Blob		blob;
+        int			framesMissing;
+    };
+    vector<Track>	tracks;
+    unsigned int	nextId;
+};
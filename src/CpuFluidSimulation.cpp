@@ -0,0 +1,208 @@
+#include "CpuFluidSimulation.h"
+
+
+//--------------------------------------------------------------
+CpuFluidSimulation::CpuFluidSimulation(ThreadPool* _pool) {
+    width = 0;
+    height = 0;
+    solver.setThreadPool(_pool);
+    for (int i=0; i<NUM_OUTPUTS; i++)
+        bOutputDirty[i] = true;
+
+    // same names and ranges as ftFluidSimulation, so saved settings carry over
+    CpuFluidSettings defaults;
+    parameters.setName("fluid solver");
+    parameters.add(speed.set("speed", defaults.speed, 0, 1));
+    parameters.add(cellSize.set("cell size", defaults.cellSize, 0.0, 2.0));
+    parameters.add(numJacobiIterations.set("iterations", defaults.numJacobiIterations, 1, 100));
+    parameters.add(viscosity.set("viscosity", defaults.viscosity, 0, 1));
+    parameters.add(vorticity.set("vorticity", defaults.vorticity, 0.0, 1));
+    parameters.add(dissipation.set("dissipation", defaults.dissipation, 0, 0.02));
+    advancedDissipationParameters.setName("advanced dissipation");
+    advancedDissipationParameters.add(velocityOffset.set("velocity offset", defaults.dissipationVelocityOffset, -0.01, 0.01));
+    advancedDissipationParameters.add(densityOffset.set("density offset", defaults.dissipationDensityOffset, -0.01, 0.01));
+    advancedDissipationParameters.add(temperatureOffset.set("temperature offset", defaults.dissipationTemperatureOffset, -0.01, 0.01));
+    parameters.add(advancedDissipationParameters);
+    smokeBuoyancyParameters.setName("smoke buoyancy");
+    smokeBuoyancyParameters.add(sigma.set("buoyancy", defaults.smokeSigma, 0.0, 1.0));
+    smokeBuoyancyParameters.add(weight.set("weight", defaults.smokeWeight, 0.0, 1.0));
+    smokeBuoyancyParameters.add(ambientTemperature.set("ambient temperature", defaults.ambientTemperature, 0.0, 1.0));
+    smokeBuoyancyParameters.add(gravity.set("gravity", ofVec2f(defaults.gravityX, defaults.gravityY), ofVec2f(-10, -10), ofVec2f(10, 10)));
+    parameters.add(smokeBuoyancyParameters);
+    maxValues.setName("maximum");
+    maxValues.add(maxVelocity.set("velocity", defaults.maxVelocity, 0, 10));
+    maxValues.add(maxDensity.set("density", defaults.maxDensity, 0, 5));
+    maxValues.add(maxTemperature.set("temperature", defaults.maxTemperature, 0, 5));
+    parameters.add(maxValues);
+}
+
+//--------------------------------------------------------------
+void CpuFluidSimulation::setup(int _simulationWidth, int _simulationHeight, int _densityWidth, int _densityHeight, const FieldPrecision& _precision) {
+    width = _simulationWidth;
+    height = _simulationHeight;
+    solver.setup(width, height);
+
+    reader.allocate(width, height);
+    // the solver always runs in floats, only what it hands to the shaders is stored as asked
+    outputs[OUTPUT_VELOCITY].allocate(width, height, FieldPrecision::getInternalFormat(_precision.velocity, 2));
+    outputs[OUTPUT_DENSITY].allocate(width, height, FieldPrecision::getInternalFormat(_precision.density, 4));
+    outputs[OUTPUT_PRESSURE].allocate(width, height, FieldPrecision::getInternalFormat(_precision.scalars, 1));
+    outputs[OUTPUT_TEMPERATURE].allocate(width, height, FieldPrecision::getInternalFormat(_precision.scalars, 1));
+    outputs[OUTPUT_DIVERGENCE].allocate(width, height, FieldPrecision::getInternalFormat(_precision.scalars, 1));
+    outputs[OUTPUT_OBSTACLE].allocate(width, height, GL_R32F);
+    outputs[OUTPUT_CONFINEMENT].allocate(width, height, FieldPrecision::getInternalFormat(_precision.velocity, 2));
+    outputs[OUTPUT_BUOYANCY].allocate(width, height, FieldPrecision::getInternalFormat(_precision.velocity, 2));
+    uploadBuffer.resize(width * height * 4);
+    reset();
+}
+
+//--------------------------------------------------------------
+void CpuFluidSimulation::reset() {
+    solver.reset();
+    for (int i=0; i<NUM_OUTPUTS; i++)
+        bOutputDirty[i] = true;
+}
+
+//--------------------------------------------------------------
+void CpuFluidSimulation::applySettings() {
+    CpuFluidSettings& settings = solver.settings;
+    settings.speed = speed;
+    settings.cellSize = cellSize;
+    settings.numJacobiIterations = numJacobiIterations;
+    settings.viscosity = viscosity;
+    settings.vorticity = vorticity;
+    settings.dissipation = dissipation;
+    settings.dissipationVelocityOffset = velocityOffset;
+    settings.dissipationDensityOffset = densityOffset;
+    settings.dissipationTemperatureOffset = temperatureOffset;
+    settings.smokeSigma = sigma;
+    settings.smokeWeight = weight;
+    settings.ambientTemperature = ambientTemperature;
+    settings.gravityX = gravity->x;
+    settings.gravityY = gravity->y;
+    settings.maxVelocity = maxVelocity;
+    settings.maxDensity = maxDensity;
+    settings.maxTemperature = maxTemperature;
+}
+
+//--------------------------------------------------------------
+void CpuFluidSimulation::update(float _deltaTime) {
+    if (_deltaTime <= 0)
+        _deltaTime = ofGetLastFrameTime();
+    applySettings();
+    solver.update(_deltaTime);
+    for (int i=0; i<NUM_OUTPUTS; i++)
+        bOutputDirty[i] = true;
+}
+
+//--------------------------------------------------------------
+void CpuFluidSimulation::addVelocity(ofTexture& _texture, float _strength) {
+    solver.addVelocity(reader.read(_texture), 4, _strength);
+    bOutputDirty[OUTPUT_VELOCITY] = true;
+}
+
+//--------------------------------------------------------------
+void CpuFluidSimulation::addDensity(ofTexture& _texture, float _strength) {
+    solver.addDensity(reader.read(_texture), 4, _strength);
+    bOutputDirty[OUTPUT_DENSITY] = true;
+}
+
+//--------------------------------------------------------------
+void CpuFluidSimulation::addTemperature(ofTexture& _texture, float _strength) {
+    solver.addTemperature(reader.read(_texture), 4, _strength);
+    bOutputDirty[OUTPUT_TEMPERATURE] = true;
+}
+
+//--------------------------------------------------------------
+void CpuFluidSimulation::addPressure(ofTexture& _texture, float _strength) {
+    solver.addPressure(reader.read(_texture), 4, _strength);
+    bOutputDirty[OUTPUT_PRESSURE] = true;
+}
+
+//--------------------------------------------------------------
+void CpuFluidSimulation::addObstacle(ofTexture& _texture) {
+    solver.addObstacle(reader.read(_texture), 4);
+    bOutputDirty[OUTPUT_OBSTACLE] = true;
+}
+
+//--------------------------------------------------------------
+void CpuFluidSimulation::addTempObstacle(ofTexture& _texture) {
+    solver.addTempObstacle(reader.read(_texture), 4);
+}
+
+//--------------------------------------------------------------
+void CpuFluidSimulation::setDynamicObstacle(const ofPixels& _pixels, const vector<ofRectangle>& _dirtyTiles) {
+    // straight from the pixels, nothing to read back
+    if ((int)_pixels.getWidth() != width || (int)_pixels.getHeight() != height || _pixels.getNumChannels() != 1)
+        return;
+    for (const ofRectangle& tile : _dirtyTiles)
+        solver.setDynamicObstacle(_pixels.getData(), tile.x, tile.y, tile.width, tile.height);
+    if (!_dirtyTiles.empty())
+        bOutputDirty[OUTPUT_OBSTACLE] = true;
+}
+
+//--------------------------------------------------------------
+void CpuFluidSimulation::upload(ofTexture& _texture, const float* const* _fields, int _numFields) {
+    size_t size = (size_t)width * height;
+    float* dst = uploadBuffer.data();
+    for (size_t i=0; i<size; i++) {
+        for (int f=0; f<_numFields; f++)
+            *dst++ = _fields[f][i];
+    }
+    GLint format = _numFields == 1 ? GL_RED : _numFields == 2 ? GL_RG : GL_RGBA;
+    _texture.loadData(uploadBuffer.data(), width, height, format);
+}
+
+//--------------------------------------------------------------
+ofTexture& CpuFluidSimulation::getOutput(int _output) {
+    ofTexture& texture = outputs[_output];
+    if (!bOutputDirty[_output])
+        return texture;
+    bOutputDirty[_output] = false;
+
+    const float* fields[4];
+    switch (_output) {
+        case OUTPUT_VELOCITY:
+            fields[0] = solver.getVelocityX();
+            fields[1] = solver.getVelocityY();
+            upload(texture, fields, 2);
+            break;
+        case OUTPUT_DENSITY:
+            for (int c=0; c<4; c++)
+                fields[c] = solver.getDensity(c);
+            upload(texture, fields, 4);
+            break;
+        case OUTPUT_PRESSURE:
+            fields[0] = solver.getPressure();
+            upload(texture, fields, 1);
+            break;
+        case OUTPUT_TEMPERATURE:
+            fields[0] = solver.getTemperature();
+            upload(texture, fields, 1);
+            break;
+        case OUTPUT_DIVERGENCE:
+            fields[0] = solver.getDivergence();
+            upload(texture, fields, 1);
+            break;
+        case OUTPUT_OBSTACLE:
+            fields[0] = solver.getObstacle();
+            upload(texture, fields, 1);
+            break;
+        case OUTPUT_CONFINEMENT:
+            fields[0] = solver.getConfinementX();
+            fields[1] = solver.getConfinementY();
+            upload(texture, fields, 2);
+            break;
+        case OUTPUT_BUOYANCY:
+            fields[0] = solver.getBuoyancyX();
+            fields[1] = solver.getBuoyancyY();
+            upload(texture, fields, 2);
+            break;
+    }
+    return texture;
+}
+
+//--------------------------------------------------------------
+void CpuFluidSimulation::draw(int _x, int _y, float _width, float _height) {
+    getDensity().draw(_x, _y, _width, _height);
+}
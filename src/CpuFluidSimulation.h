@@ -0,0 +1,93 @@
+#pragma once
+
+#include "ofMain.h"
+#include "FluidSimulation.h"
+#include "CpuFluidSolver.h"
+#include "TextureReader.h"
+
+// CpuFluidSolver behind the FluidSimulation interface. Input textures are
+// read back at the simulation size, outputs are uploaded when a texture is
+// asked for, at most once per update.
+// Density runs at the simulation size rather than the density size.
+class CpuFluidSimulation : public FluidSimulation {
+public:
+    CpuFluidSimulation(ThreadPool* _pool = nullptr);
+
+    void	setup(int _simulationWidth, int _simulationHeight, int _densityWidth, int _densityHeight, const FieldPrecision& _precision);
+    void	update(float _deltaTime = 0);
+    void	draw(int _x, int _y, float _width, float _height);
+    void	reset();
+    string	getName() const				{ return "cpu"; }
+
+    void	addVelocity(ofTexture& _texture, float _strength = 1.0);
+    void	addDensity(ofTexture& _texture, float _strength = 1.0);
+    void	addTemperature(ofTexture& _texture, float _strength = 1.0);
+    void	addPressure(ofTexture& _texture, float _strength = 1.0);
+    void	addObstacle(ofTexture& _texture);
+    void	addTempObstacle(ofTexture& _texture);
+    void	setDynamicObstacle(const ofPixels& _pixels, const vector<ofRectangle>& _dirtyTiles);
+
+    ofTexture&	getVelocity()			{ return getOutput(OUTPUT_VELOCITY); }
+    ofTexture&	getDensity()			{ return getOutput(OUTPUT_DENSITY); }
+    ofTexture&	getPressure()			{ return getOutput(OUTPUT_PRESSURE); }
+    ofTexture&	getTemperature()		{ return getOutput(OUTPUT_TEMPERATURE); }
+    ofTexture&	getDivergence()			{ return getOutput(OUTPUT_DIVERGENCE); }
+    ofTexture&	getObstacle()			{ return getOutput(OUTPUT_OBSTACLE); }
+    ofTexture&	getConfinement()		{ return getOutput(OUTPUT_CONFINEMENT); }
+    ofTexture&	getSmokeBuoyancy()		{ return getOutput(OUTPUT_BUOYANCY); }
+
+    float	getSpeed()						{ return speed; }
+    float	getCellSize()					{ return cellSize; }
+    ofParameter<int>& getIterations()		{ return numJacobiIterations; }
+    ofParameterGroup& getParameters()		{ return parameters; }
+
+    CpuFluidSolver&	getSolver()				{ return solver; }
+
+    ofParameterGroup	parameters;
+    ofParameter<float>	speed;
+    ofParameter<float>	cellSize;
+    ofParameter<int>	numJacobiIterations;
+    ofParameter<float>	viscosity;
+    ofParameter<float>	vorticity;
+    ofParameter<float>	dissipation;
+    ofParameterGroup	advancedDissipationParameters;
+    ofParameter<float>	velocityOffset;
+    ofParameter<float>	densityOffset;
+    ofParameter<float>	temperatureOffset;
+    ofParameterGroup	smokeBuoyancyParameters;
+    ofParameter<float>	sigma;
+    ofParameter<float>	weight;
+    ofParameter<float>	ambientTemperature;
+    ofParameter<ofVec2f> gravity;
+    ofParameterGroup	maxValues;
+    ofParameter<float>	maxVelocity;
+    ofParameter<float>	maxDensity;
+    ofParameter<float>	maxTemperature;
+
+protected:
+    enum outputEnum {
+        OUTPUT_VELOCITY = 0,
+        OUTPUT_DENSITY,
+        OUTPUT_PRESSURE,
+        OUTPUT_TEMPERATURE,
+        OUTPUT_DIVERGENCE,
+        OUTPUT_OBSTACLE,
+        OUTPUT_CONFINEMENT,
+        OUTPUT_BUOYANCY,
+        NUM_OUTPUTS
+    };
+
+    void			applySettings();
+    ofTexture&		getOutput(int _output);
+    void			upload(ofTexture& _texture, const float* const* _fields, int _numFields);
+
+    CpuFluidSolver	solver;
+    int				width;
+    int				height;
+
+    TextureReader	reader;
+
+    ofTexture		outputs[NUM_OUTPUTS];
+    bool			bOutputDirty[NUM_OUTPUTS];
+    vector<float>	uploadBuffer;		// fields interleaved for upload
+};
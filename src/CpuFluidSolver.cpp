@@ -0,0 +1,541 @@
+#include "CpuFluidSolver.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CPU_FLUID_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+
+//--------------------------------------------------------------
+CpuFluidSettings::CpuFluidSettings() {
+    speed = 0.3;
+    cellSize = 1.25;
+    numJacobiIterations = 40;
+    viscosity = 0.1;
+    vorticity = 0.1;
+    dissipation = 0.01;
+    dissipationVelocityOffset = 0;
+    dissipationDensityOffset = 0;
+    dissipationTemperatureOffset = 0;
+    smokeSigma = 0.05;
+    smokeWeight = 0.05;
+    ambientTemperature = 0;
+    gravityX = 0;
+    gravityY = -9.80665;
+    maxVelocity = 4;
+    maxDensity = 2;
+    maxTemperature = 2;
+}
+
+//--------------------------------------------------------------
+CpuFluidSolver::CpuFluidSolver() {
+    width = 0;
+    height = 0;
+    pool = nullptr;
+    bTempObstacle = false;
+    numDynamicCells = 0;
+}
+
+//--------------------------------------------------------------
+void CpuFluidSolver::setup(int _width, int _height) {
+    width = max(_width, 3);
+    height = max(_height, 3);
+    dynamicObstacle.clear();
+    reset();
+}
+
+//--------------------------------------------------------------
+void CpuFluidSolver::reset() {
+    size_t size = (size_t)width * height;
+    Field* fields[] = { &velocityX, &velocityY, &density[0], &density[1], &density[2], &density[3], &temperature,
+        &pressure, &divergence, &curl, &confinementX, &confinementY, &buoyancyX, &buoyancyY, &tempObstacle,
+        &tempX, &tempY, &originalX, &originalY };
+    for (Field* field : fields)
+        field->assign(size, 0);
+
+    // the border is a wall
+    obstacle.assign(size, 0);
+    for (int x=0; x<width; x++) {
+        obstacle[x] = 1;
+        obstacle[(height - 1) * width + x] = 1;
+    }
+    for (int y=0; y<height; y++) {
+        obstacle[y * width] = 1;
+        obstacle[y * width + width - 1] = 1;
+    }
+    bTempObstacle = false;
+
+    // the dynamic obstacle is an input the caller keeps up to date, only setup() drops it
+    if (dynamicObstacle.size() != size) {
+        dynamicObstacle.assign(size, 0);
+        numDynamicCells = 0;
+    }
+    combinedObstacle = obstacle;
+    combineObstacles();
+}
+
+//--------------------------------------------------------------
+void CpuFluidSolver::parallelRows(const std::function<void(int)>& _row) {
+    // interior rows only, the border rows never change
+    int numRows = height - 2;
+    if (pool) {
+        pool->parallelFor(numRows, [&](int _begin, int _end) {
+            for (int y=_begin; y<_end; y++)
+                _row(y + 1);
+        }, 4);
+    }
+    else {
+        for (int y=1; y<height - 1; y++)
+            _row(y);
+    }
+}
+
+//--------------------------------------------------------------
+void CpuFluidSolver::clearBorder(Field& _field) {
+    fill(_field.begin(), _field.begin() + width, 0);
+    fill(_field.end() - width, _field.end(), 0);
+    for (int y=1; y<height - 1; y++) {
+        _field[y * width] = 0;
+        _field[y * width + width - 1] = 0;
+    }
+}
+
+//--------------------------------------------------------------
+void CpuFluidSolver::addChannel(Field& _field, const float* _data, int _numChannels, int _channel, float _strength) {
+    if (_channel >= _numChannels)
+        return;
+    const float* src = _data + _channel;
+    float* dst = _field.data();
+    size_t size = _field.size();
+    for (size_t i=0; i<size; i++)
+        dst[i] += src[i * _numChannels] * _strength;
+}
+
+//--------------------------------------------------------------
+void CpuFluidSolver::addVelocity(const float* _data, int _numChannels, float _strength) {
+    addChannel(velocityX, _data, _numChannels, 0, _strength);
+    addChannel(velocityY, _data, _numChannels, 1, _strength);
+}
+
+//--------------------------------------------------------------
+void CpuFluidSolver::addDensity(const float* _data, int _numChannels, float _strength) {
+    for (int c=0; c<4; c++)
+        addChannel(density[c], _data, _numChannels, c, _strength);
+}
+
+//--------------------------------------------------------------
+void CpuFluidSolver::addTemperature(const float* _data, int _numChannels, float _strength) {
+    addChannel(temperature, _data, _numChannels, 0, _strength);
+}
+
+//--------------------------------------------------------------
+void CpuFluidSolver::addPressure(const float* _data, int _numChannels, float _strength) {
+    addChannel(pressure, _data, _numChannels, 0, _strength);
+}
+
+//--------------------------------------------------------------
+void CpuFluidSolver::addObstacle(const float* _data, int _numChannels) {
+    for (size_t i=0; i<obstacle.size(); i++) {
+        if (_data[i * _numChannels] > 0.5)
+            obstacle[i] = 1;
+    }
+    combineObstacles();
+}
+
+//--------------------------------------------------------------
+void CpuFluidSolver::addTempObstacle(const float* _data, int _numChannels) {
+    for (size_t i=0; i<tempObstacle.size(); i++) {
+        if (_data[i * _numChannels] > 0.5)
+            tempObstacle[i] = 1;
+    }
+    bTempObstacle = true;
+}
+
+//--------------------------------------------------------------
+void CpuFluidSolver::setDynamicObstacle(const unsigned char* _data, int _x, int _y, int _width, int _height) {
+    int x0 = max(_x, 0);
+    int y0 = max(_y, 0);
+    int x1 = min(_x + _width, width);
+    int y1 = min(_y + _height, height);
+    for (int y=y0; y<y1; y++) {
+        for (int x=x0; x<x1; x++) {
+            size_t i = (size_t)y * width + x;
+            float value = _data[i] > 127 ? 1 : 0;
+            numDynamicCells += (value != 0) - (dynamicObstacle[i] != 0);
+            dynamicObstacle[i] = value;
+        }
+    }
+    combineObstacles();
+}
+
+//--------------------------------------------------------------
+void CpuFluidSolver::combineObstacles() {
+    if (!bTempObstacle && numDynamicCells == 0) {
+        combinedObstacle = obstacle;
+        return;
+    }
+    for (size_t i=0; i<obstacle.size(); i++)
+        combinedObstacle[i] = max(max(obstacle[i], tempObstacle[i]), dynamicObstacle[i]);
+}
+
+//--------------------------------------------------------------
+void CpuFluidSolver::update(float _deltaTime) {
+    // flowtools scales the step to the grid width, velocities are in cells per step at speed 1
+    float timeStep = _deltaTime * settings.speed * width;
+
+    combineObstacles();
+    clampFields();
+
+    if (settings.vorticity > 0)
+        applyVorticity(timeStep);
+
+    tempX.swap(velocityX);
+    tempY.swap(velocityY);
+    float velocityDissipation = 1.0 - (settings.dissipation + settings.dissipationVelocityOffset);
+    advect(velocityX, tempX, tempX, tempY, timeStep, velocityDissipation);
+    advect(velocityY, tempY, tempX, tempY, timeStep, velocityDissipation);
+
+    if (settings.viscosity > 0)
+        diffuseVelocity(_deltaTime);
+
+    if (settings.smokeSigma > 0 && settings.smokeWeight > 0) {
+        tempX.swap(temperature);
+        advect(temperature, tempX, velocityX, velocityY, timeStep, 1.0 - (settings.dissipation + settings.dissipationTemperatureOffset));
+        applyBuoyancy(_deltaTime);
+    }
+    else {
+        fill(temperature.begin(), temperature.end(), 0);
+        fill(buoyancyX.begin(), buoyancyX.end(), 0);
+        fill(buoyancyY.begin(), buoyancyY.end(), 0);
+    }
+
+    project();
+
+    float densityDissipation = 1.0 - (settings.dissipation + settings.dissipationDensityOffset);
+    for (int c=0; c<4; c++) {
+        tempX.swap(density[c]);
+        advect(density[c], tempX, velocityX, velocityY, timeStep, densityDissipation);
+    }
+
+    if (bTempObstacle) {
+        fill(tempObstacle.begin(), tempObstacle.end(), 0);
+        bTempObstacle = false;
+    }
+}
+
+//--------------------------------------------------------------
+void CpuFluidSolver::clampFields() {
+    const float maxVelocity = settings.maxVelocity;
+    const float maxDensity = settings.maxDensity;
+    const float maxTemperature = settings.maxTemperature;
+    parallelRows([&](int _y) {
+        size_t row = (size_t)_y * width;
+        float* vx = velocityX.data() + row;
+        float* vy = velocityY.data() + row;
+        float* t = temperature.data() + row;
+        for (int x=0; x<width; x++) {
+            if (maxVelocity > 0) {
+                float length2 = vx[x] * vx[x] + vy[x] * vy[x];
+                if (length2 > maxVelocity * maxVelocity) {
+                    float scale = maxVelocity / sqrtf(length2);
+                    vx[x] *= scale;
+                    vy[x] *= scale;
+                }
+            }
+            if (maxTemperature > 0)
+                t[x] = min(max(t[x], -maxTemperature), maxTemperature);
+        }
+        if (maxDensity > 0) {
+            for (int c=0; c<4; c++) {
+                float* d = density[c].data() + row;
+                for (int x=0; x<width; x++)
+                    d[x] = min(max(d[x], 0.0f), maxDensity);
+            }
+        }
+    });
+}
+
+//--------------------------------------------------------------
+void CpuFluidSolver::applyVorticity(float _timeStep) {
+    const float halfrdx = 0.5 / settings.cellSize;
+    const int w = width;
+
+    // curl of the velocity, walls count as still fluid
+    parallelRows([&](int _y) {
+        size_t row = (size_t)_y * w;
+        const float* vx = velocityX.data() + row;
+        const float* vy = velocityY.data() + row;
+        const float* o = combinedObstacle.data() + row;
+        float* c = curl.data() + row;
+        int x = 1;
+#ifdef CPU_FLUID_SSE2
+        const __m128 one = _mm_set1_ps(1);
+        const __m128 h = _mm_set1_ps(halfrdx);
+        for (; x + 4 <= w - 1; x += 4) {
+            __m128 yR = _mm_mul_ps(_mm_loadu_ps(vy + x + 1), _mm_sub_ps(one, _mm_loadu_ps(o + x + 1)));
+            __m128 yL = _mm_mul_ps(_mm_loadu_ps(vy + x - 1), _mm_sub_ps(one, _mm_loadu_ps(o + x - 1)));
+            __m128 xT = _mm_mul_ps(_mm_loadu_ps(vx + x + w), _mm_sub_ps(one, _mm_loadu_ps(o + x + w)));
+            __m128 xB = _mm_mul_ps(_mm_loadu_ps(vx + x - w), _mm_sub_ps(one, _mm_loadu_ps(o + x - w)));
+            _mm_storeu_ps(c + x, _mm_mul_ps(h, _mm_sub_ps(_mm_sub_ps(yR, yL), _mm_sub_ps(xT, xB))));
+        }
+#endif
+        for (; x < w - 1; x++) {
+            float yR = vy[x + 1] * (1 - o[x + 1]);
+            float yL = vy[x - 1] * (1 - o[x - 1]);
+            float xT = vx[x + w] * (1 - o[x + w]);
+            float xB = vx[x - w] * (1 - o[x - w]);
+            c[x] = halfrdx * ((yR - yL) - (xT - xB));
+        }
+    });
+
+    // push along the gradient of the curl magnitude, towards the vortex centres
+    const float scale = _timeStep * settings.vorticity;
+    parallelRows([&](int _y) {
+        size_t row = (size_t)_y * w;
+        const float* c = curl.data() + row;
+        const float* o = combinedObstacle.data() + row;
+        float* fx = confinementX.data() + row;
+        float* fy = confinementY.data() + row;
+        float* vx = velocityX.data() + row;
+        float* vy = velocityY.data() + row;
+        for (int x=1; x<w - 1; x++) {
+            float gx = halfrdx * (fabsf(c[x + w]) - fabsf(c[x - w]));
+            float gy = halfrdx * (fabsf(c[x + 1]) - fabsf(c[x - 1]));
+            float length = sqrtf(gx * gx + gy * gy);
+            float f = length > 1e-5f && o[x] < 0.5f ? scale * c[x] / length : 0;
+            fx[x] = gx * f;
+            fy[x] = -gy * f;
+            vx[x] += fx[x];
+            vy[x] += fy[x];
+        }
+    });
+}
+
+//--------------------------------------------------------------
+void CpuFluidSolver::advect(Field& _dst, const Field& _src, const Field& _velocityX, const Field& _velocityY, float _timeStep, float _dissipation) {
+    // trace back along the velocity and sample bilinearly, the gathers don't vectorize
+    const float k = _timeStep / settings.cellSize;
+    const int w = width;
+    clearBorder(_dst);
+    const float maxX = width - 1.001f;
+    const float maxY = height - 1.001f;
+    parallelRows([&](int _y) {
+        size_t row = (size_t)_y * w;
+        const float* vx = _velocityX.data() + row;
+        const float* vy = _velocityY.data() + row;
+        const float* o = combinedObstacle.data() + row;
+        const float* src = _src.data();
+        float* dst = _dst.data() + row;
+        for (int x=1; x<w - 1; x++) {
+            if (o[x] > 0.99f) {
+                dst[x] = 0;
+                continue;
+            }
+            float px = min(max(x - k * vx[x], 0.0f), maxX);
+            float py = min(max(_y - k * vy[x], 0.0f), maxY);
+            int x0 = (int)px;
+            int y0 = (int)py;
+            float fx = px - x0;
+            float fy = py - y0;
+            const float* s = src + (size_t)y0 * w + x0;
+            float top = s[0] + (s[1] - s[0]) * fx;
+            float bottom = s[w] + (s[w + 1] - s[w]) * fx;
+            dst[x] = _dissipation * (top + (bottom - top) * fy);
+        }
+    });
+}
+
+//--------------------------------------------------------------
+void CpuFluidSolver::diffuseVelocity(float _deltaTime) {
+    // implicit viscosity, Jacobi iterations towards (I - nu dt laplacian) v = v0
+    const float alpha = settings.cellSize * settings.cellSize / (settings.viscosity * max(_deltaTime, 1e-4f));
+    const float rBeta = 1.0 / (4.0 + alpha);
+    const int w = width;
+    originalX = velocityX;
+    originalY = velocityY;
+
+    for (int i=0; i<settings.numJacobiIterations; i++) {
+        parallelRows([&](int _y) {
+            size_t row = (size_t)_y * w;
+            const float* o = combinedObstacle.data() + row;
+            for (int component=0; component<2; component++) {
+                const float* v = (component == 0 ? velocityX : velocityY).data() + row;
+                const float* v0 = (component == 0 ? originalX : originalY).data() + row;
+                float* dst = (component == 0 ? tempX : tempY).data() + row;
+                int x = 1;
+#ifdef CPU_FLUID_SSE2
+                const __m128 one = _mm_set1_ps(1);
+                const __m128 a = _mm_set1_ps(alpha);
+                const __m128 r = _mm_set1_ps(rBeta);
+                for (; x + 4 <= w - 1; x += 4) {
+                    __m128 sum = _mm_mul_ps(_mm_loadu_ps(v + x - 1), _mm_sub_ps(one, _mm_loadu_ps(o + x - 1)));
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(v + x + 1), _mm_sub_ps(one, _mm_loadu_ps(o + x + 1))));
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(v + x - w), _mm_sub_ps(one, _mm_loadu_ps(o + x - w))));
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(v + x + w), _mm_sub_ps(one, _mm_loadu_ps(o + x + w))));
+                    sum = _mm_add_ps(sum, _mm_mul_ps(a, _mm_loadu_ps(v0 + x)));
+                    _mm_storeu_ps(dst + x, _mm_mul_ps(sum, r));
+                }
+#endif
+                for (; x < w - 1; x++) {
+                    float sum = v[x - 1] * (1 - o[x - 1]) + v[x + 1] * (1 - o[x + 1]) +
+                                v[x - w] * (1 - o[x - w]) + v[x + w] * (1 - o[x + w]);
+                    dst[x] = (sum + alpha * v0[x]) * rBeta;
+                }
+            }
+        });
+        velocityX.swap(tempX);
+        velocityY.swap(tempY);
+    }
+}
+
+//--------------------------------------------------------------
+void CpuFluidSolver::applyBuoyancy(float _deltaTime) {
+    // warm smoke rises against gravity, dense smoke sinks with it
+    const float scale = _deltaTime * settings.speed;
+    const float ambient = settings.ambientTemperature;
+    const float sigma = settings.smokeSigma;
+    const float weight = settings.smokeWeight;
+    const float gx = settings.gravityX;
+    const float gy = settings.gravityY;
+    parallelRows([&](int _y) {
+        size_t row = (size_t)_y * width;
+        const float* t = temperature.data() + row;
+        const float* d = density[3].data() + row;
+        float* bx = buoyancyX.data() + row;
+        float* by = buoyancyY.data() + row;
+        float* vx = velocityX.data() + row;
+        float* vy = velocityY.data() + row;
+        for (int x=1; x<width - 1; x++) {
+            float f = t[x] > ambient ? scale * ((t[x] - ambient) * sigma - d[x] * weight) : 0;
+            bx[x] = f * gx;
+            by[x] = f * gy;
+            vx[x] += bx[x];
+            vy[x] += by[x];
+        }
+    });
+}
+
+//--------------------------------------------------------------
+void CpuFluidSolver::project() {
+    const float halfrdx = 0.5 / settings.cellSize;
+    const float alpha = -settings.cellSize * settings.cellSize;
+    const int w = width;
+
+    // divergence, walls don't move
+    parallelRows([&](int _y) {
+        size_t row = (size_t)_y * w;
+        const float* vx = velocityX.data() + row;
+        const float* vy = velocityY.data() + row;
+        const float* o = combinedObstacle.data() + row;
+        float* div = divergence.data() + row;
+        int x = 1;
+#ifdef CPU_FLUID_SSE2
+        const __m128 one = _mm_set1_ps(1);
+        const __m128 h = _mm_set1_ps(halfrdx);
+        for (; x + 4 <= w - 1; x += 4) {
+            __m128 xR = _mm_mul_ps(_mm_loadu_ps(vx + x + 1), _mm_sub_ps(one, _mm_loadu_ps(o + x + 1)));
+            __m128 xL = _mm_mul_ps(_mm_loadu_ps(vx + x - 1), _mm_sub_ps(one, _mm_loadu_ps(o + x - 1)));
+            __m128 yT = _mm_mul_ps(_mm_loadu_ps(vy + x + w), _mm_sub_ps(one, _mm_loadu_ps(o + x + w)));
+            __m128 yB = _mm_mul_ps(_mm_loadu_ps(vy + x - w), _mm_sub_ps(one, _mm_loadu_ps(o + x - w)));
+            _mm_storeu_ps(div + x, _mm_mul_ps(h, _mm_add_ps(_mm_sub_ps(xR, xL), _mm_sub_ps(yT, yB))));
+        }
+#endif
+        for (; x < w - 1; x++) {
+            float xR = vx[x + 1] * (1 - o[x + 1]);
+            float xL = vx[x - 1] * (1 - o[x - 1]);
+            float yT = vy[x + w] * (1 - o[x + w]);
+            float yB = vy[x - w] * (1 - o[x - w]);
+            div[x] = halfrdx * ((xR - xL) + (yT - yB));
+        }
+    });
+
+    // pressure, warm started from the last frame; walls mirror the centre cell
+    for (int i=0; i<settings.numJacobiIterations; i++) {
+        parallelRows([&](int _y) {
+            size_t row = (size_t)_y * w;
+            const float* p = pressure.data() + row;
+            const float* div = divergence.data() + row;
+            const float* o = combinedObstacle.data() + row;
+            float* dst = tempX.data() + row;
+            int x = 1;
+#ifdef CPU_FLUID_SSE2
+            const __m128 a = _mm_set1_ps(alpha);
+            const __m128 quarter = _mm_set1_ps(0.25);
+            for (; x + 4 <= w - 1; x += 4) {
+                __m128 pC = _mm_loadu_ps(p + x);
+                __m128 pL = _mm_loadu_ps(p + x - 1);
+                __m128 pR = _mm_loadu_ps(p + x + 1);
+                __m128 pB = _mm_loadu_ps(p + x - w);
+                __m128 pT = _mm_loadu_ps(p + x + w);
+                pL = _mm_add_ps(pL, _mm_mul_ps(_mm_loadu_ps(o + x - 1), _mm_sub_ps(pC, pL)));
+                pR = _mm_add_ps(pR, _mm_mul_ps(_mm_loadu_ps(o + x + 1), _mm_sub_ps(pC, pR)));
+                pB = _mm_add_ps(pB, _mm_mul_ps(_mm_loadu_ps(o + x - w), _mm_sub_ps(pC, pB)));
+                pT = _mm_add_ps(pT, _mm_mul_ps(_mm_loadu_ps(o + x + w), _mm_sub_ps(pC, pT)));
+                __m128 sum = _mm_add_ps(_mm_add_ps(pL, pR), _mm_add_ps(pB, pT));
+                sum = _mm_add_ps(sum, _mm_mul_ps(a, _mm_loadu_ps(div + x)));
+                _mm_storeu_ps(dst + x, _mm_mul_ps(sum, quarter));
+            }
+#endif
+            for (; x < w - 1; x++) {
+                float pC = p[x];
+                float pL = p[x - 1] + o[x - 1] * (pC - p[x - 1]);
+                float pR = p[x + 1] + o[x + 1] * (pC - p[x + 1]);
+                float pB = p[x - w] + o[x - w] * (pC - p[x - w]);
+                float pT = p[x + w] + o[x + w] * (pC - p[x + w]);
+                dst[x] = (pL + pR + pB + pT + alpha * div[x]) * 0.25f;
+            }
+        });
+        pressure.swap(tempX);
+    }
+
+    // subtract the pressure gradient, no flow into walls
+    parallelRows([&](int _y) {
+        size_t row = (size_t)_y * w;
+        const float* p = pressure.data() + row;
+        const float* o = combinedObstacle.data() + row;
+        float* vx = velocityX.data() + row;
+        float* vy = velocityY.data() + row;
+        int x = 1;
+#ifdef CPU_FLUID_SSE2
+        const __m128 one = _mm_set1_ps(1);
+        const __m128 h = _mm_set1_ps(halfrdx);
+        for (; x + 4 <= w - 1; x += 4) {
+            __m128 pC = _mm_loadu_ps(p + x);
+            __m128 oL = _mm_loadu_ps(o + x - 1);
+            __m128 oR = _mm_loadu_ps(o + x + 1);
+            __m128 oB = _mm_loadu_ps(o + x - w);
+            __m128 oT = _mm_loadu_ps(o + x + w);
+            __m128 pL = _mm_loadu_ps(p + x - 1);
+            __m128 pR = _mm_loadu_ps(p + x + 1);
+            __m128 pB = _mm_loadu_ps(p + x - w);
+            __m128 pT = _mm_loadu_ps(p + x + w);
+            pL = _mm_add_ps(pL, _mm_mul_ps(oL, _mm_sub_ps(pC, pL)));
+            pR = _mm_add_ps(pR, _mm_mul_ps(oR, _mm_sub_ps(pC, pR)));
+            pB = _mm_add_ps(pB, _mm_mul_ps(oB, _mm_sub_ps(pC, pB)));
+            pT = _mm_add_ps(pT, _mm_mul_ps(oT, _mm_sub_ps(pC, pT)));
+            __m128 open = _mm_sub_ps(one, _mm_loadu_ps(o + x));
+            __m128 maskX = _mm_mul_ps(open, _mm_mul_ps(_mm_sub_ps(one, oL), _mm_sub_ps(one, oR)));
+            __m128 maskY = _mm_mul_ps(open, _mm_mul_ps(_mm_sub_ps(one, oB), _mm_sub_ps(one, oT)));
+            __m128 newX = _mm_sub_ps(_mm_loadu_ps(vx + x), _mm_mul_ps(h, _mm_sub_ps(pR, pL)));
+            __m128 newY = _mm_sub_ps(_mm_loadu_ps(vy + x), _mm_mul_ps(h, _mm_sub_ps(pT, pB)));
+            _mm_storeu_ps(vx + x, _mm_mul_ps(newX, maskX));
+            _mm_storeu_ps(vy + x, _mm_mul_ps(newY, maskY));
+        }
+#endif
+        for (; x < w - 1; x++) {
+            float pC = p[x];
+            float pL = p[x - 1] + o[x - 1] * (pC - p[x - 1]);
+            float pR = p[x + 1] + o[x + 1] * (pC - p[x + 1]);
+            float pB = p[x - w] + o[x - w] * (pC - p[x - w]);
+            float pT = p[x + w] + o[x + w] * (pC - p[x + w]);
+            float open = 1 - o[x];
+            vx[x] = (vx[x] - halfrdx * (pR - pL)) * open * (1 - o[x - 1]) * (1 - o[x + 1]);
+            vy[x] = (vy[x] - halfrdx * (pT - pB)) * open * (1 - o[x - w]) * (1 - o[x + w]);
+        }
+    });
+}
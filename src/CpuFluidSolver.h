@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vector>
+#include "ThreadPool.h"
+
+// Parameters of the CPU solver, named and scaled like ftFluidSimulation's
+struct CpuFluidSettings {
+    CpuFluidSettings();
+
+    float	speed;
+    float	cellSize;
+    int		numJacobiIterations;
+    float	viscosity;
+    float	vorticity;
+    float	dissipation;
+    float	dissipationVelocityOffset;
+    float	dissipationDensityOffset;
+    float	dissipationTemperatureOffset;
+    float	smokeSigma;
+    float	smokeWeight;
+    float	ambientTemperature;
+    float	gravityX;
+    float	gravityY;
+    float	maxVelocity;		// 0 doesn't clamp
+    float	maxDensity;
+    float	maxTemperature;
+};
+
+// Stable fluids on the CPU, the same passes ftFluidSimulation runs as
+// shaders: vorticity confinement, semi-Lagrangian advection, viscous
+// diffusion, smoke buoyancy and a Jacobi pressure projection.
+//
+// Every field is its own float array (x and y of a vector field are separate
+// arrays), so the stencil kernels run four cells per SSE instruction. Rows
+// are split across the thread pool. The outermost cells are a fixed
+// obstacle border, like in flowtools.
+//
+// Pure C++ without GL, inputs and outputs are arrays at the simulation
+// resolution; CpuFluidSimulation connects it to textures.
+class CpuFluidSolver {
+public:
+    CpuFluidSolver();
+
+    void			setup(int _width, int _height);
+    void			setThreadPool(ThreadPool* _pool)	{ pool = _pool; }
+    void			reset();
+
+    CpuFluidSettings settings;
+
+    // _data holds _numChannels interleaved floats per cell
+    void			addVelocity(const float* _data, int _numChannels, float _strength = 1.0);	// first two channels
+    void			addDensity(const float* _data, int _numChannels, float _strength = 1.0);	// up to four channels
+    void			addTemperature(const float* _data, int _numChannels, float _strength = 1.0);	// first channel
+    void			addPressure(const float* _data, int _numChannels, float _strength = 1.0);
+    void			addObstacle(const float* _data, int _numChannels);		// first channel above 0.5
+    void			addTempObstacle(const float* _data, int _numChannels);	// for the next update only
+    // kept until replaced, survives reset() but not setup(); _data is 0 or 255 per cell of the whole grid, only the given area is copied
+    void			setDynamicObstacle(const unsigned char* _data, int _x, int _y, int _width, int _height);
+
+    void			update(float _deltaTime);	// seconds
+
+    int				getWidth() const			{ return width; }
+    int				getHeight() const			{ return height; }
+    const float*	getVelocityX() const		{ return velocityX.data(); }
+    const float*	getVelocityY() const		{ return velocityY.data(); }
+    const float*	getDensity(int _channel) const { return density[_channel].data(); }
+    const float*	getTemperature() const		{ return temperature.data(); }
+    const float*	getPressure() const			{ return pressure.data(); }
+    const float*	getDivergence() const		{ return divergence.data(); }
+    const float*	getConfinementX() const		{ return confinementX.data(); }
+    const float*	getConfinementY() const		{ return confinementY.data(); }
+    const float*	getBuoyancyX() const		{ return buoyancyX.data(); }
+    const float*	getBuoyancyY() const		{ return buoyancyY.data(); }
+    const float*	getObstacle() const			{ return combinedObstacle.data(); }	// 1 inside obstacles
+
+protected:
+    typedef std::vector<float> Field;
+
+    void			parallelRows(const std::function<void(int)>& _row);
+    void			clearBorder(Field& _field);
+    void			addChannel(Field& _field, const float* _data, int _numChannels, int _channel, float _strength);
+    void			combineObstacles();
+    void			clampFields();
+    void			applyVorticity(float _timeStep);
+    void			advect(Field& _dst, const Field& _src, const Field& _velocityX, const Field& _velocityY, float _timeStep, float _dissipation);
+    void			diffuseVelocity(float _deltaTime);
+    void			applyBuoyancy(float _deltaTime);
+    void			project();
+
+    int				width;
+    int				height;
+    ThreadPool*		pool;
+
+    Field			velocityX, velocityY;
+    Field			density[4];
+    Field			temperature;
+    Field			pressure;
+    Field			divergence;
+    Field			curl;
+    Field			confinementX, confinementY;
+    Field			buoyancyX, buoyancyY;
+    Field			obstacle;			// permanent, with the border
+    Field			tempObstacle;
+    Field			dynamicObstacle;
+    size_t			numDynamicCells;
+    Field			combinedObstacle;
+    bool			bTempObstacle;
+
+    // scratch
+    Field			tempX, tempY;
+    Field			originalX, originalY;
+};
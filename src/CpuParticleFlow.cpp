@@ -0,0 +1,189 @@
+#include "CpuParticleFlow.h"
+
+#define STRINGIFY(A) #A
+
+// round points sized per vertex, the programmable renderer has no glPointSize per point
+static const string pointVertexShader = "#version 150\n" STRINGIFY(
+    uniform mat4 modelViewProjectionMatrix;
+    in vec4 position;
+    in vec4 color;
+    in vec3 normal;
+    out vec4 colorVarying;
+    void main() {
+        gl_Position = modelViewProjectionMatrix * position;
+        gl_PointSize = normal.x;
+        colorVarying = color;
+    }
+);
+
+static const string pointFragmentShader = "#version 150\n" STRINGIFY(
+    in vec4 colorVarying;
+    out vec4 fragColor;
+    void main() {
+        vec2 p = gl_PointCoord * 2.0 - 1.0;
+        float falloff = 1.0 - dot(p, p);
+        if (falloff <= 0.0)
+            discard;
+        fragColor = vec4(colorVarying.rgb, colorVarying.a * falloff);
+    }
+);
+
+
+//--------------------------------------------------------------
+CpuParticleFlow::CpuParticleFlow(int _maxParticles, ThreadPool* _pool) {
+    maxParticles = _maxParticles;
+    budget = 1;
+    bMeshDirty = true;
+    programCache = nullptr;
+    system.setThreadPool(_pool);
+
+    // same names and ranges as ftParticleFlow, so saved settings carry over
+    CpuParticleSettings defaults;
+    parameters.setName("particles");
+    parameters.add(doParticles.set("do particles", true));
+    parameters.add(birthChance.set("birth chance", defaults.birthChance, 0, 1));
+    parameters.add(birthVelocityChance.set("birth velocity chance", defaults.birthVelocityChance, 0, 1));
+    parameters.add(lifeSpan.set("lifespan", defaults.lifeSpan, 0, 10));
+    parameters.add(lifeSpanSpread.set("lifespan spread", defaults.lifeSpanSpread, 0, 1));
+    parameters.add(mass.set("mass", defaults.mass, 0, 1));
+    parameters.add(massSpread.set("mass spread", defaults.massSpread, 0, 1));
+    parameters.add(size.set("size", defaults.size, 0, 10));
+    parameters.add(sizeSpread.set("size spread", defaults.sizeSpread, 0, 1));
+    parameters.add(twinkleSpeed.set("twinkle speed", 10, 0, 20));
+    parameters.add(gravity.set("gravity", defaults.gravity, -1, 1));
+    parameters.add(guiNumAlive.set("alive", "0"));
+}
+
+//--------------------------------------------------------------
+void CpuParticleFlow::setup(int _simulationWidth, int _simulationHeight, int _drawWidth, int _drawHeight, const FieldPrecision& _precision) {
+    if (maxParticles <= 0)
+        maxParticles = _simulationWidth * _simulationHeight * 4;
+    system.setup(_simulationWidth, _simulationHeight, maxParticles);
+    reader.allocate(_simulationWidth, _simulationHeight);
+
+    mesh.setMode(OF_PRIMITIVE_POINTS);
+    mesh.setUsage(GL_STREAM_DRAW);
+    if (ofIsGLProgrammableRenderer() && !pointShader.isLoaded()) {
+        if (programCache)
+            programCache->load(pointShader, pointVertexShader, pointFragmentShader);
+        else
+            ProgramCache::compile(pointShader, pointVertexShader, pointFragmentShader, vector<pair<GLuint, string> >());
+    }
+    bMeshDirty = true;
+}
+
+//--------------------------------------------------------------
+FieldPrecision CpuParticleFlow::getStoredPrecision(const FieldPrecision& _precision) const {
+    // the particles live in float vectors, whatever was asked
+    FieldPrecision stored = _precision;
+    stored.particles = FIELD_FORMAT_FP32;
+    return stored;
+}
+
+//--------------------------------------------------------------
+void CpuParticleFlow::applySettings() {
+    CpuParticleSettings& settings = system.settings;
+    settings.birthChance = birthChance;
+    settings.birthVelocityChance = birthVelocityChance;
+    settings.lifeSpan = lifeSpan;
+    settings.lifeSpanSpread = lifeSpanSpread;
+    settings.mass = mass;
+    settings.massSpread = massSpread;
+    settings.size = size;
+    settings.sizeSpread = sizeSpread;
+    settings.gravity = gravity;
+    system.setLimit(system.getMaxParticles() * min(max(budget, 0.0f), 1.0f));
+}
+
+//--------------------------------------------------------------
+void CpuParticleFlow::update(float _deltaTime) {
+    if (!doParticles)
+        return;
+    if (_deltaTime <= 0)
+        _deltaTime = ofGetLastFrameTime();
+    applySettings();
+    system.update(_deltaTime);
+    guiNumAlive.set(ofToString(system.getNumAlive()));
+    bMeshDirty = true;
+}
+
+//--------------------------------------------------------------
+void CpuParticleFlow::addFlowVelocity(ofTexture& _texture, float _strength) {
+    // inputs are only cleared by an update, which doesn't run while inactive
+    if (!doParticles)
+        return;
+    system.addFlowVelocity(reader.read(_texture), 4, _strength);
+}
+
+//--------------------------------------------------------------
+void CpuParticleFlow::addFluidVelocity(ofTexture& _texture, float _strength) {
+    if (!doParticles)
+        return;
+    system.addFluidVelocity(reader.read(_texture), 4, _strength);
+}
+
+//--------------------------------------------------------------
+void CpuParticleFlow::setObstacle(ofTexture& _texture) {
+    if (!doParticles)
+        return;
+    system.setObstacle(reader.read(_texture), 4);
+}
+
+//--------------------------------------------------------------
+void CpuParticleFlow::updateMesh() {
+    int numAlive = system.getNumAlive();
+    vector<ofVec3f>& vertices = mesh.getVertices();
+    vector<ofFloatColor>& colors = mesh.getColors();
+    vector<ofVec3f>& normals = mesh.getNormals();
+    vertices.resize(numAlive);
+    colors.resize(numAlive);
+    normals.resize(numAlive);
+
+    const float* x = system.getPositionX();
+    const float* y = system.getPositionY();
+    const float* age = system.getAge();
+    const float* life = system.getLifeSpan();
+    const float* particleSize = system.getSize();
+    float twinkle = twinkleSpeed;
+    int n = 0;
+    for (int i=0; i<system.getNumSlots() && n<numAlive; i++) {
+        if (!system.isAlive(i))
+            continue;
+        // fade out over the life span, twinkle in size
+        float alpha = 1.0 - age[i] / max(life[i], 0.001f);
+        vertices[n].set(x[i], y[i], 0);
+        colors[n].set(1, 1, 1, alpha);
+        normals[n].set(particleSize[i] * (0.75 + 0.25 * sin(age[i] * twinkle + i)), 0, 0);
+        n++;
+    }
+    bMeshDirty = false;
+}
+
+//--------------------------------------------------------------
+void CpuParticleFlow::draw(int _x, int _y, int _width, int _height) {
+    if (!doParticles)
+        return;
+    if (bMeshDirty)
+        updateMesh();
+
+    ofPushMatrix();
+    ofTranslate(_x, _y);
+    ofScale(_width / (float)system.getGridWidth(), _height / (float)system.getGridHeight());
+    if (pointShader.isLoaded()) {
+        glEnable(GL_PROGRAM_POINT_SIZE);
+        pointShader.begin();
+        mesh.draw();
+        pointShader.end();
+        glDisable(GL_PROGRAM_POINT_SIZE);
+    }
+    else {
+        glPointSize(size);
+        mesh.draw();
+    }
+    ofPopMatrix();
+}
+
+//--------------------------------------------------------------
+bool CpuParticleFlow::savePositions(const string& _path) {
+    return system.savePositions(ofToDataPath(_path, true));
+}
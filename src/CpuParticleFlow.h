@@ -0,0 +1,63 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ParticleFlow.h"
+#include "CpuParticleSystem.h"
+#include "TextureReader.h"
+#include "ProgramCache.h"
+
+// CpuParticleSystem behind the ParticleFlow interface. Input textures are
+// read back at the simulation size; the live particles are drawn as round
+// points from a mesh that is rebuilt when drawn after an update.
+class CpuParticleFlow : public ParticleFlow {
+public:
+    CpuParticleFlow(int _maxParticles = 0, ThreadPool* _pool = nullptr);	// 0 uses four per simulation cell
+
+    void	setup(int _simulationWidth, int _simulationHeight, int _drawWidth, int _drawHeight, const FieldPrecision& _precision);
+    void	setProgramCache(ProgramCache* _cache)	{ programCache = _cache; }
+    void	update(float _deltaTime = 0);
+    void	draw(int _x, int _y, int _width, int _height);
+    bool	isActive()						{ return doParticles; }
+    string	getName() const					{ return "cpu"; }
+    FieldPrecision	getStoredPrecision(const FieldPrecision& _precision) const;
+
+    void	setSpeed(float _value)			{ system.settings.speed = _value; }
+    void	setCellSize(float _value)		{ system.settings.cellSize = _value; }
+    void	addFlowVelocity(ofTexture& _texture, float _strength = 1.0);
+    void	addFluidVelocity(ofTexture& _texture, float _strength = 1.0);
+    void	setObstacle(ofTexture& _texture);
+
+    ofParameterGroup& getParameters()		{ return parameters; }
+    bool	savePositions(const string& _path);
+    void	setBudget(float _fraction)		{ budget = _fraction; }
+
+    CpuParticleSystem&	getSystem()			{ return system; }
+
+    ofParameterGroup	parameters;
+    ofParameter<bool>	doParticles;
+    ofParameter<float>	birthChance;
+    ofParameter<float>	birthVelocityChance;
+    ofParameter<float>	lifeSpan;
+    ofParameter<float>	lifeSpanSpread;
+    ofParameter<float>	mass;
+    ofParameter<float>	massSpread;
+    ofParameter<float>	size;
+    ofParameter<float>	sizeSpread;
+    ofParameter<float>	twinkleSpeed;
+    ofParameter<float>	gravity;
+    ofParameter<string>	guiNumAlive;
+
+protected:
+    void			applySettings();
+    void			updateMesh();
+
+    CpuParticleSystem	system;
+    int				maxParticles;
+    float			budget;
+    TextureReader	reader;
+
+    ofVboMesh		mesh;				// point size in the normal's x
+    bool			bMeshDirty;
+    ofShader		pointShader;
+    ProgramCache*	programCache;
+};
@@ -0,0 +1,288 @@
+#include "CpuParticleSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CPU_PARTICLES_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+// velocities are sampled into stack buffers of this many particles before integrating
+static const int BLOCK_SIZE = 256;
+
+
+//--------------------------------------------------------------
+CpuParticleSettings::CpuParticleSettings() {
+    speed = 0.3;
+    cellSize = 1.25;
+    birthChance = 0.5;
+    birthVelocityChance = 0.1;
+    lifeSpan = 5;
+    lifeSpanSpread = 0.25;
+    mass = 0.25;
+    massSpread = 0.25;
+    size = 2;
+    sizeSpread = 0.75;
+    gravity = 0;
+}
+
+//--------------------------------------------------------------
+CpuParticleSystem::CpuParticleSystem() {
+    gridWidth = 0;
+    gridHeight = 0;
+    maxParticles = 0;
+    limit = 0;
+    pool = nullptr;
+    numAlive = 0;
+    numSlots = 0;
+    randomState = 0x9e3779b9;
+}
+
+//--------------------------------------------------------------
+void CpuParticleSystem::setup(int _gridWidth, int _gridHeight, int _maxParticles) {
+    gridWidth = max(_gridWidth, 2);
+    gridHeight = max(_gridHeight, 2);
+    maxParticles = max(_maxParticles, 1);
+    limit = maxParticles;
+
+    size_t gridSize = (size_t)gridWidth * gridHeight;
+    flowX.assign(gridSize, 0);
+    flowY.assign(gridSize, 0);
+    fluidX.assign(gridSize, 0);
+    fluidY.assign(gridSize, 0);
+    obstacle.assign(gridSize, 0);
+
+    // padded to whole blocks so the vector loops never need a tail
+    size_t particleSize = (maxParticles + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+    Field* fields[] = { &positionX, &positionY, &velocityX, &velocityY, &age, &lifeSpan, &mass, &size };
+    for (Field* field : fields)
+        field->assign(particleSize, 0);
+    alive.assign(particleSize, 0);
+    reset();
+}
+
+//--------------------------------------------------------------
+void CpuParticleSystem::reset() {
+    fill(alive.begin(), alive.end(), 0);
+    freeList.resize(maxParticles);
+    for (int i=0; i<maxParticles; i++)
+        freeList[i] = maxParticles - 1 - i;
+    numAlive = 0;
+    numSlots = 0;
+    fill(flowX.begin(), flowX.end(), 0);
+    fill(flowY.begin(), flowY.end(), 0);
+    fill(fluidX.begin(), fluidX.end(), 0);
+    fill(fluidY.begin(), fluidY.end(), 0);
+}
+
+//--------------------------------------------------------------
+float CpuParticleSystem::random() {
+    // xorshift, only the spawning thread draws numbers
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return (randomState >> 8) * (1.0f / 16777216.0f);
+}
+
+//--------------------------------------------------------------
+void CpuParticleSystem::addField(Field& _x, Field& _y, const float* _data, int _numChannels, float _strength) {
+    size_t gridSize = _x.size();
+    for (size_t i=0; i<gridSize; i++) {
+        _x[i] += _data[i * _numChannels] * _strength;
+        if (_numChannels > 1)
+            _y[i] += _data[i * _numChannels + 1] * _strength;
+    }
+}
+
+//--------------------------------------------------------------
+void CpuParticleSystem::addFlowVelocity(const float* _data, int _numChannels, float _strength) {
+    addField(flowX, flowY, _data, _numChannels, _strength);
+}
+
+//--------------------------------------------------------------
+void CpuParticleSystem::addFluidVelocity(const float* _data, int _numChannels, float _strength) {
+    addField(fluidX, fluidY, _data, _numChannels, _strength);
+}
+
+//--------------------------------------------------------------
+void CpuParticleSystem::setObstacle(const float* _data, int _numChannels) {
+    for (size_t i=0; i<obstacle.size(); i++)
+        obstacle[i] = _data[i * _numChannels] > 0.5 ? 1 : 0;
+}
+
+//--------------------------------------------------------------
+void CpuParticleSystem::update(float _deltaTime) {
+    spawn();
+
+    int numBlocks = (numSlots + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    died.clear();
+    auto integrateBlocks = [&](int _begin, int _end) {
+        vector<int> blockDied;
+        for (int b=_begin; b<_end; b++)
+            integrate(b * BLOCK_SIZE, (b + 1) * BLOCK_SIZE, _deltaTime, blockDied);
+        if (!blockDied.empty()) {
+            lock_guard<mutex> lock(diedMutex);
+            died.insert(died.end(), blockDied.begin(), blockDied.end());
+        }
+    };
+    if (pool)
+        pool->parallelFor(numBlocks, integrateBlocks, 4);
+    else
+        integrateBlocks(0, numBlocks);
+
+    for (int index : died)
+        alive[index] = 0;
+    freeList.insert(freeList.end(), died.begin(), died.end());
+    numAlive -= died.size();
+    while (numSlots > 0 && !alive[numSlots - 1])
+        numSlots--;
+
+    // the flow is a per frame input, like the textures ftParticleFlow gets
+    fill(flowX.begin(), flowX.end(), 0);
+    fill(flowY.begin(), flowY.end(), 0);
+    fill(fluidX.begin(), fluidX.end(), 0);
+    fill(fluidY.begin(), fluidY.end(), 0);
+}
+
+//--------------------------------------------------------------
+void CpuParticleSystem::spawn() {
+    // few cells move at once, so a serial pass over the grid is cheap and keeps the free list simple
+    const float birthChance = settings.birthChance;
+    const float birthSpeed = max(settings.birthVelocityChance, 1e-4f);
+    for (int y=0; y<gridHeight && !freeList.empty() && numAlive < limit; y++) {
+        for (int x=0; x<gridWidth && !freeList.empty() && numAlive < limit; x++) {
+            size_t cell = (size_t)y * gridWidth + x;
+            if (obstacle[cell] > 0)
+                continue;
+            float speed = sqrtf(flowX[cell] * flowX[cell] + flowY[cell] * flowY[cell]);
+            if (speed <= 0 || random() >= birthChance * min(speed / birthSpeed, 1.0f))
+                continue;
+
+            int index = freeList.back();
+            freeList.pop_back();
+            alive[index] = 1;
+            numAlive++;
+            numSlots = max(numSlots, index + 1);
+
+            positionX[index] = x + random();
+            positionY[index] = y + random();
+            velocityX[index] = 0;
+            velocityY[index] = 0;
+            age[index] = 0;
+            lifeSpan[index] = settings.lifeSpan * (1 + settings.lifeSpanSpread * (random() * 2 - 1));
+            mass[index] = min(max(settings.mass * (1 + settings.massSpread * (random() * 2 - 1)), 0.0f), 0.99f);
+            size[index] = max(settings.size * (1 + settings.sizeSpread * (random() * 2 - 1)), 0.0f);
+        }
+    }
+}
+
+//--------------------------------------------------------------
+void CpuParticleSystem::integrate(int _begin, int _end, float _deltaTime, vector<int>& _died) {
+    const float k = _deltaTime * settings.speed * gridWidth / settings.cellSize;
+    const float maxX = gridWidth - 1.001f;
+    const float maxY = gridHeight - 1.001f;
+    const int w = gridWidth;
+    float sampleX[BLOCK_SIZE];
+    float sampleY[BLOCK_SIZE];
+
+    // bilinear gathers of the summed velocities, scalar
+    for (int i=_begin; i<_end; i++) {
+        int s = i - _begin;
+        if (!alive[i]) {
+            sampleX[s] = 0;
+            sampleY[s] = 0;
+            continue;
+        }
+        float px = min(max(positionX[i], 0.0f), maxX);
+        float py = min(max(positionY[i], 0.0f), maxY);
+        int x0 = (int)px;
+        int y0 = (int)py;
+        float fx = px - x0;
+        float fy = py - y0;
+        size_t c = (size_t)y0 * w + x0;
+        float w00 = (1 - fx) * (1 - fy);
+        float w10 = fx * (1 - fy);
+        float w01 = (1 - fx) * fy;
+        float w11 = fx * fy;
+        sampleX[s] = (flowX[c] + fluidX[c]) * w00 + (flowX[c + 1] + fluidX[c + 1]) * w10 +
+                     (flowX[c + w] + fluidX[c + w]) * w01 + (flowX[c + w + 1] + fluidX[c + w + 1]) * w11;
+        sampleY[s] = (flowY[c] + fluidY[c]) * w00 + (flowY[c + 1] + fluidY[c + 1]) * w10 +
+                     (flowY[c + w] + fluidY[c + w]) * w01 + (flowY[c + w + 1] + fluidY[c + w + 1]) * w11;
+    }
+
+    // heavier particles keep more of their own velocity, then move
+    int i = _begin;
+    const float gravity = settings.gravity * _deltaTime;
+#ifdef CPU_PARTICLES_SSE2
+    const __m128 kk = _mm_set1_ps(k);
+    const __m128 g = _mm_set1_ps(gravity);
+    const __m128 dt = _mm_set1_ps(_deltaTime);
+    for (; i + 4 <= _end; i += 4) {
+        int s = i - _begin;
+        __m128 m = _mm_loadu_ps(&mass[i]);
+        __m128 sx = _mm_loadu_ps(sampleX + s);
+        __m128 sy = _mm_loadu_ps(sampleY + s);
+        __m128 vx = _mm_add_ps(sx, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&velocityX[i]), sx), m));
+        __m128 vy = _mm_add_ps(_mm_add_ps(sy, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&velocityY[i]), sy), m)), g);
+        _mm_storeu_ps(&velocityX[i], vx);
+        _mm_storeu_ps(&velocityY[i], vy);
+        _mm_storeu_ps(&positionX[i], _mm_add_ps(_mm_loadu_ps(&positionX[i]), _mm_mul_ps(vx, kk)));
+        _mm_storeu_ps(&positionY[i], _mm_add_ps(_mm_loadu_ps(&positionY[i]), _mm_mul_ps(vy, kk)));
+        _mm_storeu_ps(&age[i], _mm_add_ps(_mm_loadu_ps(&age[i]), dt));
+    }
+#endif
+    for (; i<_end; i++) {
+        int s = i - _begin;
+        velocityX[i] = sampleX[s] + (velocityX[i] - sampleX[s]) * mass[i];
+        velocityY[i] = sampleY[s] + (velocityY[i] - sampleY[s]) * mass[i] + gravity;
+        positionX[i] += velocityX[i] * k;
+        positionY[i] += velocityY[i] * k;
+        age[i] += _deltaTime;
+    }
+
+    // old, outside or inside an obstacle
+    for (i=_begin; i<_end; i++) {
+        if (!alive[i])
+            continue;
+        float px = positionX[i];
+        float py = positionY[i];
+        bool bDead = age[i] >= lifeSpan[i] || px < 0 || py < 0 || px >= gridWidth || py >= gridHeight;
+        if (!bDead)
+            bDead = obstacle[(size_t)py * w + (size_t)px] > 0;
+        if (bDead)
+            _died.push_back(i);
+    }
+}
+
+//--------------------------------------------------------------
+int CpuParticleSystem::copyPositions(vector<float>& _xy) const {
+    _xy.clear();
+    _xy.reserve(numAlive * 2);
+    for (int i=0; i<numSlots; i++) {
+        if (!alive[i])
+            continue;
+        _xy.push_back(positionX[i] / gridWidth);
+        _xy.push_back(positionY[i] / gridHeight);
+    }
+    return _xy.size() / 2;
+}
+
+//--------------------------------------------------------------
+bool CpuParticleSystem::savePositions(const string& _path) const {
+    ofstream out(_path.c_str());
+    if (!out)
+        return false;
+
+    // positions normalized to the grid, velocities in cells per step at speed 1
+    out << "x,y,vx,vy,age,lifespan" << endl;
+    for (int i=0; i<numSlots; i++) {
+        if (!alive[i])
+            continue;
+        out << positionX[i] / gridWidth << "," << positionY[i] / gridHeight << "," << velocityX[i] << ","
+            << velocityY[i] << "," << age[i] << "," << lifeSpan[i] << "\n";
+    }
+    return out.good();
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <cstdint>
+#include "ThreadPool.h"
+
+// Parameters of the CPU particles, named and scaled like ftParticleFlow's
+struct CpuParticleSettings {
+    CpuParticleSettings();
+
+    float	speed;					// same time scale as the fluid
+    float	cellSize;
+    float	birthChance;			// per grid cell and frame, at full birth velocity
+    float	birthVelocityChance;	// flow speed at which a cell spawns with the full birth chance
+    float	lifeSpan;				// seconds
+    float	lifeSpanSpread;			// fraction of the life span, random per particle
+    float	mass;					// 0 follows the flow, towards 1 keeps its own velocity
+    float	massSpread;
+    float	size;					// pixels
+    float	sizeSpread;
+    float	gravity;				// added to the vertical velocity per second
+};
+
+// Particles carried by the optical flow and the fluid velocity, the CPU
+// counterpart of ftParticleFlow. State lives in one array per attribute; a
+// dead particle's slot goes on a free list and is reused by the next spawn.
+// The integration runs four particles per SSE instruction on blocks of
+// bilinearly sampled velocities, blocks are split across the thread pool.
+//
+// Positions are in grid cells; inputs are arrays at the grid resolution.
+class CpuParticleSystem {
+public:
+    CpuParticleSystem();
+
+    void			setup(int _gridWidth, int _gridHeight, int _maxParticles);
+    void			setThreadPool(ThreadPool* _pool)	{ pool = _pool; }
+    void			setLimit(int _limit)				{ limit = _limit; }	// no spawning while this many are alive
+    void			reset();
+
+    CpuParticleSettings settings;
+
+    // _data holds _numChannels interleaved floats per cell; velocities are
+    // summed until the next update, the obstacle is kept until replaced
+    void			addFlowVelocity(const float* _data, int _numChannels, float _strength = 1.0);
+    void			addFluidVelocity(const float* _data, int _numChannels, float _strength = 1.0);
+    void			setObstacle(const float* _data, int _numChannels);	// first channel above 0.5
+
+    void			update(float _deltaTime);	// seconds
+
+    int				getGridWidth() const		{ return gridWidth; }
+    int				getGridHeight() const		{ return gridHeight; }
+    int				getMaxParticles() const		{ return maxParticles; }
+    int				getLimit() const			{ return limit; }
+    int				getNumAlive() const			{ return numAlive; }
+    int				getNumSlots() const			{ return numSlots; }	// every live particle has a lower index
+
+    // indexed by slot, only meaningful where isAlive()
+    bool			isAlive(int _index) const	{ return alive[_index] != 0; }
+    const float*	getPositionX() const		{ return positionX.data(); }
+    const float*	getPositionY() const		{ return positionY.data(); }
+    const float*	getVelocityX() const		{ return velocityX.data(); }
+    const float*	getVelocityY() const		{ return velocityY.data(); }
+    const float*	getAge() const				{ return age.data(); }
+    const float*	getLifeSpan() const			{ return lifeSpan.data(); }
+    const float*	getSize() const				{ return size.data(); }
+
+    // live particles only, positions normalized to the grid
+    int				copyPositions(std::vector<float>& _xy) const;
+    bool			savePositions(const std::string& _path) const;	// csv
+
+protected:
+    typedef std::vector<float> Field;
+
+    void			addField(Field& _x, Field& _y, const float* _data, int _numChannels, float _strength);
+    void			spawn();
+    void			integrate(int _begin, int _end, float _deltaTime, std::vector<int>& _died);
+    float			random();				// [0, 1)
+
+    int				gridWidth;
+    int				gridHeight;
+    int				maxParticles;
+    int				limit;
+    ThreadPool*		pool;
+
+    // inputs
+    Field			flowX, flowY;
+    Field			fluidX, fluidY;
+    Field			obstacle;
+
+    // particles
+    Field			positionX, positionY;
+    Field			velocityX, velocityY;
+    Field			age;
+    Field			lifeSpan;
+    Field			mass;
+    Field			size;
+    std::vector<uint8_t> alive;
+    std::vector<int> freeList;				// dead slots, reused last freed first
+    int				numAlive;
+    int				numSlots;
+
+    std::mutex		diedMutex;
+    std::vector<int> died;
+    uint32_t		randomState;
+};
@@ -0,0 +1,143 @@
+#include "DepthBandPass.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DEPTH_BAND_PASS_SSE2
+#include <emmintrin.h>
+#endif
+
+
+//--------------------------------------------------------------
+DepthBandPass::DepthBandPass() {
+    width = 0;
+    height = 0;
+    stride = 0;
+    nearMm = 500;
+    farMm = 2000;
+    radius = 2;
+}
+
+//--------------------------------------------------------------
+void DepthBandPass::setup(int _width, int _height) {
+    width = _width;
+    height = _height;
+    stride = (width + 15) & ~15;
+    mask.allocate(width, height, OF_IMAGE_GRAYSCALE);
+    mask.set(0);
+    allocateBuffers();
+}
+
+//--------------------------------------------------------------
+void DepthBandPass::setRange(int _nearMm, int _farMm) {
+    // 0 is no reading and never part of the band
+    nearMm = ofClamp(_nearMm, 1, 65535);
+    farMm = ofClamp(_farMm, nearMm, 65535);
+}
+
+//--------------------------------------------------------------
+void DepthBandPass::setDilation(int _radius) {
+    _radius = max(_radius, 0);
+    if (_radius == radius)
+        return;
+    radius = _radius;
+    allocateBuffers();
+}
+
+//--------------------------------------------------------------
+void DepthBandPass::allocateBuffers() {
+    // the padding lets the SIMD loops read whole registers past the end of a row
+    bandRow.assign(stride + 2 * radius + 16, 0);
+    rowRing.assign((2 * radius + 1) * stride, 0);
+}
+
+//--------------------------------------------------------------
+void DepthBandPass::thresholdRow(const unsigned short* _depth, unsigned char* _dst) const {
+    // near <= d <= far  is  (d - near) <= (far - near)  in unsigned arithmetic
+    const unsigned short range = farMm - nearMm;
+    int x = 0;
+#ifdef DEPTH_BAND_PASS_SSE2
+    const __m128i nearV = _mm_set1_epi16(nearMm);
+    const __m128i rangeV = _mm_set1_epi16(range);
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 16 <= width; x += 16) {
+        __m128i d0 = _mm_loadu_si128((const __m128i*)(_depth + x));
+        __m128i d1 = _mm_loadu_si128((const __m128i*)(_depth + x + 8));
+        // saturating subtract is zero exactly when the offset is within range
+        __m128i m0 = _mm_cmpeq_epi16(_mm_subs_epu16(_mm_sub_epi16(d0, nearV), rangeV), zero);
+        __m128i m1 = _mm_cmpeq_epi16(_mm_subs_epu16(_mm_sub_epi16(d1, nearV), rangeV), zero);
+        _mm_storeu_si128((__m128i*)(_dst + x), _mm_packs_epi16(m0, m1));
+    }
+#endif
+    for (; x < width; x++)
+        _dst[x] = (unsigned short)(_depth[x] - nearMm) <= range ? 255 : 0;
+}
+
+//--------------------------------------------------------------
+void DepthBandPass::dilateRowHorizontal(const unsigned char* _src, unsigned char* _dst) const {
+    // _src is offset by radius, _dst[x] = max(_src[x - radius .. x + radius])
+    const int size = 2 * radius + 1;
+    int x = 0;
+#ifdef DEPTH_BAND_PASS_SSE2
+    for (; x < stride; x += 16) {
+        __m128i m = _mm_loadu_si128((const __m128i*)(_src + x));
+        for (int k=1; k<size; k++)
+            m = _mm_max_epu8(m, _mm_loadu_si128((const __m128i*)(_src + x + k)));
+        _mm_storeu_si128((__m128i*)(_dst + x), m);
+    }
+#endif
+    for (; x < stride; x++) {
+        unsigned char m = _src[x];
+        for (int k=1; k<size; k++)
+            m = max(m, _src[x + k]);
+        _dst[x] = m;
+    }
+}
+
+//--------------------------------------------------------------
+void DepthBandPass::dilateRowVertical(unsigned char* _dst) const {
+    const int size = 2 * radius + 1;
+    const unsigned char* ring = rowRing.data();
+    int x = 0;
+#ifdef DEPTH_BAND_PASS_SSE2
+    for (; x + 16 <= width; x += 16) {
+        __m128i m = _mm_loadu_si128((const __m128i*)(ring + x));
+        for (int k=1; k<size; k++)
+            m = _mm_max_epu8(m, _mm_loadu_si128((const __m128i*)(ring + k * stride + x)));
+        _mm_storeu_si128((__m128i*)(_dst + x), m);
+    }
+#endif
+    for (; x < width; x++) {
+        unsigned char m = ring[x];
+        for (int k=1; k<size; k++)
+            m = max(m, ring[k * stride + x]);
+        _dst[x] = m;
+    }
+}
+
+//--------------------------------------------------------------
+void DepthBandPass::update(const ofShortPixels& _depth) {
+    if ((int)_depth.getWidth() != width || (int)_depth.getHeight() != height)
+        setup(_depth.getWidth(), _depth.getHeight());
+
+    const int size = 2 * radius + 1;
+    const unsigned short* depth = _depth.getData();
+    unsigned char* dst = mask.getData();
+
+    // rows above the image and below it don't contribute to the max
+    fill(rowRing.begin(), rowRing.end(), 0);
+
+    // row y enters the ring and output row y - radius leaves it
+    for (int y=0; y<height + radius; y++) {
+        unsigned char* ringRow = rowRing.data() + (y % size) * stride;
+        if (y < height) {
+            thresholdRow(depth + y * width, bandRow.data() + radius);
+            dilateRowHorizontal(bandRow.data(), ringRow);
+        }
+        else {
+            memset(ringRow, 0, stride);
+        }
+
+        int outY = y - radius;
+        if (outY >= 0)
+            dilateRowVertical(dst + outY * width);
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Turns raw millimetre depth into a binary mask (255 inside [near, far],
+// 0 elsewhere and where there is no reading) and dilates it with a square
+// (2 * radius + 1) kernel, in one pass over the frame.
+//
+// Rows are thresholded and dilated horizontally into a small ring of
+// 2 * radius + 1 rows, the vertical max of the ring gives the output row,
+// so the intermediate data stays in cache. SSE2 when available, scalar
+// otherwise.
+class DepthBandPass {
+public:
+    DepthBandPass();
+
+    void			setup(int _width, int _height);
+    void			setRange(int _nearMm, int _farMm);
+    void			setDilation(int _radius);
+
+    void			update(const ofShortPixels& _depth);
+
+    ofPixels&		getMask()				{ return mask; }
+    int				getNearMm() const		{ return nearMm; }
+    int				getFarMm() const		{ return farMm; }
+    int				getDilation() const		{ return radius; }
+
+protected:
+    void			allocateBuffers();
+    void			thresholdRow(const unsigned short* _depth, unsigned char* _dst) const;
+    void			dilateRowHorizontal(const unsigned char* _src, unsigned char* _dst) const;
+    void			dilateRowVertical(unsigned char* _dst) const;
+
+    int				width;
+    int				height;
+    int				stride;			// width rounded up to a whole SIMD register
+    unsigned short	nearMm;
+    unsigned short	farMm;
+    int				radius;
+
+    ofPixels		mask;
+    vector<unsigned char> bandRow;	// thresholded row with radius zeros on either side
+    vector<unsigned char> rowRing;	// 2 * radius + 1 horizontally dilated rows
+};
@@ -0,0 +1,307 @@
+#include "DepthCapture.h"
+
+
+//--------------------------------------------------------------
+DepthCapture::DepthCapture() {
+    bThreaded = false;
+    bSupervised = false;
+    bRunning = false;
+    nearMm = 500;
+    farMm = 2000;
+    dilation = 2;
+    bMotionGate = false;
+    motionEnergyThreshold = 0.002;
+    motionAreaThreshold = 2;
+    obstacleWidth = 0;
+    obstacleHeight = 0;
+    bTraceContours = false;
+    bSparseFlow = false;
+    flowPointSpacing = 6;
+    maxFlowPoints = 400;
+    flowWindowRadius = 7;
+    flowLevels = 3;
+    bSparseFlowRunning = false;
+    lastCaptureMicros = 0;
+    recordStartMicros = 0;
+    bRecording = false;
+    numCaptured = 0;
+    numSkippedStill = 0;
+    numDroppedAtSource = 0;
+    numDroppedAtHandoff = 0;
+
+    // the areas of circles of 10 and 200 pixels radius, what the contour finder used to keep
+    blobFinder.setAreaRange(314, 125664);
+    stageFrame = nullptr;
+    setupStages();
+}
+
+//--------------------------------------------------------------
+void DepthCapture::setupStages() {
+    stages.addStage("depth image", STAGE_QUEUE_CPU, {"raw"}, {"depth"}, [this]{
+        // converted here rather than by the source, frames the gate holds back never are
+        stageFrame->depth = depthPool.acquire();
+        source->getDepthImage(stageFrame->depth.getData());
+    });
+    stages.addStage("band pass", STAGE_QUEUE_CPU, {"raw"}, {"mask"}, [this]{
+        // the band pass writes every pixel, its buffer and the frame's are swapped instead of copied
+        bandPass.setRange(nearMm, farMm);
+        bandPass.setDilation(dilation);
+        bandPass.update(source->getRawDepthPixels());
+        stageFrame->mask.swap(bandPass.getMask());
+    });
+    stages.addStage("obstacle grid", STAGE_QUEUE_CPU, {"mask"}, {"obstacle"}, [this]{
+        // a few hundred microseconds here saves the render thread a read back of the mask
+        int gridWidth = obstacleWidth;
+        int gridHeight = obstacleHeight;
+        if (gridWidth > 0 && gridHeight > 0)
+            ObstacleMap::downsample(stageFrame->mask, stageFrame->obstacle, gridWidth, gridHeight);
+        else if (stageFrame->obstacle.isAllocated())
+            stageFrame->obstacle.clear();
+    });
+    stages.addStage("blobs", STAGE_QUEUE_CPU, {"mask", "raw"}, {"blobs"}, [this]{
+        // the sparse flow's points are spaced along the contours
+        blobFinder.setTraceContours(bTraceContours || bSparseFlow);
+        blobFinder.update(stageFrame->mask, &source->getRawDepthPixels());
+        stageFrame->blobs = blobFinder.getBlobs();
+    });
+    stages.addStage("sparse flow", STAGE_QUEUE_CPU, {"depth", "blobs"}, {"flow points"}, [this]{
+        // switched back on, it starts over rather than track from whenever it stopped
+        if (!bSparseFlow || !stageFrame->depth) {
+            bSparseFlowRunning = false;
+            stageFrame->flowPoints.clear();
+            stageFrame->flowPointSpacing = 0;
+            return;
+        }
+        if (!bSparseFlowRunning)
+            sparseFlow.reset();
+        bSparseFlowRunning = true;
+        sparseFlow.setPointSpacing(flowPointSpacing);
+        sparseFlow.setMaxPoints(maxFlowPoints);
+        sparseFlow.setWindowRadius(flowWindowRadius);
+        sparseFlow.setNumLevels(flowLevels);
+        sparseFlow.update(stageFrame->depth.getData(), stageFrame->blobs);
+        stageFrame->flowPoints = sparseFlow.getPoints();
+        stageFrame->flowPointSpacing = sparseFlow.getStats().pointSpacing;
+    });
+    stages.setThreadPool(&stagePool);
+}
+
+//--------------------------------------------------------------
+DepthCapture::~DepthCapture() {
+    stop();
+    stopRecording();
+}
+
+//--------------------------------------------------------------
+void DepthCapture::setup(shared_ptr<DepthSource> _source, bool _threaded) {
+    stop();
+    source = _source;
+    bThreaded = _threaded;
+    bSupervised = bThreaded && source->isLive();
+    supervisor.setup(source->getFps(), source->isConnected(), ofGetElapsedTimeMicros() / 1000000.0);
+
+    int width = source->getWidth();
+    int height = source->getHeight();
+    stagePool.setup(stages.getMaxWidth());
+    bandPass.setup(width, height);
+    motionGate.setup(width, height);
+    blobFinder.reset();
+    sparseFlow.setup(width, height);
+    sparseFlow.setThreadPool(&stagePool);
+    bSparseFlowRunning = false;
+    // one image per frame of the triple buffer plus the one being written; the recorder's grow with its queue
+    depthPool.setup(width, height, 1, 4);
+    rawPool.setup(width, height, 1);
+    for (int i=0; i<3; i++) {
+        DepthFrame& frame = frames.getBuffer(i);
+        frame.depth.reset();
+        frame.mask.allocate(width, height, 1);
+        frame.mask.set(0);
+    }
+
+    if (bThreaded) {
+        bRunning = true;
+        worker = thread(&DepthCapture::captureLoop, this);
+    }
+}
+
+//--------------------------------------------------------------
+void DepthCapture::stop() {
+    bRunning = false;
+    if (worker.joinable())
+        worker.join();
+}
+
+//--------------------------------------------------------------
+void DepthCapture::setBandPass(int _nearMm, int _farMm, int _dilation) {
+    nearMm = _nearMm;
+    farMm = _farMm;
+    dilation = _dilation;
+}
+
+//--------------------------------------------------------------
+void DepthCapture::setMotionGate(bool _enabled, float _energyThreshold, float _areaThreshold) {
+    bMotionGate = _enabled;
+    motionEnergyThreshold = _energyThreshold;
+    motionAreaThreshold = _areaThreshold;
+}
+
+//--------------------------------------------------------------
+void DepthCapture::setObstacleGrid(int _width, int _height) {
+    obstacleWidth = max(_width, 0);
+    obstacleHeight = max(_height, 0);
+}
+
+//--------------------------------------------------------------
+void DepthCapture::setSparseFlow(bool _enabled, float _pointSpacing, int _maxPoints, int _windowRadius, int _numLevels) {
+    bSparseFlow = _enabled;
+    flowPointSpacing = _pointSpacing;
+    maxFlowPoints = _maxPoints;
+    flowWindowRadius = _windowRadius;
+    flowLevels = _numLevels;
+}
+
+//--------------------------------------------------------------
+bool DepthCapture::update() {
+    if (!source)
+        return false;
+    if (!bThreaded)
+        captureFrame();
+    return frames.acquire();
+}
+
+//--------------------------------------------------------------
+void DepthCapture::captureLoop() {
+    while (bRunning) {
+        bool bNew = captureFrame();
+        if (bSupervised)
+            superviseSource();
+        // sources pace themselves, poll well above any sensor rate
+        if (!bNew)
+            this_thread::sleep_for(chrono::milliseconds(1));
+    }
+}
+
+//--------------------------------------------------------------
+bool DepthCapture::captureFrame() {
+    uint64_t start = ofGetElapsedTimeMicros();
+    source->update();
+    if (!source->isFrameNew())
+        return false;
+    uint64_t now = ofGetElapsedTimeMicros();
+    supervisor.frameArrived(now / 1000000.0);
+
+    if (lastCaptureMicros > 0 && !source->isFixedStep()) {
+        double period = 1000000.0 / max(source->getFps(), 1.0f);
+        int missed = (int)((now - lastCaptureMicros) / period + 0.5) - 1;
+        if (missed > 0)
+            numDroppedAtSource += missed;
+    }
+    lastCaptureMicros = now;
+    numCaptured++;
+
+    const ofShortPixels& raw = source->getRawDepthPixels();
+    if (bRecording) {
+        lock_guard<mutex> lock(recorderMutex);
+        if (recorder.isRecording()) {
+            FramePool<uint16_t>::Buffer frame = rawPool.acquire();
+            memcpy(frame.getData(), raw.getData(), raw.getTotalBytes());
+            recorder.addFrame(frame, lastCaptureMicros - recordStartMicros);
+        }
+    }
+
+    if (bMotionGate) {
+        // a new dilation changes the mask without anything moving, the gate checks the band itself
+        if (dilation != bandPass.getDilation())
+            motionGate.reset();
+        motionGate.setThresholds(motionEnergyThreshold, motionAreaThreshold);
+        if (!motionGate.update(raw, nearMm, farMm)) {
+            numSkippedStill++;
+            return true;
+        }
+    }
+
+    DepthFrame& frame = frames.getWriteBuffer();
+    processFrame(frame, (now - start) / 1000.0f);
+    if (!frames.publish())
+        numDroppedAtHandoff++;
+    return true;
+}
+
+//--------------------------------------------------------------
+void DepthCapture::processFrame(DepthFrame& _frame, float _sourceMillis) {
+    _frame.frameNum = source->getFrameNum();
+    _frame.captureMicros = lastCaptureMicros;
+    _frame.sourceMillis = _sourceMillis;
+    _frame.motionEnergy = bMotionGate ? motionGate.getEnergy() : 0;
+
+    stageFrame = &_frame;
+    stages.run();
+    stageFrame = nullptr;
+
+    _frame.depthImageMillis = stages.getMillis(CAPTURE_STAGE_DEPTH_IMAGE);
+    _frame.bandPassMillis = stages.getMillis(CAPTURE_STAGE_BAND_PASS);
+    _frame.obstacleMillis = stages.getMillis(CAPTURE_STAGE_OBSTACLE_GRID);
+    _frame.blobsMillis = stages.getMillis(CAPTURE_STAGE_BLOBS);
+    _frame.sparseFlowMillis = stages.getMillis(CAPTURE_STAGE_SPARSE_FLOW);
+}
+
+//--------------------------------------------------------------
+void DepthCapture::superviseSource() {
+    if (!supervisor.isReopenDue(source->isConnected(), ofGetElapsedTimeMicros() / 1000000.0))
+        return;
+
+    SourceSupervisor::Status status = supervisor.getStatus(ofGetElapsedTimeMicros() / 1000000.0);
+    ofLogWarning("DepthCapture") << source->getName() << " " << SourceSupervisor::getStateName(status.state) << " for "
+                                 << ofToString(status.secondsLost, 1) << "s, reopening (attempt " << status.numAttempts + 1 << ")";
+
+    // device i/o stays on this thread, the render thread draws on with the last frame
+    source->close();
+    bool bOpened = source->open() && source->isConnected();
+    supervisor.reopened(bOpened, ofGetElapsedTimeMicros() / 1000000.0);
+    if (bOpened) {
+        // the outage is a gap, not frames dropped at the source, and whatever is in front of it now passes the gate
+        lastCaptureMicros = 0;
+        motionGate.reset();
+    }
+}
+
+//--------------------------------------------------------------
+SourceSupervisor::Status DepthCapture::getSourceStatus() const {
+    if (!bSupervised)
+        return SourceSupervisor::Status();
+    return supervisor.getStatus(ofGetElapsedTimeMicros() / 1000000.0);
+}
+
+//--------------------------------------------------------------
+bool DepthCapture::startRecording(const string& _path) {
+    lock_guard<mutex> lock(recorderMutex);
+    recordStartMicros = ofGetElapsedTimeMicros();
+    bRecording = recorder.open(_path, source->getWidth(), source->getHeight(), source->getFps());
+    return bRecording;
+}
+
+//--------------------------------------------------------------
+void DepthCapture::stopRecording() {
+    lock_guard<mutex> lock(recorderMutex);
+    bRecording = false;
+    if (recorder.isRecording())
+        recorder.close();
+}
+
+//--------------------------------------------------------------
+DepthCapture::Stats DepthCapture::getStats() const {
+    Stats stats;
+    stats.numCaptured = numCaptured;
+    stats.numSkippedStill = numSkippedStill;
+    stats.numDroppedAtSource = numDroppedAtSource;
+    stats.numDroppedAtHandoff = numDroppedAtHandoff;
+    stats.numDroppedAtRecorder = recorder.getNumDropped();
+    stats.bRecorderFailed = recorder.hasFailed();
+    FramePool<unsigned char>::Stats depthStats = depthPool.getStats();
+    FramePool<uint16_t>::Stats rawStats = rawPool.getStats();
+    stats.numPoolBuffers = depthStats.numBuffers + rawStats.numBuffers;
+    stats.poolBytes = depthStats.bytes + rawStats.bytes;
+    stats.peakPoolBytes = depthStats.peakBytes + rawStats.peakBytes;
+    return stats;
+}
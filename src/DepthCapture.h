@@ -0,0 +1,172 @@
+#pragma once
+
+#include "ofMain.h"
+#include "DepthSource.h"
+#include "DepthBandPass.h"
+#include "MotionGate.h"
+#include "DepthRecorder.h"
+#include "TripleBuffer.h"
+#include "ObstacleMap.h"
+#include "BlobFinder.h"
+#include "SparseFlow.h"
+#include "SourceSupervisor.h"
+#include "FramePool.h"
+#include "StageGraph.h"
+#include "ThreadPool.h"
+
+// Everything the render thread needs from one depth frame
+struct DepthFrame {
+    DepthFrame() : frameNum(0), captureMicros(0), sourceMillis(0), depthImageMillis(0), bandPassMillis(0), obstacleMillis(0), blobsMillis(0), sparseFlowMillis(0), motionEnergy(0), flowPointSpacing(0) {}
+
+    FramePool<unsigned char>::Buffer depth;	// 8 bit, near is white, empty until the first frame
+    ofPixels			mask;			// band-passed and dilated
+    ofPixels			obstacle;		// the mask at the obstacle grid size, empty while that is off
+    vector<Blob>		blobs;			// of the mask, tracked; contours only while traced
+    vector<FlowPoint>	flowPoints;		// along the contours since the last frame, empty unless the sparse flow is on
+
+    uint64_t			frameNum;		// as counted by the source
+    uint64_t			captureMicros;
+    float				sourceMillis;	// time spent in each stage on the capture side, 0 when switched off
+    float				depthImageMillis;
+    float				bandPassMillis;
+    float				obstacleMillis;
+    float				blobsMillis;
+    float				sparseFlowMillis;
+    float				motionEnergy;	// change against the last processed frame, see MotionGate
+    float				flowPointSpacing;	// pixels between the flow points, wider than asked when capped
+};
+
+// The preprocessing stages, in the order they are declared
+enum captureStageEnum{
+    CAPTURE_STAGE_DEPTH_IMAGE = 0,
+    CAPTURE_STAGE_BAND_PASS,
+    CAPTURE_STAGE_OBSTACLE_GRID,
+    CAPTURE_STAGE_BLOBS,
+    CAPTURE_STAGE_SPARSE_FLOW
+};
+
+// Pulls frames from a depth source, records them and runs the CPU
+// preprocessing (band-pass, dilation, blobs) on a worker thread. Finished
+// frames are handed to the render thread through a triple buffer, so neither
+// a slow sensor read nor a big contour pass can stall a display frame, and
+// the next frame is prepared while the render thread simulates this one.
+//
+// The preprocessing is a stage graph: the 8 bit depth image and the band
+// pass both only read the raw frame and run side by side, as do the
+// obstacle grid and the blobs, which both only read the mask. Stages can be
+// switched off by name from the render thread. With the sparse flow on, the
+// points along the blob contours are tracked from the last processed frame
+// as the last stage, split across the same threads.
+//
+// The 8 bit depth image and the raw frames queued for the recorder come out
+// of pools, so frames are converted or copied once, straight into a buffer
+// that is reused as soon as the last holder lets go of it.
+//
+// With the motion gate on, frames that hardly differ from the last processed
+// one are recorded but neither processed nor handed over, so everything
+// downstream of update() idles along with the scene.
+//
+// A live sensor is watched by a supervisor on the capture thread. When it is
+// unplugged or stops delivering it is closed and opened again with backoff,
+// while the render thread keeps the last frame.
+//
+// Without a thread update() does the same work inline, one frame per call,
+// which keeps fixed step runs deterministic. Sensors aren't reopened then,
+// that would block the render thread.
+class DepthCapture {
+public:
+    DepthCapture();
+    ~DepthCapture();
+
+    struct Stats {
+        Stats() : numCaptured(0), numSkippedStill(0), numDroppedAtSource(0), numDroppedAtHandoff(0), numDroppedAtRecorder(0), bRecorderFailed(false), numPoolBuffers(0), poolBytes(0), peakPoolBytes(0) {}
+        uint64_t	numCaptured;
+        uint64_t	numSkippedStill;		// held back by the motion gate
+        uint64_t	numDroppedAtSource;		// sensor frames missed while the worker was busy (estimated from the source rate)
+        uint64_t	numDroppedAtHandoff;	// processed frames overwritten before the render thread took them
+        uint64_t	numDroppedAtRecorder;	// frames the recorder couldn't write in time
+        bool		bRecorderFailed;		// a write failed, the recording has stopped taking frames
+        size_t		numPoolBuffers;			// depth and recorder pools together
+        size_t		poolBytes;
+        size_t		peakPoolBytes;
+    };
+
+    void			setup(shared_ptr<DepthSource> _source, bool _threaded);
+    void			stop();
+
+    void			setBandPass(int _nearMm, int _farMm, int _dilation);
+    void			setMotionGate(bool _enabled, float _energyThreshold, float _areaThreshold);
+    void			setObstacleGrid(int _width, int _height);	// 0 turns it off
+    void			setTraceContours(bool _value)	{ bTraceContours = _value; }	// of the blobs, only traced when needed
+    void			setSparseFlow(bool _enabled, float _pointSpacing, int _maxPoints, int _windowRadius, int _numLevels);
+    StageGraph&		getStages()				{ return stages; }		// to switch them on and off, by name
+
+    // render thread: captures inline when not threaded, then takes the latest frame
+    bool			update();
+    DepthFrame&		getFrame()				{ return frames.getReadBuffer(); }
+
+    bool			startRecording(const string& _path);
+    void			stopRecording();
+    bool			isRecording() const		{ return bRecording; }
+    const DepthRecorder& getRecorder() const	{ return recorder; }
+
+    bool			isThreaded() const		{ return bThreaded; }
+    bool			isSupervised() const	{ return bSupervised; }
+    Stats			getStats() const;
+    SourceSupervisor::Status getSourceStatus() const;	// always connected when not supervised
+
+protected:
+    void			captureLoop();
+    bool			captureFrame();		// false when the source had nothing new
+    void			processFrame(DepthFrame& _frame, float _sourceMillis);
+    void			setupStages();
+    void			superviseSource();
+
+    shared_ptr<DepthSource> source;
+    bool					bThreaded;
+    thread					worker;
+    atomic<bool>			bRunning;
+
+    atomic<int>				nearMm;
+    atomic<int>				farMm;
+    atomic<int>				dilation;
+    atomic<bool>			bMotionGate;
+    atomic<float>			motionEnergyThreshold;
+    atomic<float>			motionAreaThreshold;
+    atomic<int>				obstacleWidth;
+    atomic<int>				obstacleHeight;
+    atomic<bool>			bTraceContours;
+    atomic<bool>			bSparseFlow;
+    atomic<float>			flowPointSpacing;
+    atomic<int>				maxFlowPoints;
+    atomic<int>				flowWindowRadius;
+    atomic<int>				flowLevels;
+
+    // capture side only
+    StageGraph				stages;
+    ThreadPool				stagePool;
+    DepthFrame*				stageFrame;		// the frame the stages are writing
+    DepthBandPass			bandPass;
+    MotionGate				motionGate;
+    BlobFinder				blobFinder;
+    SparseFlow				sparseFlow;
+    bool					bSparseFlowRunning;		// tracking from the last frame
+    uint64_t				lastCaptureMicros;
+
+    bool					bSupervised;
+    SourceSupervisor		supervisor;
+
+    TripleBuffer<DepthFrame> frames;
+    FramePool<unsigned char> depthPool;
+    FramePool<uint16_t>		rawPool;		// frames on their way to the recorder
+
+    mutex					recorderMutex;
+    DepthRecorder			recorder;
+    uint64_t				recordStartMicros;
+    atomic<bool>			bRecording;
+
+    atomic<uint64_t>		numCaptured;
+    atomic<uint64_t>		numSkippedStill;
+    atomic<uint64_t>		numDroppedAtSource;
+    atomic<uint64_t>		numDroppedAtHandoff;
+};
@@ -0,0 +1,124 @@
+#include "DepthFilePlayer.h"
+
+
+//--------------------------------------------------------------
+DepthFilePlayer::DepthFilePlayer(const string& _path, float _fps, bool _loop, float _speed) {
+    path = _path;
+    fps = _fps;
+    folderFps = _fps;
+    speed = _speed;
+    bLoop = _loop;
+    bFinished = false;
+    numFrames = 0;
+    currentFrame = -1;
+}
+
+//--------------------------------------------------------------
+bool DepthFilePlayer::open() {
+    currentFrame = -1;
+    bFinished = false;
+
+    if (ofFilePath::getFileExt(path) == "fdr") {
+        if (!recording.open(ofToDataPath(path, true))) {
+            ofLogError("DepthFilePlayer") << "could not open recording " << path;
+            return false;
+        }
+        numFrames = recording.getNumFrames();
+        fps = recording.getFps() * speed;
+        allocate(recording.getWidth(), recording.getHeight());
+        if (!recording.wasClosedCleanly())
+            ofLogWarning("DepthFilePlayer") << path << " was not closed cleanly, recovered " << numFrames << " frames";
+        ofLogNotice("DepthFilePlayer") << "playing " << numFrames << " frames (" << width << "x" << height << ", "
+                                       << recording.getDuration() / 1000000.0 << "s, "
+                                       << recording.getCompressedSize() / (1024 * 1024) << "MB) from " << path;
+        return true;
+    }
+
+    ofDirectory dir(path);
+    if (!dir.exists()) {
+        ofLogError("DepthFilePlayer") << "recording not found: " << path;
+        return false;
+    }
+    dir.allowExt("png");
+    dir.listDir();
+    dir.sort();
+
+    framePaths.clear();
+    for (size_t i=0; i<dir.size(); i++)
+        framePaths.push_back(dir.getPath(i));
+    numFrames = framePaths.size();
+
+    if (numFrames == 0) {
+        ofLogError("DepthFilePlayer") << "no frames in " << path;
+        return false;
+    }
+
+    ofShortPixels first;
+    if (!ofLoadImage(first, framePaths[0]) || first.getNumChannels() != 1) {
+        ofLogError("DepthFilePlayer") << "frames must be 16 bit greyscale: " << framePaths[0];
+        numFrames = 0;
+        return false;
+    }
+    allocate(first.getWidth(), first.getHeight());
+
+    fps = folderFps * speed;	// not compounded when opened again
+    ofLogNotice("DepthFilePlayer") << "playing " << numFrames << " frames (" << width << "x" << height << ") from " << path;
+    return true;
+}
+
+//--------------------------------------------------------------
+void DepthFilePlayer::close() {
+    recording.close();
+    framePaths.clear();
+    numFrames = 0;
+}
+
+//--------------------------------------------------------------
+void DepthFilePlayer::update() {
+    bNewFrame = false;
+    if (numFrames == 0 || bFinished || !isFrameDue())
+        return;
+
+    int next = currentFrame + 1;
+    if (next >= numFrames) {
+        if (!bLoop) {
+            bFinished = true;
+            return;
+        }
+        next = 0;
+    }
+    if (loadFrame(next))
+        publishRawFrame();
+}
+
+//--------------------------------------------------------------
+void DepthFilePlayer::setFrame(int _frame) {
+    if (numFrames == 0)
+        return;
+    // update() advances before loading, so park one frame before the target
+    currentFrame = ofClamp(_frame, 0, numFrames - 1) - 1;
+    bFinished = false;
+}
+
+//--------------------------------------------------------------
+bool DepthFilePlayer::loadFrame(int _frame) {
+    if (recording.isOpen()) {
+        // decodes from the mapped file straight into the raw depth buffer
+        bool loaded = recording.readFrame(_frame, rawDepthPixels.getData());
+        if (!loaded)
+            ofLogWarning("DepthFilePlayer") << "skipping corrupt frame " << _frame;
+        currentFrame = _frame;
+        return loaded;
+    }
+
+    ofShortPixels frame;
+    if (!ofLoadImage(frame, framePaths[_frame]) ||
+        frame.getWidth() != width || frame.getHeight() != height || frame.getNumChannels() != 1) {
+        ofLogWarning("DepthFilePlayer") << "skipping unreadable frame " << framePaths[_frame];
+        currentFrame = _frame;
+        return false;
+    }
+    rawDepthPixels.swap(frame);
+    currentFrame = _frame;
+    return true;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "ofMain.h"
+#include "DepthSource.h"
+#include "DepthRecordingReader.h"
+
+// Replays a recorded depth session, either a .fdr recording (see
+// DepthRecording.h) or a folder of 16 bit greyscale PNG frames holding
+// millimetre depth, played in file name order. Recordings play at their
+// recorded rate times the playback speed.
+class DepthFilePlayer : public DepthSource {
+public:
+    DepthFilePlayer(const string& _path, float _fps = 30, bool _loop = true, float _speed = 1);
+
+    bool	open();
+    void	close();
+    void	update();
+    bool	isConnected() const	{ return numFrames > 0; }
+    string	getName() const		{ return "file " + path; }
+
+    int		getNumFrames() const	{ return numFrames; }
+    int		getCurrentFrame() const	{ return currentFrame; }
+    void	setFrame(int _frame);
+    bool	isFinished() const		{ return bFinished; }
+
+protected:
+    bool	loadFrame(int _frame);
+
+    string			path;
+    float			folderFps;		// of PNG folders, before the speed
+    float			speed;
+    bool			bLoop;
+    bool			bFinished;
+    int				numFrames;
+    int				currentFrame;
+    vector<string>	framePaths;
+    DepthRecordingReader recording;
+};
@@ -0,0 +1,164 @@
+#include "DepthRecorder.h"
+#include <chrono>
+#include <cstring>
+
+using namespace depthRecording;
+
+//--------------------------------------------------------------
+DepthRecorder::DepthRecorder() {
+    file = nullptr;
+    numPixels = 0;
+    keyFrameInterval = 30;
+    maxQueuedFrames = 16;
+    bClosing = false;
+    writeOffset = 0;
+    numFramesWritten = 0;
+    numFramesDropped = 0;
+    bytesWritten = 0;
+    bWriteFailed = false;
+}
+
+//--------------------------------------------------------------
+DepthRecorder::~DepthRecorder() {
+    close();
+}
+
+//--------------------------------------------------------------
+bool DepthRecorder::open(const std::string& _path, int _width, int _height, float _fps, int _keyFrameInterval) {
+    close();
+
+    file = fopen(_path.c_str(), "wb");
+    if (!file)
+        return false;
+
+    path = _path;
+    numPixels = (size_t)_width * _height;
+    keyFrameInterval = std::max(_keyFrameInterval, 1);
+
+    memset(&header, 0, sizeof(header));
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.width = _width;
+    header.height = _height;
+    header.fps = _fps;
+    header.keyFrameInterval = keyFrameInterval;
+    header.startTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    if (fwrite(&header, sizeof(header), 1, file) != 1) {
+        fclose(file);
+        file = nullptr;
+        return false;
+    }
+
+    writeOffset = sizeof(header);
+    index.clear();
+    previousFrame.reset();
+    numFramesWritten = 0;
+    numFramesDropped = 0;
+    bytesWritten = sizeof(header);
+    bWriteFailed = false;
+
+    bClosing = false;
+    writer = std::thread(&DepthRecorder::writerLoop, this);
+    return true;
+}
+
+//--------------------------------------------------------------
+bool DepthRecorder::addFrame(const FramePool<uint16_t>::Buffer& _frame, uint64_t _timestamp) {
+    if (!file || bWriteFailed || _frame.size() != numPixels)
+        return false;
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (queue.size() >= maxQueuedFrames) {
+            numFramesDropped++;
+            return false;
+        }
+        QueuedFrame frame = { _frame, _timestamp };
+        queue.push_back(std::move(frame));
+    }
+    queueCondition.notify_one();
+    return true;
+}
+
+//--------------------------------------------------------------
+void DepthRecorder::close() {
+    if (!file)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        bClosing = true;
+    }
+    queueCondition.notify_one();
+    if (writer.joinable())
+        writer.join();
+
+    // index after the last whole frame, over whatever a failed write left, then patch the header so readers can find it
+    header.numFrames = index.size();
+    header.indexOffset = writeOffset;
+    bool isIndexWritten = fseek(file, writeOffset, SEEK_SET) == 0 &&
+        (index.empty() || fwrite(index.data(), sizeof(DepthIndexEntry), index.size(), file) == index.size());
+    if (isIndexWritten) {
+        bytesWritten += index.size() * sizeof(DepthIndexEntry);
+        if (fseek(file, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, file) != 1)
+            bWriteFailed = true;
+    }
+    else {
+        bWriteFailed = true;
+    }
+    if (fclose(file) != 0)
+        bWriteFailed = true;
+    file = nullptr;
+
+    queue.clear();
+    previousFrame.reset();
+}
+
+//--------------------------------------------------------------
+void DepthRecorder::writerLoop() {
+    while (true) {
+        QueuedFrame frame;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this]{ return bClosing || !queue.empty(); });
+            if (queue.empty())
+                return;		// closing and drained
+            frame = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        writeFrame(frame);
+    }
+}
+
+//--------------------------------------------------------------
+void DepthRecorder::writeFrame(QueuedFrame& _frame) {
+    // the frames queued before a write failed go back to their pool unwritten
+    if (bWriteFailed)
+        return;
+
+    bool isKey = index.size() % keyFrameInterval == 0;
+    encodeFrame(_frame.pixels.getData(), isKey ? nullptr : previousFrame.getData(), numPixels, payload);
+
+    DepthFrameHeader frameHeader;
+    memset(&frameHeader, 0, sizeof(frameHeader));
+    frameHeader.size = payload.size();
+    frameHeader.type = isKey ? FRAME_KEY : FRAME_DELTA;
+    frameHeader.timestamp = _frame.timestamp;
+    if (fwrite(&frameHeader, sizeof(frameHeader), 1, file) != 1 || fwrite(payload.data(), 1, payload.size(), file) != payload.size()) {
+        bWriteFailed = true;
+        return;
+    }
+
+    DepthIndexEntry entry;
+    entry.offset = writeOffset;
+    entry.timestamp = _frame.timestamp;
+    entry.size = payload.size();
+    entry.type = frameHeader.type;
+    index.push_back(entry);
+
+    writeOffset += sizeof(frameHeader) + payload.size();
+    bytesWritten += sizeof(frameHeader) + payload.size();
+    numFramesWritten++;
+    previousFrame = std::move(_frame.pixels);
+}
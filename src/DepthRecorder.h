@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdio>
+#include "DepthRecording.h"
+#include "FramePool.h"
+
+// Writes raw millimetre depth frames to a .fdr recording. addFrame() queues a
+// reference to the caller's pooled buffer, which is compressed and written on
+// a background thread and goes back to its pool after that; the caller must
+// not write to it again. If the disk can't keep up the oldest queued frames
+// are kept and new ones are dropped and counted. A failed write, a full disk,
+// ends the recording: nothing more is written, the index only holds the
+// frames that were written whole, and the header is only patched once the
+// index is, so a cut off file never looks complete.
+class DepthRecorder {
+public:
+    DepthRecorder();
+    ~DepthRecorder();
+
+    bool		open(const std::string& _path, int _width, int _height, float _fps, int _keyFrameInterval = 30);
+    bool		addFrame(const FramePool<uint16_t>::Buffer& _frame, uint64_t _timestamp);	// microseconds since open
+    void		close();
+
+    bool		isRecording() const			{ return file != nullptr; }
+    std::string	getPath() const				{ return path; }
+    uint32_t	getNumFrames() const		{ return numFramesWritten; }
+    uint32_t	getNumDropped() const		{ return numFramesDropped; }
+    uint64_t	getBytesWritten() const		{ return bytesWritten; }
+    uint64_t	getRawBytes() const			{ return (uint64_t)numFramesWritten * numPixels * sizeof(uint16_t); }
+    bool		hasFailed() const			{ return bWriteFailed; }	// a write failed, from then on frames are refused
+
+protected:
+    struct QueuedFrame {
+        FramePool<uint16_t>::Buffer pixels;
+        uint64_t				timestamp;
+    };
+
+    void		writerLoop();
+    void		writeFrame(QueuedFrame& _frame);
+
+    std::string				path;
+    FILE*					file;
+    depthRecording::DepthRecordingHeader header;
+    size_t					numPixels;
+    int						keyFrameInterval;
+
+    std::thread				writer;
+    std::mutex				queueMutex;
+    std::condition_variable	queueCondition;
+    std::deque<QueuedFrame>	queue;
+    size_t					maxQueuedFrames;
+    bool					bClosing;
+
+    // writer thread only
+    FramePool<uint16_t>::Buffer previousFrame;	// the delta base, held until the next frame is written
+    std::vector<uint8_t>	payload;
+    std::vector<depthRecording::DepthIndexEntry> index;
+    uint64_t				writeOffset;
+
+    std::atomic<uint32_t>	numFramesWritten;
+    std::atomic<uint32_t>	numFramesDropped;
+    std::atomic<uint64_t>	bytesWritten;
+    std::atomic<bool>		bWriteFailed;
+};
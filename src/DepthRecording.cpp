@@ -0,0 +1,104 @@
+#include "DepthRecording.h"
+
+namespace depthRecording {
+
+    //--------------------------------------------------------------
+    static inline void writeVarint(uint32_t _value, std::vector<uint8_t>& _out) {
+        while (_value >= 0x80) {
+            _out.push_back((uint8_t)(_value | 0x80));
+            _value >>= 7;
+        }
+        _out.push_back((uint8_t)_value);
+    }
+
+    //--------------------------------------------------------------
+    static inline bool readVarint(const uint8_t*& _data, const uint8_t* _end, uint32_t& _value) {
+        uint32_t value = 0;
+        int shift = 0;
+        while (_data < _end && shift < 35) {
+            uint8_t byte = *_data++;
+            value |= (uint32_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                _value = value;
+                return true;
+            }
+            shift += 7;
+        }
+        return false;
+    }
+
+    //--------------------------------------------------------------
+    static inline uint32_t zigzag(int32_t _value)	{ return ((uint32_t)_value << 1) ^ (uint32_t)(_value >> 31); }
+    static inline int32_t unzigzag(uint32_t _value)	{ return (int32_t)(_value >> 1) ^ -(int32_t)(_value & 1); }
+
+    //--------------------------------------------------------------
+    void encodeFrame(const uint16_t* _frame, const uint16_t* _previous, size_t _numPixels, std::vector<uint8_t>& _out) {
+        _out.clear();
+
+        // residual against the prediction, previous frame or left neighbour
+        auto residual = [&](size_t _i) -> int32_t {
+            if (_previous)
+                return (int32_t)_frame[_i] - (int32_t)_previous[_i];
+            return (int32_t)_frame[_i] - (_i > 0 ? (int32_t)_frame[_i - 1] : 0);
+        };
+
+        size_t i = 0;
+        while (i < _numPixels) {
+            size_t zeroStart = i;
+            while (i < _numPixels && residual(i) == 0)
+                i++;
+            size_t numZeros = i - zeroStart;
+
+            // a lone zero is cheaper inside a literal run than as a run of its own
+            size_t literalStart = i;
+            while (i < _numPixels) {
+                if (residual(i) == 0 && (i + 1 >= _numPixels || residual(i + 1) == 0))
+                    break;
+                i++;
+            }
+            size_t numLiterals = i - literalStart;
+
+            writeVarint(numZeros, _out);
+            writeVarint(numLiterals, _out);
+            for (size_t j=literalStart; j<i; j++)
+                writeVarint(zigzag(residual(j)), _out);
+        }
+    }
+
+    //--------------------------------------------------------------
+    bool decodeFrame(const uint8_t* _data, size_t _size, FrameType _type, uint16_t* _frame, size_t _numPixels) {
+        const uint8_t* end = _data + _size;
+        size_t i = 0;
+        uint16_t left = 0;
+
+        while (i < _numPixels) {
+            uint32_t numZeros, numLiterals, value;
+            if (!readVarint(_data, end, numZeros) || !readVarint(_data, end, numLiterals))
+                return false;
+            if (numZeros + numLiterals == 0 || numZeros > _numPixels - i || numLiterals > _numPixels - i - numZeros)
+                return false;
+
+            if (_type == FRAME_KEY) {
+                for (uint32_t j=0; j<numZeros; j++)
+                    _frame[i++] = left;
+                for (uint32_t j=0; j<numLiterals; j++) {
+                    if (!readVarint(_data, end, value))
+                        return false;
+                    left = (uint16_t)(left + unzigzag(value));
+                    _frame[i++] = left;
+                }
+            }
+            else {
+                // unchanged pixels are already in place
+                i += numZeros;
+                for (uint32_t j=0; j<numLiterals; j++) {
+                    if (!readVarint(_data, end, value))
+                        return false;
+                    _frame[i] = (uint16_t)(_frame[i] + unzigzag(value));
+                    i++;
+                }
+            }
+        }
+        return true;
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// FlowGen depth recording (.fdr)
+//
+//  header       DepthRecordingHeader, patched with the frame count and index on close
+//  frames       DepthFrameHeader + compressed payload, back to back
+//  index        one DepthIndexEntry per frame, at header.indexOffset
+//
+// Key frames predict every pixel from its left neighbour, delta frames from the
+// same pixel of the previous frame. The prediction residuals are written as
+// alternating runs: varint(zero count), varint(literal count), literal count
+// zigzag varints. A still background costs a couple of bytes per row and a
+// delta frame decodes in place on top of the previous one.
+//
+// All fields are little endian, the hosts we run on.
+
+namespace depthRecording {
+
+    const uint32_t	MAGIC = 0x52444746;		// "FGDR"
+    const uint32_t	VERSION = 1;
+
+    enum FrameType {
+        FRAME_KEY = 0,
+        FRAME_DELTA = 1
+    };
+
+#pragma pack(push, 1)
+    struct DepthRecordingHeader {
+        uint32_t	magic;
+        uint32_t	version;
+        uint32_t	width;
+        uint32_t	height;
+        float		fps;
+        uint32_t	keyFrameInterval;
+        uint32_t	numFrames;
+        uint32_t	reserved0;
+        uint64_t	indexOffset;			// 0 when the recording was not closed cleanly
+        uint64_t	startTime;				// system time in microseconds
+        uint8_t		reserved[16];
+    };
+
+    struct DepthFrameHeader {
+        uint32_t	size;					// payload bytes following this header
+        uint8_t		type;
+        uint8_t		reserved[3];
+        uint64_t	timestamp;				// microseconds since the start of the recording
+    };
+
+    struct DepthIndexEntry {
+        uint64_t	offset;					// of the DepthFrameHeader
+        uint64_t	timestamp;
+        uint32_t	size;
+        uint32_t	type;
+    };
+#pragma pack(pop)
+
+    // Compresses a frame. Pass the previous frame for a delta frame, or null for a key frame.
+    void	encodeFrame(const uint16_t* _frame, const uint16_t* _previous, size_t _numPixels, std::vector<uint8_t>& _out);
+
+    // Decodes a payload into _frame. For delta frames _frame must hold the previous frame.
+    bool	decodeFrame(const uint8_t* _data, size_t _size, FrameType _type, uint16_t* _frame, size_t _numPixels);
+}
@@ -0,0 +1,197 @@
+#include "DepthRecordingReader.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace depthRecording;
+
+//--------------------------------------------------------------
+MappedFile::MappedFile() {
+    data = nullptr;
+    size = 0;
+#ifdef _WIN32
+    fileHandle = INVALID_HANDLE_VALUE;
+    mappingHandle = nullptr;
+#else
+    fd = -1;
+#endif
+}
+
+//--------------------------------------------------------------
+MappedFile::~MappedFile() {
+    close();
+}
+
+//--------------------------------------------------------------
+bool MappedFile::open(const std::string& _path) {
+    close();
+#ifdef _WIN32
+    fileHandle = CreateFileA(_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(fileHandle, &fileSize);
+    size = fileSize.QuadPart;
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle)
+        data = (const uint8_t*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+    fd = ::open(_path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        size = info.st_size;
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            data = (const uint8_t*)mapped;
+            // playback walks the file front to back
+            madvise(mapped, size, MADV_SEQUENTIAL);
+        }
+    }
+#endif
+    if (!data) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+void MappedFile::close() {
+#ifdef _WIN32
+    if (data)
+        UnmapViewOfFile(data);
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+    if (fileHandle != INVALID_HANDLE_VALUE)
+        CloseHandle(fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = INVALID_HANDLE_VALUE;
+#else
+    if (data)
+        munmap((void*)data, size);
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+#endif
+    data = nullptr;
+    size = 0;
+}
+
+//--------------------------------------------------------------
+DepthRecordingReader::DepthRecordingReader() {
+    memset(&header, 0, sizeof(header));
+    numPixels = 0;
+    lastBuffer = nullptr;
+    lastFrame = 0;
+}
+
+//--------------------------------------------------------------
+bool DepthRecordingReader::open(const std::string& _path) {
+    close();
+    if (!file.open(_path) || file.getSize() < sizeof(header))
+        return false;
+
+    memcpy(&header, file.getData(), sizeof(header));
+    if (header.magic != MAGIC || header.version > VERSION || header.width == 0 || header.height == 0) {
+        close();
+        return false;
+    }
+    numPixels = (size_t)header.width * header.height;
+
+    uint64_t indexBytes = (uint64_t)header.numFrames * sizeof(DepthIndexEntry);
+    if (header.indexOffset != 0 && header.indexOffset + indexBytes <= file.getSize()) {
+        const DepthIndexEntry* entries = (const DepthIndexEntry*)(file.getData() + header.indexOffset);
+        index.assign(entries, entries + header.numFrames);
+    }
+    else if (!rebuildIndex()) {
+        close();
+        return false;
+    }
+    return !index.empty();
+}
+
+//--------------------------------------------------------------
+void DepthRecordingReader::close() {
+    file.close();
+    index.clear();
+    lastBuffer = nullptr;
+}
+
+//--------------------------------------------------------------
+bool DepthRecordingReader::rebuildIndex() {
+    // the recorder died before writing the index, walk the frames instead
+    index.clear();
+    uint64_t offset = sizeof(header);
+    while (offset + sizeof(DepthFrameHeader) <= file.getSize()) {
+        DepthFrameHeader frameHeader;
+        memcpy(&frameHeader, file.getData() + offset, sizeof(frameHeader));
+        uint64_t next = offset + sizeof(frameHeader) + frameHeader.size;
+        if (next > file.getSize() || frameHeader.type > FRAME_DELTA)
+            break;		// truncated last frame
+
+        DepthIndexEntry entry;
+        entry.offset = offset;
+        entry.timestamp = frameHeader.timestamp;
+        entry.size = frameHeader.size;
+        entry.type = frameHeader.type;
+        index.push_back(entry);
+        offset = next;
+    }
+    // a recording has to start on a key frame to be playable
+    return !index.empty() && index[0].type == FRAME_KEY;
+}
+
+//--------------------------------------------------------------
+size_t DepthRecordingReader::findFrame(uint64_t _timestamp) const {
+    if (index.empty())
+        return 0;
+    auto it = std::upper_bound(index.begin(), index.end(), _timestamp,
+                               [](uint64_t _t, const DepthIndexEntry& _e) { return _t < _e.timestamp; });
+    return it == index.begin() ? 0 : (it - index.begin()) - 1;
+}
+
+//--------------------------------------------------------------
+bool DepthRecordingReader::readFrame(size_t _frame, uint16_t* _pixels) {
+    if (_frame >= index.size())
+        return false;
+
+    size_t start;
+    if (index[_frame].type == FRAME_KEY)
+        start = _frame;
+    else if (lastBuffer == _pixels && lastFrame < _frame && _frame - lastFrame <= header.keyFrameInterval)
+        start = lastFrame + 1;		// apply the deltas since the frame already in the buffer
+    else {
+        start = _frame;
+        while (start > 0 && index[start].type != FRAME_KEY)
+            start--;
+    }
+
+    for (size_t f=start; f<=_frame; f++) {
+        if (!decode(f, _pixels)) {
+            lastBuffer = nullptr;
+            return false;
+        }
+    }
+    lastBuffer = _pixels;
+    lastFrame = _frame;
+    return true;
+}
+
+//--------------------------------------------------------------
+bool DepthRecordingReader::decode(size_t _frame, uint16_t* _pixels) {
+    const DepthIndexEntry& entry = index[_frame];
+    uint64_t payload = entry.offset + sizeof(DepthFrameHeader);
+    if (payload + entry.size > file.getSize())
+        return false;
+    return decodeFrame(file.getData() + payload, entry.size, (FrameType)entry.type, _pixels, numPixels);
+}
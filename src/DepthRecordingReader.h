@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "DepthRecording.h"
+
+// Read only memory mapping of a whole file.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool			open(const std::string& _path);
+    void			close();
+
+    const uint8_t*	getData() const		{ return data; }
+    size_t			getSize() const		{ return size; }
+    bool			isOpen() const		{ return data != nullptr; }
+
+protected:
+    const uint8_t*	data;
+    size_t			size;
+#ifdef _WIN32
+    void*			fileHandle;
+    void*			mappingHandle;
+#else
+    int				fd;
+#endif
+};
+
+// Plays back a .fdr recording from a memory mapping. Frames decode straight
+// from the mapped pages into the caller's buffer. Reading frames in order
+// only applies each delta on top of the buffer, seeking decodes forward from
+// the nearest key frame.
+class DepthRecordingReader {
+public:
+    DepthRecordingReader();
+
+    bool		open(const std::string& _path);
+    void		close();
+    bool		isOpen() const				{ return file.isOpen(); }
+
+    int			getWidth() const			{ return header.width; }
+    int			getHeight() const			{ return header.height; }
+    float		getFps() const				{ return header.fps; }
+    size_t		getNumFrames() const		{ return index.size(); }
+    uint64_t	getTimestamp(size_t _frame) const	{ return index[_frame].timestamp; }
+    uint64_t	getDuration() const			{ return index.empty() ? 0 : index.back().timestamp; }
+    uint64_t	getCompressedSize() const	{ return file.getSize(); }
+    bool		wasClosedCleanly() const	{ return header.indexOffset != 0; }
+
+    // frame at or before a timestamp in microseconds
+    size_t		findFrame(uint64_t _timestamp) const;
+
+    // Decodes a frame into _pixels (width * height values). The reader
+    // remembers which frame the buffer holds, keep passing the same buffer
+    // for the in place delta path.
+    bool		readFrame(size_t _frame, uint16_t* _pixels);
+
+protected:
+    bool		rebuildIndex();
+    bool		decode(size_t _frame, uint16_t* _pixels);
+
+    MappedFile	file;
+    depthRecording::DepthRecordingHeader header;
+    std::vector<depthRecording::DepthIndexEntry> index;
+    size_t		numPixels;
+
+    const uint16_t*	lastBuffer;
+    size_t		lastFrame;
+};
@@ -0,0 +1,160 @@
+#include "DepthSource.h"
+#include "KinectDepthSource.h"
+#include "DepthFilePlayer.h"
+#include "SyntheticDepthSource.h"
+
+
+//--------------------------------------------------------------
+DepthSourceSettings::DepthSourceSettings() {
+    type = DEPTH_SOURCE_KINECT;
+    width = 640;
+    height = 480;
+    fps = 30;
+    speed = 1;
+    fixedStep = false;
+    stepRate = 0;
+    loop = true;
+    numBlobs = 3;
+    nearClip = 500;
+    farClip = 4000;
+}
+
+//--------------------------------------------------------------
+bool DepthSourceSettings::setType(const string& _name) {
+    if      (_name == "kinect")	type = DEPTH_SOURCE_KINECT;
+    else if (_name == "file")	type = DEPTH_SOURCE_FILE;
+    else if (_name == "blobs")	type = DEPTH_SOURCE_BLOBS;
+    else if (_name == "noise")	type = DEPTH_SOURCE_NOISE;
+    else if (_name == "still")	type = DEPTH_SOURCE_STILL;
+    else return false;
+    return true;
+}
+
+//--------------------------------------------------------------
+string DepthSourceSettings::getTypeName() const {
+    switch (type) {
+        case DEPTH_SOURCE_KINECT:	return "kinect";
+        case DEPTH_SOURCE_FILE:		return "file";
+        case DEPTH_SOURCE_BLOBS:	return "blobs";
+        case DEPTH_SOURCE_NOISE:	return "noise";
+        case DEPTH_SOURCE_STILL:	return "still";
+    }
+    return "unknown";
+}
+
+//--------------------------------------------------------------
+DepthSource::DepthSource() {
+    width = 0;
+    height = 0;
+    fps = 30;
+    bFixedStep = false;
+    stepSeconds = 0;
+    stepTime = 0;
+    bNewFrame = false;
+    frameNum = 0;
+    nextFrameTime = 0;
+    nearClip = 500;
+    farClip = 4000;
+}
+
+//--------------------------------------------------------------
+shared_ptr<DepthSource> DepthSource::create(const DepthSourceSettings& _settings) {
+    shared_ptr<DepthSource> source;
+    switch (_settings.type) {
+        case DEPTH_SOURCE_KINECT:
+            source = make_shared<KinectDepthSource>(_settings.device);
+            break;
+        case DEPTH_SOURCE_FILE:
+            source = make_shared<DepthFilePlayer>(_settings.path, _settings.fps, _settings.loop, _settings.speed);
+            break;
+        case DEPTH_SOURCE_BLOBS:
+        case DEPTH_SOURCE_NOISE:
+        case DEPTH_SOURCE_STILL:
+            source = make_shared<SyntheticDepthSource>(_settings);
+            break;
+    }
+    source->setFixedStep(_settings.fixedStep, _settings.stepRate);
+    source->setDepthClipping(_settings.nearClip, _settings.farClip);
+    return source;
+}
+
+//--------------------------------------------------------------
+bool DepthSource::restart() {
+    close();
+    frameNum = 0;
+    stepTime = 0;
+    nextFrameTime = 0;
+    return open();
+}
+
+//--------------------------------------------------------------
+void DepthSource::setDepthClipping(float _nearClip, float _farClip) {
+    nearClip = _nearClip;
+    farClip = _farClip;
+
+    depthLookup.resize(numeric_limits<unsigned short>::max() + 1);
+    depthLookup[0] = 0;
+    for (size_t i=1; i<depthLookup.size(); i++) {
+        if (i < nearClip || i > farClip)
+            depthLookup[i] = 0;
+        else
+            depthLookup[i] = ofMap(i, nearClip, farClip, 255, 0, true);
+    }
+}
+
+//--------------------------------------------------------------
+void DepthSource::allocate(int _width, int _height) {
+    width = _width;
+    height = _height;
+    rawDepthPixels.allocate(width, height, 1);
+    rawDepthPixels.set(0);
+    if (depthLookup.empty())
+        setDepthClipping(nearClip, farClip);
+}
+
+//--------------------------------------------------------------
+void DepthSource::setFixedStep(bool _value, float _stepRate) {
+    bFixedStep = _value;
+    stepSeconds = _stepRate > 0 ? 1.0 / _stepRate : 0;
+    stepTime = 0;
+    nextFrameTime = 0;
+}
+
+//--------------------------------------------------------------
+bool DepthSource::isFrameDue() {
+    if (bFixedStep) {
+        if (stepSeconds <= 0)
+            return true;
+        // the source rate on the time of the run rather than the clock
+        bool bDue = stepTime >= nextFrameTime;
+        if (bDue)
+            nextFrameTime += 1.0 / fps;
+        stepTime += stepSeconds;
+        return bDue;
+    }
+
+    float now = ofGetElapsedTimef();
+    if (now < nextFrameTime)
+        return false;
+
+    nextFrameTime += 1.0 / fps;
+    // don't try to catch up after a stall, just resume at the source rate
+    if (nextFrameTime < now)
+        nextFrameTime = now + 1.0 / fps;
+    return true;
+}
+
+//--------------------------------------------------------------
+void DepthSource::getDepthImage(unsigned char* _depth) const {
+    const unsigned short* raw = rawDepthPixels.getData();
+    const unsigned char* lookup = depthLookup.data();
+    size_t numPixels = (size_t)width * height;
+    for (size_t i=0; i<numPixels; i++)
+        _depth[i] = lookup[raw[i]];
+}
+
+//--------------------------------------------------------------
+void DepthSource::publishRawFrame() {
+    bNewFrame = true;
+    frameNum++;
+}
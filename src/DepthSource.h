@@ -0,0 +1,86 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Input source types selectable from the command line (--source)
+enum depthSourceTypeEnum {
+    DEPTH_SOURCE_KINECT = 0,
+    DEPTH_SOURCE_FILE,
+    DEPTH_SOURCE_BLOBS,
+    DEPTH_SOURCE_NOISE,
+    DEPTH_SOURCE_STILL
+};
+
+struct DepthSourceSettings {
+    DepthSourceSettings();
+
+    depthSourceTypeEnum type;
+    string  device;         // kinect serial or index, empty opens the first available
+    string  path;           // recording to replay, or image for the still source
+    int     width;          // generator resolution (kinect and files use their own)
+    int     height;
+    float   fps;            // generator rate, and playback rate of PNG folders
+    float   speed;          // playback speed of recordings
+    bool    fixedStep;      // produce a frame on every update() instead of pacing on the clock
+    float   stepRate;       // updates per second of a fixed step run, paces the frames on that time; 0 gives one every update
+    bool    loop;
+    int     numBlobs;
+    float   nearClip;       // millimetre range mapped onto the 8 bit depth image
+    float   farClip;
+
+    bool    setType(const string& _name);
+    string  getTypeName() const;
+};
+
+// A source of depth frames. Every source delivers raw depth in millimetres
+// (0 means no reading) and converts it to an 8 bit image where near is white
+// on request, the same conventions ofxKinect uses with registration enabled.
+class DepthSource {
+public:
+    DepthSource();
+    virtual ~DepthSource() {}
+
+    virtual bool	open() = 0;
+    bool			restart();		// closes and opens again at the first frame, for repeatable runs
+    virtual void	close() {}
+    virtual void	update() = 0;
+    virtual bool	isConnected() const = 0;
+    virtual bool	isLive() const			{ return false; }	// a device that can drop out and be opened again
+    virtual string	getName() const = 0;
+
+    bool			isFrameNew() const		{ return bNewFrame; }
+    uint64_t		getFrameNum() const		{ return frameNum; }
+    int				getWidth() const		{ return width; }
+    int				getHeight() const		{ return height; }
+    float			getFps() const			{ return fps; }
+
+    ofShortPixels&	getRawDepthPixels()		{ return rawDepthPixels; }
+    void			getDepthImage(unsigned char* _depth) const;	// the raw frame in 8 bit, width * height bytes
+
+    void			setFixedStep(bool _value, float _stepRate = 0);
+    bool			isFixedStep() const		{ return bFixedStep; }
+    void			setDepthClipping(float _nearClip, float _farClip);
+
+    static shared_ptr<DepthSource> create(const DepthSourceSettings& _settings);
+
+protected:
+    void			allocate(int _width, int _height);
+    bool			isFrameDue();
+    void			publishRawFrame();	// marks the frame new
+
+    int				width;
+    int				height;
+    float			fps;
+    bool			bFixedStep;
+    float			stepSeconds;		// of a fixed step update, 0 when every update gets a frame
+    double			stepTime;			// advanced by stepSeconds per update
+    bool			bNewFrame;
+    uint64_t		frameNum;
+    float			nextFrameTime;
+
+    float			nearClip;
+    float			farClip;
+
+    ofShortPixels	rawDepthPixels;
+    vector<unsigned char> depthLookup;	// millimetre -> 8 bit
+};
@@ -0,0 +1,162 @@
+#include "DirtyRegion.h"
+
+
+//--------------------------------------------------------------
+DirtyRegion::DirtyRegion() {
+    width = 0;
+    height = 0;
+    bEnabled = true;
+    padding = 0.05;
+    holdFrames = 30;
+    bScissor = false;
+    clearFbo = 0;
+}
+
+//--------------------------------------------------------------
+DirtyRegion::~DirtyRegion() {
+    if (clearFbo)
+        glDeleteFramebuffers(1, &clearFbo);
+}
+
+//--------------------------------------------------------------
+void DirtyRegion::setup(int _width, int _height) {
+    width = max(_width, 1);
+    height = max(_height, 1);
+    reset();
+}
+
+//--------------------------------------------------------------
+void DirtyRegion::setEnabled(bool _enabled) {
+    if (_enabled == bEnabled)
+        return;
+    bEnabled = _enabled;
+    reset();
+}
+
+//--------------------------------------------------------------
+void DirtyRegion::reset() {
+    history.clear();
+    if (bEnabled)
+        bounds.set(0, 0, 0, 0);
+    else
+        bounds.set(0, 0, 1, 1);
+}
+
+//--------------------------------------------------------------
+void DirtyRegion::update(const vector<Blob>& _blobs) {
+    if (!bEnabled)
+        return;
+
+    // padded in pixels of the larger side, so the margin is even on both axes
+    float padX = padding * max(width, height) / width;
+    float padY = padding * max(width, height) / height;
+    ofRectangle frame(0, 0, 0, 0);
+    for (const Blob& blob : _blobs) {
+        const ofRectangle& rect = blob.bounds;
+        ofRectangle padded(rect.x / (float)width - padX, rect.y / (float)height - padY,
+                           rect.width / (float)width + 2 * padX, rect.height / (float)height + 2 * padY);
+        padded = padded.getIntersection(ofRectangle(0, 0, 1, 1));
+        if (frame.isEmpty())
+            frame = padded;
+        else
+            frame.growToInclude(padded);
+    }
+
+    history.push_back(frame);
+    while ((int)history.size() > holdFrames)
+        history.pop_front();
+
+    bounds.set(0, 0, 0, 0);
+    for (const ofRectangle& rect : history) {
+        if (rect.isEmpty())
+            continue;
+        if (bounds.isEmpty())
+            bounds = rect;
+        else
+            bounds.growToInclude(rect);
+    }
+}
+
+//--------------------------------------------------------------
+bool DirtyRegion::isFull() const {
+    return bounds.x <= 0 && bounds.y <= 0 && bounds.getRight() >= 1 && bounds.getBottom() >= 1;
+}
+
+//--------------------------------------------------------------
+ofRectangle DirtyRegion::getBounds(int _width, int _height, bool _flipX) const {
+    float x = _flipX ? 1 - bounds.getRight() : bounds.x;
+    int left = max((int)floor(x * _width), 0);
+    int top = max((int)floor(bounds.y * _height), 0);
+    int right = min((int)ceil((x + bounds.width) * _width), _width);
+    int bottom = min((int)ceil(bounds.getBottom() * _height), _height);
+    if (isEmpty() || right <= left || bottom <= top)
+        return ofRectangle(0, 0, 0, 0);
+    return ofRectangle(left, top, right - left, bottom - top);
+}
+
+//--------------------------------------------------------------
+void DirtyRegion::beginScissor(int _width, int _height, bool _flipX) {
+    if (isFull())
+        return;
+
+    // fbos are drawn top row first, their pixel rows match the frame's
+    ofRectangle rect = getBounds(_width, _height, _flipX);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(rect.x, rect.y, rect.width, rect.height);
+    bScissor = true;
+}
+
+//--------------------------------------------------------------
+void DirtyRegion::endScissor() {
+    if (!bScissor)
+        return;
+    glDisable(GL_SCISSOR_TEST);
+    bScissor = false;
+}
+
+//--------------------------------------------------------------
+void DirtyRegion::clearOutside(ofTexture& _texture, bool _flipX) {
+    if (isFull() || !_texture.isAllocated())
+        return;
+
+    int textureWidth = _texture.getWidth();
+    int textureHeight = _texture.getHeight();
+    ofRectangle inside = getBounds(textureWidth, textureHeight, _flipX);
+
+    // the textures belong to flowtools' own fbos, they are attached to a spare one to clear them
+    if (!clearFbo)
+        glGenFramebuffers(1, &clearFbo);
+    GLint previousFbo;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFbo);
+    GLfloat previousColor[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, previousColor);
+
+    const ofTextureData& data = _texture.getTextureData();
+    glBindFramebuffer(GL_FRAMEBUFFER, clearFbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, data.textureTarget, data.textureID, 0);
+    glClearColor(0, 0, 0, 0);
+    glEnable(GL_SCISSOR_TEST);
+
+    // up to four bands around the region
+    vector<ofRectangle> bands;
+    if (inside.isEmpty()) {
+        bands.push_back(ofRectangle(0, 0, textureWidth, textureHeight));
+    }
+    else {
+        bands.push_back(ofRectangle(0, 0, textureWidth, inside.y));
+        bands.push_back(ofRectangle(0, inside.getBottom(), textureWidth, textureHeight - inside.getBottom()));
+        bands.push_back(ofRectangle(0, inside.y, inside.x, inside.height));
+        bands.push_back(ofRectangle(inside.getRight(), inside.y, textureWidth - inside.getRight(), inside.height));
+    }
+    for (const ofRectangle& band : bands) {
+        if (band.width <= 0 || band.height <= 0)
+            continue;
+        glScissor(band.x, band.y, band.width, band.height);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+
+    glDisable(GL_SCISSOR_TEST);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, data.textureTarget, 0, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFbo);
+    glClearColor(previousColor[0], previousColor[1], previousColor[2], previousColor[3]);
+}
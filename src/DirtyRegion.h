@@ -0,0 +1,52 @@
+#pragma once
+
+#include "ofMain.h"
+#include "BlobFinder.h"
+
+// The part of the frame worth running the flow and mask passes on: the union
+// of the blob bounds, padded, over the last few depth frames. Growing is
+// immediate, shrinking waits until the old bounds have left the history, so
+// a silhouette that briefly drops out of the mask keeps its region.
+//
+// Passes are restricted with a scissor in their own target's pixels. A
+// scissor leaves everything outside untouched, so outputs that are read
+// downstream are cleared outside the region after the pass; ping-pong buffers
+// would otherwise hand out the content of older frames there.
+class DirtyRegion {
+public:
+    DirtyRegion();
+    ~DirtyRegion();
+
+    void			setup(int _width, int _height);			// in source pixels, as the blobs
+    void			setEnabled(bool _enabled);				// disabled covers the whole frame
+    void			setPadding(float _padding)				{ padding = _padding; }		// fraction of the larger side
+    void			setHoldFrames(int _frames)				{ holdFrames = max(_frames, 1); }
+    void			reset();
+
+    void			update(const vector<Blob>& _blobs);
+
+    bool			isEnabled() const		{ return bEnabled; }
+    bool			isEmpty() const			{ return bounds.isEmpty(); }
+    bool			isFull() const;
+    float			getCoverage() const		{ return bounds.getArea(); }
+    const ofRectangle& getBounds() const	{ return bounds; }			// normalized
+    ofRectangle		getBounds(int _width, int _height, bool _flipX) const;	// whole pixels, rounded outwards
+
+    // restricts everything drawn in between to the region, for targets of the given size
+    void			beginScissor(int _width, int _height, bool _flipX);
+    void			endScissor();
+    void			clearOutside(ofTexture& _texture, bool _flipX);
+
+protected:
+    int				width;
+    int				height;
+    bool			bEnabled;
+    float			padding;
+    int				holdFrames;
+
+    deque<ofRectangle> history;		// padded union of each frame, newest last
+    ofRectangle		bounds;
+
+    bool			bScissor;
+    GLuint			clearFbo;
+};
@@ -0,0 +1,206 @@
+#include "FieldExport.h"
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#endif
+
+using namespace fieldExport;
+
+//--------------------------------------------------------------
+size_t fieldExport::getSlotBytes(int _fieldWidth, int _fieldHeight, int _maxContours, int _maxPoints) {
+    size_t bytes = sizeof(SlotHeader);
+    bytes += (size_t)NUM_FIELDS * _fieldWidth * _fieldHeight * 2 * sizeof(float);
+    bytes += (size_t)_maxContours * sizeof(uint32_t);
+    bytes += (size_t)_maxPoints * 2 * sizeof(float);
+    // keep every slot header 64 bit aligned
+    return (bytes + 63) & ~(size_t)63;
+}
+
+//--------------------------------------------------------------
+size_t fieldExport::getRegionBytes(int _fieldWidth, int _fieldHeight, int _maxContours, int _maxPoints, int _numSlots) {
+    return sizeof(ExportHeader) + getSlotBytes(_fieldWidth, _fieldHeight, _maxContours, _maxPoints) * _numSlots;
+}
+
+//--------------------------------------------------------------
+SharedMemory::SharedMemory() {
+    data = nullptr;
+    size = 0;
+    bCreated = false;
+#ifdef _WIN32
+    mappingHandle = nullptr;
+#else
+    fd = -1;
+#endif
+}
+
+//--------------------------------------------------------------
+SharedMemory::~SharedMemory() {
+    close();
+}
+
+//--------------------------------------------------------------
+bool SharedMemory::create(const std::string& _name, size_t _size) {
+    close();
+    name = _name[0] == '/' ? _name : "/" + _name;
+#ifdef _WIN32
+    std::string mappingName = "Local\\" + name.substr(1);
+    mappingHandle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, (DWORD)((uint64_t)_size >> 32), (DWORD)_size, mappingName.c_str());
+    if (mappingHandle)
+        data = (uint8_t*)MapViewOfFile(mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, _size);
+#else
+    // a fresh object, readers still mapping an old one notice it closed
+    shm_unlink(name.c_str());
+    fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+        return false;
+    if (ftruncate(fd, _size) == 0) {
+        void* mapped = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapped != MAP_FAILED)
+            data = (uint8_t*)mapped;
+    }
+#endif
+    bCreated = true;
+    if (!data) {
+        close();
+        return false;
+    }
+    size = _size;
+    memset(data, 0, size);
+    return true;
+}
+
+//--------------------------------------------------------------
+bool SharedMemory::open(const std::string& _name) {
+    close();
+    name = _name[0] == '/' ? _name : "/" + _name;
+#ifdef _WIN32
+    std::string mappingName = "Local\\" + name.substr(1);
+    mappingHandle = OpenFileMappingA(FILE_MAP_READ, FALSE, mappingName.c_str());
+    if (mappingHandle) {
+        data = (uint8_t*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+        MEMORY_BASIC_INFORMATION info;
+        if (data && VirtualQuery(data, &info, sizeof(info)))
+            size = info.RegionSize;
+    }
+#else
+    fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapped != MAP_FAILED) {
+            data = (uint8_t*)mapped;
+            size = info.st_size;
+        }
+    }
+#endif
+    if (!data) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+void SharedMemory::close() {
+#ifdef _WIN32
+    if (data)
+        UnmapViewOfFile(data);
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+    mappingHandle = nullptr;
+#else
+    if (data)
+        munmap(data, size);
+    if (fd >= 0)
+        ::close(fd);
+    if (bCreated)
+        shm_unlink(name.c_str());
+    fd = -1;
+#endif
+    data = nullptr;
+    size = 0;
+    bCreated = false;
+}
+
+//--------------------------------------------------------------
+bool FieldExportReader::open(const std::string& _name) {
+    if (!memory.open(_name))
+        return false;
+
+    const ExportHeader* header = getHeader();
+    bool bValid = memory.getSize() >= sizeof(ExportHeader) && header->magic == MAGIC && header->version <= VERSION
+        && header->numFields >= NUM_FIELDS && header->fieldFormat == FORMAT_RG32F
+        && memory.getSize() >= header->headerBytes + (size_t)header->slotBytes * header->numSlots;
+    if (!bValid) {
+        memory.close();
+        return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+bool FieldExportReader::isPublisherOpen() const {
+    if (!isOpen() || getHeader()->bOpen.load(std::memory_order_acquire) == 0)
+        return false;
+#ifndef _WIN32
+    // a publisher that crashed never cleared the flag
+    pid_t pid = getHeader()->publisherPid;
+    if (pid > 0 && kill(pid, 0) != 0 && errno == ESRCH)
+        return false;
+#endif
+    return true;
+}
+
+//--------------------------------------------------------------
+uint64_t FieldExportReader::getLatestNumber() const {
+    return isOpen() ? getHeader()->latest.load(std::memory_order_acquire) : 0;
+}
+
+//--------------------------------------------------------------
+bool FieldExportReader::getLatest(Frame& _frame) const {
+    if (!isOpen())
+        return false;
+    const ExportHeader* header = getHeader();
+
+    // a slow reader can find the slot taken again, the next latest is complete then
+    for (int attempt=0; attempt<4; attempt++) {
+        uint64_t number = header->latest.load(std::memory_order_acquire);
+        if (number == 0)
+            return false;
+
+        const uint8_t* slot = memory.getData() + header->headerBytes + (size_t)(number % header->numSlots) * header->slotBytes;
+        const SlotHeader* slotHeader = (const SlotHeader*)slot;
+        if (slotHeader->sequence.load(std::memory_order_acquire) != number * 2)
+            continue;
+
+        size_t fieldFloats = (size_t)header->fieldWidth * header->fieldHeight * 2;
+        const float* fields = (const float*)(slot + sizeof(SlotHeader));
+        _frame.number = number;
+        _frame.header = slotHeader;
+        for (int i=0; i<NUM_FIELDS; i++)
+            _frame.fields[i] = fields + i * fieldFloats;
+        _frame.width = header->fieldWidth;
+        _frame.height = header->fieldHeight;
+        _frame.contourSizes = (const uint32_t*)(fields + header->numFields * fieldFloats);
+        _frame.points = (const float*)(_frame.contourSizes + header->maxContours);
+        return true;
+    }
+    return false;
+}
+
+//--------------------------------------------------------------
+bool FieldExportReader::isValid(const Frame& _frame) const {
+    // whatever was read before this point came from the frame if the slot still holds it
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return _frame.header && _frame.header->sequence.load(std::memory_order_relaxed) == _frame.number * 2;
+}
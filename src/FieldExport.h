@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <string>
+
+// FlowGen field export, a named shared memory region other local processes
+// map to read the latest optical flow, fluid velocity and contours.
+//
+//  header       ExportHeader
+//  slots        numSlots x slotBytes, each one published frame:
+//                 SlotHeader
+//                 numFields fields of fieldWidth x fieldHeight, two floats (x, y) per cell, rows top down
+//                 maxContours uint32 point counts
+//                 maxPoints points, two floats (x, y) normalized to the depth image, contours back to back
+//
+// Frames are published round robin. A slot's sequence is odd while it is
+// written and twice the frame's publish number once it is complete, then
+// header.latest moves on to it. A reader takes latest, checks the slot's
+// sequence, reads in place and checks the sequence again to know the slot
+// was not reused meanwhile; with three slots a frame stays untouched for two
+// more publishes. Velocities are in the flowtools convention, relative to
+// the grid width.
+//
+// This header and FieldExport.cpp have no openFrameworks dependency, other
+// processes compile them as they are.
+
+namespace fieldExport {
+
+    const uint32_t	MAGIC = 0x58534746;		// "FGSX"
+    const uint32_t	VERSION = 1;
+
+    enum FieldId {
+        FIELD_OPTICAL_FLOW = 0,
+        FIELD_FLUID_VELOCITY,
+        NUM_FIELDS
+    };
+
+    enum FieldFormat {
+        FORMAT_RG32F = 1
+    };
+
+    struct ExportHeader {
+        uint32_t	magic;
+        uint32_t	version;
+        uint32_t	headerBytes;			// the slots start here
+        uint32_t	slotBytes;
+        uint32_t	numSlots;
+        uint32_t	numFields;
+        uint32_t	fieldWidth;
+        uint32_t	fieldHeight;
+        uint32_t	fieldFormat;
+        uint32_t	maxContours;
+        uint32_t	maxPoints;
+        uint32_t	publisherPid;
+        int64_t		clockOffsetMicros;		// add to the slot times for microseconds since the epoch
+        std::atomic<uint32_t> bOpen;		// cleared when the publisher closes, readers should reopen
+        uint32_t	reserved0;
+        std::atomic<uint64_t> latest;		// publish number of the newest complete slot, 0 before the first
+        uint8_t		reserved[64];
+    };
+
+    struct SlotHeader {
+        std::atomic<uint64_t> sequence;		// odd while written, 2 x publish number when complete
+        uint64_t	frameNum;				// app frame
+        uint64_t	depthFrameNum;			// of the depth frame the flow and contours come from
+        uint64_t	captureMicros;			// when that depth frame was captured, publisher clock
+        uint64_t	publishMicros;			// when the fields were read back, publisher clock
+        uint32_t	numContours;
+        uint32_t	numPoints;
+        uint8_t		reserved[16];
+    };
+
+    size_t			getSlotBytes(int _fieldWidth, int _fieldHeight, int _maxContours, int _maxPoints);
+    size_t			getRegionBytes(int _fieldWidth, int _fieldHeight, int _maxContours, int _maxPoints, int _numSlots);
+}
+
+// A named shared memory region: POSIX shm on macOS and Linux, a named file
+// mapping on Windows.
+class SharedMemory {
+public:
+    SharedMemory();
+    ~SharedMemory();
+
+    bool			create(const std::string& _name, size_t _size);	// replaces a region of the same name
+    bool			open(const std::string& _name);					// read only, the size the creator gave it
+    void			close();			// unlinks it too when this side created it
+
+    uint8_t*		getData() const		{ return data; }
+    size_t			getSize() const		{ return size; }
+    bool			isOpen() const		{ return data != nullptr; }
+
+protected:
+    std::string		name;
+    uint8_t*		data;
+    size_t			size;
+    bool			bCreated;
+#ifdef _WIN32
+    void*			mappingHandle;
+#else
+    int				fd;
+#endif
+};
+
+// Consumer side of the field export. Nothing is copied: a frame points
+// straight into the shared slot and stays good as long as isValid() says so,
+// which should be checked once the caller is done reading.
+//
+//     FieldExportReader reader;
+//     FieldExportReader::Frame frame;
+//     if ((reader.isOpen() || reader.open("flowgen")) && reader.getLatest(frame)) {
+//         ... read frame.fields[fieldExport::FIELD_OPTICAL_FLOW] ...
+//         if (!reader.isValid(frame)) ... overwritten meanwhile, drop what was read
+//     }
+class FieldExportReader {
+public:
+    struct Frame {
+        uint64_t					number;		// publish number
+        const fieldExport::SlotHeader* header;
+        const float*				fields[fieldExport::NUM_FIELDS];
+        int							width;
+        int							height;
+        const uint32_t*				contourSizes;
+        const float*				points;
+    };
+
+    bool			open(const std::string& _name);
+    void			close()				{ memory.close(); }
+    bool			isOpen() const		{ return memory.isOpen(); }
+    bool			isPublisherOpen() const;	// false once the publisher has closed or died, reopen to follow a new one
+
+    bool			getLatest(Frame& _frame) const;		// false before the first frame
+    bool			isValid(const Frame& _frame) const;
+    uint64_t		getLatestNumber() const;			// cheap check for something new
+
+    const fieldExport::ExportHeader* getHeader() const	{ return (const fieldExport::ExportHeader*)memory.getData(); }
+
+protected:
+    SharedMemory	memory;
+};
@@ -0,0 +1,155 @@
+#include "FieldExporter.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace fieldExport;
+
+static const int NUM_SLOTS = 3;
+
+
+//--------------------------------------------------------------
+FieldExporter::FieldExporter() {
+    width = 0;
+    height = 0;
+    maxContours = 0;
+    maxPoints = 0;
+    numPublished = 0;
+}
+
+//--------------------------------------------------------------
+FieldExporter::~FieldExporter() {
+    close();
+}
+
+//--------------------------------------------------------------
+bool FieldExporter::setup(const string& _name, int _width, int _height, int _maxContours, int _maxPoints) {
+    close();
+    name = _name;
+    width = max(_width, 1);
+    height = max(_height, 1);
+    maxContours = max(_maxContours, 0);
+    maxPoints = max(_maxPoints, 0);
+    if (!memory.create(name, getRegionBytes(width, height, maxContours, maxPoints, NUM_SLOTS)))
+        return false;
+
+    ExportHeader* header = getHeader();
+    header->magic = MAGIC;
+    header->version = VERSION;
+    header->headerBytes = sizeof(ExportHeader);
+    header->slotBytes = getSlotBytes(width, height, maxContours, maxPoints);
+    header->numSlots = NUM_SLOTS;
+    header->numFields = NUM_FIELDS;
+    header->fieldWidth = width;
+    header->fieldHeight = height;
+    header->fieldFormat = FORMAT_RG32F;
+    header->maxContours = maxContours;
+    header->maxPoints = maxPoints;
+#ifdef _WIN32
+    header->publisherPid = GetCurrentProcessId();
+#else
+    header->publisherPid = getpid();
+#endif
+    int64_t systemMicros = chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    header->clockOffsetMicros = systemMicros - (int64_t)ofGetElapsedTimeMicros();
+    header->latest.store(0, memory_order_relaxed);
+    header->bOpen.store(1, memory_order_release);
+
+    flowReader.allocate(width, height);
+    velocityReader.allocate(width, height);
+    pending.clear();
+    numPublished = 0;
+    return true;
+}
+
+//--------------------------------------------------------------
+void FieldExporter::close() {
+    if (!memory.isOpen())
+        return;
+    getHeader()->bOpen.store(0, memory_order_release);
+    memory.close();
+    pending.clear();
+}
+
+//--------------------------------------------------------------
+void FieldExporter::publish(ofTexture& _flow, ofTexture& _velocity, const vector<Blob>& _blobs, int _sourceWidth, int _sourceHeight,
+                            bool _flipX, uint64_t _depthFrameNum, uint64_t _captureMicros) {
+    if (!memory.isOpen())
+        return;
+
+    PendingFrame frame;
+    frame.frameNum = ofGetFrameNum();
+    frame.depthFrameNum = _depthFrameNum;
+    frame.captureMicros = _captureMicros;
+    float scaleX = 1.0 / max(_sourceWidth, 1);
+    float scaleY = 1.0 / max(_sourceHeight, 1);
+    for (const Blob& blob : _blobs) {
+        const ofPolyline& contour = blob.contour;
+        if (contour.size() == 0)
+            continue;
+        size_t room = maxPoints - frame.points.size() / 2;
+        if ((int)frame.contourSizes.size() >= maxContours || room == 0)
+            break;
+        const vector<ofPoint>& vertices = contour.getVertices();
+        size_t count = min(vertices.size(), room);
+        for (size_t i=0; i<count; i++) {
+            float x = vertices[i].x * scaleX;
+            frame.points.push_back(_flipX ? 1 - x : x);
+            frame.points.push_back(vertices[i].y * scaleY);
+        }
+        frame.contourSizes.push_back(count);
+    }
+    pending.push_back(std::move(frame));
+
+    const float* flow = flowReader.read(_flow);
+    const float* velocity = velocityReader.read(_velocity);
+    if (!flow || !velocity)
+        return;
+    writeSlot(flow, velocity, pending.front());
+    pending.pop_front();
+}
+
+//--------------------------------------------------------------
+void FieldExporter::writeSlot(const float* _flow, const float* _velocity, const PendingFrame& _frame) {
+    ExportHeader* header = getHeader();
+    uint64_t number = numPublished + 1;
+    uint8_t* slot = memory.getData() + header->headerBytes + (size_t)(number % header->numSlots) * header->slotBytes;
+    SlotHeader* slotHeader = (SlotHeader*)slot;
+
+    // odd until complete, readers that started on the old frame see it changed
+    slotHeader->sequence.store(number * 2 - 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    // two of the four channels read back
+    size_t numCells = (size_t)width * height;
+    float* fields = (float*)(slot + sizeof(SlotHeader));
+    const float* sources[NUM_FIELDS] = { _flow, _velocity };
+    for (int f=0; f<NUM_FIELDS; f++) {
+        const float* src = sources[f];
+        float* dst = fields + f * numCells * 2;
+        for (size_t i=0; i<numCells; i++) {
+            dst[i * 2] = src[i * 4];
+            dst[i * 2 + 1] = src[i * 4 + 1];
+        }
+    }
+    uint32_t* contourSizes = (uint32_t*)(fields + NUM_FIELDS * numCells * 2);
+    float* points = (float*)(contourSizes + maxContours);
+    if (!_frame.contourSizes.empty())
+        memcpy(contourSizes, _frame.contourSizes.data(), _frame.contourSizes.size() * sizeof(uint32_t));
+    if (!_frame.points.empty())
+        memcpy(points, _frame.points.data(), _frame.points.size() * sizeof(float));
+
+    slotHeader->frameNum = _frame.frameNum;
+    slotHeader->depthFrameNum = _frame.depthFrameNum;
+    slotHeader->captureMicros = _frame.captureMicros;
+    slotHeader->publishMicros = ofGetElapsedTimeMicros();
+    slotHeader->numContours = _frame.contourSizes.size();
+    slotHeader->numPoints = _frame.points.size() / 2;
+
+    slotHeader->sequence.store(number * 2, memory_order_release);
+    header->latest.store(number, memory_order_release);
+    numPublished = number;
+}
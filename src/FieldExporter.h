@@ -0,0 +1,55 @@
+#pragma once
+
+#include "ofMain.h"
+#include "FieldExport.h"
+#include "AsyncTextureReader.h"
+#include "BlobFinder.h"
+
+// Publisher side of the field export (see FieldExport.h). The fields are
+// drawn down to the export size and read back asynchronously; each frame is
+// written to shared memory once its read back arrives, a couple of
+// publish() calls later, together with the contours and times it was
+// published with.
+class FieldExporter {
+public:
+    FieldExporter();
+    ~FieldExporter();
+
+    bool			setup(const string& _name, int _width, int _height, int _maxContours = 64, int _maxPoints = 8192);
+    void			close();
+
+    // blob contours in depth image pixels, normalized on the way out; blobs without one are left out
+    void			publish(ofTexture& _flow, ofTexture& _velocity, const vector<Blob>& _blobs, int _sourceWidth, int _sourceHeight,
+                            bool _flipX, uint64_t _depthFrameNum, uint64_t _captureMicros);
+
+    bool			isOpen() const				{ return memory.isOpen(); }
+    const string&	getName() const				{ return name; }
+    int				getWidth() const			{ return width; }
+    int				getHeight() const			{ return height; }
+    int				getLatency() const			{ return flowReader.getLatency(); }		// in publish() calls
+    uint64_t		getNumPublished() const		{ return numPublished; }
+
+protected:
+    struct PendingFrame {
+        uint64_t			frameNum;
+        uint64_t			depthFrameNum;
+        uint64_t			captureMicros;
+        vector<uint32_t>	contourSizes;
+        vector<float>		points;
+    };
+
+    void			writeSlot(const float* _flow, const float* _velocity, const PendingFrame& _frame);
+    fieldExport::ExportHeader* getHeader()		{ return (fieldExport::ExportHeader*)memory.getData(); }
+
+    SharedMemory		memory;
+    string				name;
+    int					width;
+    int					height;
+    int					maxContours;
+    int					maxPoints;
+
+    AsyncTextureReader	flowReader;
+    AsyncTextureReader	velocityReader;
+    deque<PendingFrame>	pending;			// waiting for their read back, oldest first
+    uint64_t			numPublished;
+};
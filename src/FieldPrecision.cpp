@@ -0,0 +1,122 @@
+#include "FieldPrecision.h"
+
+
+//--------------------------------------------------------------
+FieldPrecision::FieldPrecision() {
+    // half floats, what the app was built with before this could be chosen
+    velocity = FIELD_FORMAT_FP16;
+    density = FIELD_FORMAT_FP16;
+    scalars = FIELD_FORMAT_FP16;
+    particles = FIELD_FORMAT_FP16;
+}
+
+//--------------------------------------------------------------
+static bool parseFormat(const string& _name, fieldFormatEnum& _format) {
+    if      (_name == "fp32")	_format = FIELD_FORMAT_FP32;
+    else if (_name == "fp16")	_format = FIELD_FORMAT_FP16;
+    else if (_name == "unorm8")	_format = FIELD_FORMAT_UNORM8;
+    else return false;
+    return true;
+}
+
+//--------------------------------------------------------------
+bool FieldPrecision::set(const string& _spec) {
+    FieldPrecision precision = *this;
+    for (const string& item : ofSplitString(_spec, ",", true, true)) {
+        vector<string> field = ofSplitString(item, "=", true, true);
+        if (field.size() == 1) {
+            bool found;
+            precision = getTier(field[0], &found);
+            if (!found)
+                return false;
+            continue;
+        }
+
+        fieldFormatEnum format;
+        if (field.size() != 2 || !parseFormat(field[1], format))
+            return false;
+        // velocities, pressures and particle positions are signed
+        bool isSigned = field[0] != "density";
+        if (isSigned && format == FIELD_FORMAT_UNORM8)
+            return false;
+        if      (field[0] == "velocity")	precision.velocity = format;
+        else if (field[0] == "density")		precision.density = format;
+        else if (field[0] == "scalars")		precision.scalars = format;
+        else if (field[0] == "particles")	precision.particles = format;
+        else return false;
+    }
+    *this = precision;
+    return true;
+}
+
+//--------------------------------------------------------------
+string FieldPrecision::getName() const {
+    for (const string& name : getTierNames()) {
+        if (getTier(name) == *this)
+            return name;
+    }
+    return "velocity=" + getFormatName(velocity) + ",density=" + getFormatName(density) + ",scalars=" + getFormatName(scalars)
+         + ",particles=" + getFormatName(particles);
+}
+
+//--------------------------------------------------------------
+bool FieldPrecision::isFluidHalfFloat() const {
+    return velocity != FIELD_FORMAT_FP32 && density != FIELD_FORMAT_FP32 && scalars != FIELD_FORMAT_FP32;
+}
+
+//--------------------------------------------------------------
+bool FieldPrecision::operator==(const FieldPrecision& _other) const {
+    return velocity == _other.velocity && density == _other.density && scalars == _other.scalars && particles == _other.particles;
+}
+
+//--------------------------------------------------------------
+FieldPrecision FieldPrecision::getTier(const string& _name, bool* _found) {
+    FieldPrecision precision;
+    bool found = true;
+    if (_name == "fp32") {
+        precision.velocity = FIELD_FORMAT_FP32;
+        precision.density = FIELD_FORMAT_FP32;
+        precision.scalars = FIELD_FORMAT_FP32;
+        precision.particles = FIELD_FORMAT_FP32;
+    }
+    else if (_name == "packed") {
+        precision.velocity = FIELD_FORMAT_FP16;
+        precision.density = FIELD_FORMAT_FP32;
+        precision.scalars = FIELD_FORMAT_FP32;
+        precision.particles = FIELD_FORMAT_FP32;
+    }
+    else if (_name == "density8") {
+        precision.density = FIELD_FORMAT_UNORM8;
+    }
+    else if (_name != "fp16") {
+        found = false;
+    }
+    if (_found)
+        *_found = found;
+    return precision;
+}
+
+//--------------------------------------------------------------
+vector<string> FieldPrecision::getTierNames() {
+    return { "fp32", "packed", "fp16", "density8" };
+}
+
+//--------------------------------------------------------------
+GLint FieldPrecision::getInternalFormat(fieldFormatEnum _format, int _numChannels) {
+    static const GLint formats[3][4] = {
+        { GL_R32F,	GL_RG32F,	GL_RGB32F,	GL_RGBA32F },
+        { GL_R16F,	GL_RG16F,	GL_RGB16F,	GL_RGBA16F },
+        { GL_R8,	GL_RG8,		GL_RGB8,	GL_RGBA8 }
+    };
+    return formats[_format][min(max(_numChannels, 1), 4) - 1];
+}
+
+//--------------------------------------------------------------
+string FieldPrecision::getFormatName(fieldFormatEnum _format) {
+    switch (_format) {
+        case FIELD_FORMAT_FP32:		return "fp32";
+        case FIELD_FORMAT_FP16:		return "fp16";
+        case FIELD_FORMAT_UNORM8:	return "unorm8";
+    }
+    return "unknown";
+}
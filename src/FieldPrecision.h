@@ -0,0 +1,46 @@
+#pragma once
+
+#include "ofMain.h"
+
+enum fieldFormatEnum {
+    FIELD_FORMAT_FP32 = 0,
+    FIELD_FORMAT_FP16,
+    FIELD_FORMAT_UNORM8		// 0 to 1, density only
+};
+
+// How the simulation fields are stored, chosen at startup (--precision)
+// rather than compiled in. A tier sets every field at once:
+//   fp32      full floats everywhere
+//   packed    half float (RG16F) velocity, everything else full
+//   fp16      half floats everywhere
+//   density8  half floats with 8 bit density
+// and single fields can be changed on top of it, e.g. "packed,density=unorm8".
+//
+// The flowtools fluid and particles take one flag for all their buffers.
+// They only go to half floats when none of their fields asks for full ones,
+// so nothing is ever stored coarser than asked; the CPU particles are always
+// full floats. The CPU fluid's textures follow every field exactly, the force
+// splats follow the fluid. The backends say what they store a precision as
+// (getStoredPrecision()), which the log and the validation report show.
+struct FieldPrecision {
+    FieldPrecision();
+
+    fieldFormatEnum	velocity;		// fp32 or fp16
+    fieldFormatEnum	density;
+    fieldFormatEnum	scalars;		// pressure, temperature and the derived fields, fp32 or fp16
+    fieldFormatEnum	particles;		// fp32 or fp16
+
+    bool		set(const string& _spec);	// comma separated tier and field=format, false leaves it as it was
+    string		getName() const;			// the tier, or every field when it matches none
+
+    bool		isFluidHalfFloat() const;	// for the flowtools fluid
+    bool		isParticleHalfFloat() const	{ return particles != FIELD_FORMAT_FP32; }
+
+    bool		operator==(const FieldPrecision& _other) const;
+    bool		operator!=(const FieldPrecision& _other) const	{ return !(*this == _other); }
+
+    static FieldPrecision	getTier(const string& _name, bool* _found = nullptr);
+    static vector<string>	getTierNames();
+    static GLint			getInternalFormat(fieldFormatEnum _format, int _numChannels);
+    static string			getFormatName(fieldFormatEnum _format);
+};
@@ -0,0 +1,15 @@
+#include "FluidSimulation.h"
+#include "GpuFluidSimulation.h"
+#include "CpuFluidSimulation.h"
+
+
+//--------------------------------------------------------------
+shared_ptr<FluidSimulation> FluidSimulation::create(fluidBackendEnum _backend, ThreadPool* _pool) {
+    switch (_backend) {
+        case FLUID_BACKEND_CPU:
+            return make_shared<CpuFluidSimulation>(_pool);
+        case FLUID_BACKEND_GPU:
+        default:
+            return make_shared<GpuFluidSimulation>();
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "ofMain.h"
+#include "FieldPrecision.h"
+
+class ThreadPool;
+
+// Fluid backends selectable from the command line (--fluid)
+enum fluidBackendEnum {
+    FLUID_BACKEND_GPU = 0,
+    FLUID_BACKEND_CPU
+};
+
+// The part of ftFluidSimulation the app uses, so the shader simulation and
+// the CPU solver can be swapped at startup. Inputs and outputs are textures
+// either way; the flowtools visualizers and the particles read them as usual.
+class FluidSimulation {
+public:
+    virtual ~FluidSimulation() {}
+
+    virtual void	setup(int _simulationWidth, int _simulationHeight, int _densityWidth, int _densityHeight, const FieldPrecision& _precision) = 0;
+    virtual void	update(float _deltaTime = 0) = 0;	// 0 uses the last frame time
+    virtual void	draw(int _x, int _y, float _width, float _height) = 0;
+    virtual void	reset() = 0;
+    virtual string	getName() const = 0;
+
+    virtual void	addVelocity(ofTexture& _texture, float _strength = 1.0) = 0;
+    virtual void	addDensity(ofTexture& _texture, float _strength = 1.0) = 0;
+    virtual void	addTemperature(ofTexture& _texture, float _strength = 1.0) = 0;
+    virtual void	addPressure(ofTexture& _texture, float _strength = 1.0) = 0;
+    virtual void	addObstacle(ofTexture& _texture) = 0;
+    virtual void	addTempObstacle(ofTexture& _texture) = 0;
+    // one byte per simulation cell, 255 inside; kept through reset() until set again, only the dirty tiles have changed
+    virtual void	setDynamicObstacle(const ofPixels& _pixels, const vector<ofRectangle>& _dirtyTiles) = 0;
+
+    virtual ofTexture&	getVelocity() = 0;
+    virtual ofTexture&	getDensity() = 0;
+    virtual ofTexture&	getPressure() = 0;
+    virtual ofTexture&	getTemperature() = 0;
+    virtual ofTexture&	getDivergence() = 0;
+    virtual ofTexture&	getObstacle() = 0;
+    virtual ofTexture&	getConfinement() = 0;
+    virtual ofTexture&	getSmokeBuoyancy() = 0;
+
+    virtual float	getSpeed() = 0;
+    virtual float	getCellSize() = 0;
+    virtual ofParameter<int>& getIterations() = 0;		// of the pressure solver
+    virtual ofParameterGroup& getParameters() = 0;
+
+    // the formats setup() stores the velocity, density and scalars in for a precision, the rest as given
+    virtual FieldPrecision	getStoredPrecision(const FieldPrecision& _precision) const	{ return _precision; }
+
+    // _pool is only used by the CPU backend, null runs it on the calling thread
+    static shared_ptr<FluidSimulation> create(fluidBackendEnum _backend, ThreadPool* _pool = nullptr);
+};
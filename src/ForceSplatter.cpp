@@ -0,0 +1,218 @@
+#include "ForceSplatter.h"
+
+#define STRINGIFY(A) #A
+
+using namespace flowTools;
+
+// the default attributes take locations 0 to 3
+static const int SPLAT_ATTRIBUTE = 4;
+static const int VALUE_ATTRIBUTE = 5;
+
+// one quad per instance, corners at -1 and 1
+static const string splatVertexShader = "#version 150\n" STRINGIFY(
+    uniform mat4 modelViewProjectionMatrix;
+    uniform vec2 size;
+    in vec4 position;
+    in vec4 splat;
+    in vec4 value;
+    out vec2 corner;
+    out vec4 splatValue;
+    out float splatEdge;
+    void main() {
+        corner = position.xy;
+        splatValue = value;
+        splatEdge = splat.w;
+        vec2 center = splat.xy * size;
+        gl_Position = modelViewProjectionMatrix * vec4(center + position.xy * splat.z * size.x, 0.0, 1.0);
+    }
+);
+
+static const string splatFragmentShader = "#version 150\n" STRINGIFY(
+    in vec2 corner;
+    in vec4 splatValue;
+    in float splatEdge;
+    out vec4 fragColor;
+    void main() {
+        float distance = length(corner);
+        if (distance >= 1.0)
+            discard;
+        fragColor = splatValue * (1.0 - smoothstep(splatEdge, 1.0, distance));
+    }
+);
+
+
+//--------------------------------------------------------------
+ForceSplatter::ForceSplatter() {
+    width = 0;
+    height = 0;
+    maxForces = 64;
+    mergeDistance = 0.03;
+    programCache = nullptr;
+    for (int i=0; i<NUM_FIELDS; i++)
+        bHasForces[i] = false;
+}
+
+//--------------------------------------------------------------
+void ForceSplatter::setup(int _width, int _height, const FieldPrecision& _precision) {
+    width = _width;
+    height = _height;
+
+    const int formats[NUM_FIELDS] = {
+        FieldPrecision::getInternalFormat(_precision.density, 4),
+        FieldPrecision::getInternalFormat(_precision.velocity, 2),
+        FieldPrecision::getInternalFormat(_precision.scalars, 1),
+        FieldPrecision::getInternalFormat(_precision.scalars, 1),
+        GL_R32F
+    };
+    const ofVec3f quad[4] = { ofVec3f(-1, -1), ofVec3f(1, -1), ofVec3f(-1, 1), ofVec3f(1, 1) };
+    for (int i=0; i<NUM_FIELDS; i++) {
+        fbos[i].allocate(width, height, formats[i]);
+        fbos[i].begin();
+        ofClear(0, 0, 0, 0);
+        fbos[i].end();
+        bHasForces[i] = false;
+        forces[i].clear();
+        if (!vbos[i].getIsAllocated())
+            vbos[i].setVertexData(quad, 4, GL_STATIC_DRAW);
+    }
+
+    if (!shader.isLoaded()) {
+        vector<pair<GLuint, string> > attributes = { make_pair(SPLAT_ATTRIBUTE, "splat"), make_pair(VALUE_ATTRIBUTE, "value") };
+        if (programCache)
+            programCache->load(shader, splatVertexShader, splatFragmentShader, attributes);
+        else
+            ProgramCache::compile(shader, splatVertexShader, splatFragmentShader, attributes);
+    }
+}
+
+//--------------------------------------------------------------
+void ForceSplatter::add(const PointForce& _force) {
+    int field = getField(_force.type);
+    if (field < 0 || field >= NUM_FIELDS)
+        return;
+    forces[field].push_back(_force);
+}
+
+//--------------------------------------------------------------
+void ForceSplatter::update() {
+    stats = Stats();
+    if (width == 0)
+        return;
+
+    ofPushStyle();
+    ofEnableBlendMode(OF_BLENDMODE_ADD);
+    for (int i=0; i<NUM_FIELDS; i++) {
+        stats.numAdded += forces[i].size();
+        if (forces[i].empty() && !bHasForces[i])
+            continue;
+
+        limit(forces[i]);
+        int numForces = forces[i].size();
+        splats.resize(numForces * 4);
+        values.resize(numForces * 4);
+        for (int j=0; j<numForces; j++) {
+            const PointForce& force = forces[i][j];
+            float* splat = &splats[j * 4];
+            splat[0] = force.position.x;
+            splat[1] = force.position.y;
+            splat[2] = force.radius;
+            splat[3] = ofClamp(force.edge, 0, 0.99);
+            memcpy(&values[j * 4], &force.value.r, 4 * sizeof(float));
+        }
+
+        fbos[i].begin();
+        ofClear(0, 0, 0, 0);
+        if (numForces > 0) {
+            vbos[i].setAttributeData(SPLAT_ATTRIBUTE, splats.data(), 4, numForces, GL_STREAM_DRAW);
+            vbos[i].setAttributeData(VALUE_ATTRIBUTE, values.data(), 4, numForces, GL_STREAM_DRAW);
+            vbos[i].setAttributeDivisor(SPLAT_ATTRIBUTE, 1);
+            vbos[i].setAttributeDivisor(VALUE_ATTRIBUTE, 1);
+
+            // plain sums, values can be negative and have no alpha; overlapping obstacles stay solid
+            glBlendFunc(GL_ONE, GL_ONE);
+            glBlendEquation(getField(FT_OBSTACLE) == i ? GL_MAX : GL_FUNC_ADD);
+            shader.begin();
+            shader.setUniform2f("size", width, height);
+            vbos[i].drawInstanced(GL_TRIANGLE_STRIP, 0, 4, numForces);
+            shader.end();
+            glBlendEquation(GL_FUNC_ADD);
+        }
+        fbos[i].end();
+
+        bHasForces[i] = numForces > 0;
+        stats.numSplatted += numForces;
+        forces[i].clear();
+    }
+    ofDisableBlendMode();
+    ofPopStyle();
+}
+
+//--------------------------------------------------------------
+void ForceSplatter::limit(vector<PointForce>& _forces) {
+    int numForces = _forces.size();
+    if (numForces <= maxForces)
+        return;
+
+    // merge on a grid first, a crowd of inputs in one place loses detail rather than whole inputs
+    if (mergeDistance > 0) {
+        int gridWidth = max((int)ceil(1.0 / mergeDistance), 1);
+        unordered_map<int, int> cells;
+        vector<PointForce> merged;
+        vector<float> weights;
+        merged.reserve(numForces);
+        for (const PointForce& force : _forces) {
+            int x = ofClamp(force.position.x / mergeDistance, 0, gridWidth - 1);
+            int y = ofClamp(force.position.y / mergeDistance, 0, gridWidth - 1);
+            float weight = getWeight(force) + 1e-6;
+            auto cell = cells.find(y * gridWidth + x);
+            if (cell == cells.end()) {
+                cells[y * gridWidth + x] = merged.size();
+                merged.push_back(force);
+                merged.back().position *= weight;
+                weights.push_back(weight);
+                continue;
+            }
+            PointForce& target = merged[cell->second];
+            target.position += force.position * weight;
+            target.value.r += force.value.r;
+            target.value.g += force.value.g;
+            target.value.b += force.value.b;
+            target.value.a += force.value.a;
+            target.radius = max(target.radius, force.radius);
+            target.edge = min(target.edge, force.edge);
+            weights[cell->second] += weight;
+        }
+        for (size_t i=0; i<merged.size(); i++)
+            merged[i].position /= weights[i];
+        stats.numMerged += numForces - merged.size();
+        _forces.swap(merged);
+        numForces = _forces.size();
+    }
+
+    if (numForces > maxForces) {
+        nth_element(_forces.begin(), _forces.begin() + maxForces, _forces.end(), [this](const PointForce& _a, const PointForce& _b) {
+            return getWeight(_a) > getWeight(_b);
+        });
+        _forces.resize(maxForces);
+        stats.numDropped += numForces - maxForces;
+    }
+}
+
+//--------------------------------------------------------------
+float ForceSplatter::getWeight(const PointForce& _force) const {
+    // what the splat adds to the field, roughly
+    const ofFloatColor& value = _force.value;
+    float magnitude = sqrt(value.r * value.r + value.g * value.g + value.b * value.b + value.a * value.a);
+    return magnitude * _force.radius * _force.radius;
+}
+
+//--------------------------------------------------------------
+bool ForceSplatter::hasForces(ftDrawForceType _type) const {
+    int field = getField(_type);
+    return field >= 0 && field < NUM_FIELDS && bHasForces[field];
+}
+
+//--------------------------------------------------------------
+ofTexture& ForceSplatter::getTexture(ftDrawForceType _type) {
+    return fbos[min(max(getField(_type), 0), NUM_FIELDS - 1)].getTexture();
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxFlowTools.h"
+#include "FieldPrecision.h"
+#include "ProgramCache.h"
+
+// A round force at a point, in normalized field coordinates
+struct PointForce {
+    PointForce(flowTools::ftDrawForceType _type = flowTools::FT_VELOCITY, const ofVec2f& _position = ofVec2f(), const ofFloatColor& _value = ofFloatColor(0, 0, 0, 0), float _radius = 0.02, float _edge = 0) :
+        type(_type), position(_position), value(_value), radius(_radius), edge(_edge) {}
+
+    flowTools::ftDrawForceType	type;
+    ofVec2f			position;	// 0 - 1, top left origin like the flow
+    ofFloatColor	value;		// density rgba, velocity in r and g, temperature, pressure or obstacle in r
+    float			radius;		// relative to the field width
+    float			edge;		// of the radius where the falloff starts, 0 is soft throughout
+};
+
+// Collects the point forces of a frame and draws them into one texture per
+// target field, each field in a single instanced pass, so the fluid gets one
+// add pass per field however many inputs there are. Forces are summed,
+// obstacles take the maximum.
+//
+// More forces of a field than the cap are first merged on a grid of the
+// merge distance (summed values, weighted position, largest radius); if
+// that still leaves too many, the weakest are dropped.
+class ForceSplatter {
+public:
+    ForceSplatter();
+
+    struct Stats {
+        Stats() : numAdded(0), numMerged(0), numDropped(0), numSplatted(0) {}
+        int		numAdded;		// since the last update
+        int		numMerged;		// forces folded into another one
+        int		numDropped;
+        int		numSplatted;	// instances drawn
+    };
+
+    void			setup(int _width, int _height, const FieldPrecision& _precision);
+    void			setProgramCache(ProgramCache* _cache)	{ programCache = _cache; }	// before the first setup, null compiles the shader
+    void			setMaxForces(int _value)			{ maxForces = max(_value, 1); }	// per field and update
+    void			setMergeDistance(float _value)		{ mergeDistance = _value; }		// normalized
+
+    void			add(const PointForce& _force);
+    void			update();		// draws what was added since the last update, an update without forces clears the fields
+
+    bool			hasForces(flowTools::ftDrawForceType _type) const;
+    ofTexture&		getTexture(flowTools::ftDrawForceType _type);
+    const Stats&	getStats() const					{ return stats; }
+
+    static const int NUM_FIELDS = 5;	// FT_DENSITY to FT_OBSTACLE
+
+protected:
+    static int		getField(flowTools::ftDrawForceType _type)		{ return (int)_type - (int)flowTools::FT_DENSITY; }
+    void			limit(vector<PointForce>& _forces);
+    float			getWeight(const PointForce& _force) const;
+
+    int				width;
+    int				height;
+    int				maxForces;
+    float			mergeDistance;
+
+    vector<PointForce> forces[NUM_FIELDS];
+    bool			bHasForces[NUM_FIELDS];
+    ofFbo			fbos[NUM_FIELDS];
+    ofVbo			vbos[NUM_FIELDS];		// the quad, and the instances per field
+    vector<float>	splats;					// x, y, radius, edge per instance
+    vector<float>	values;
+    ofShader		shader;
+    ProgramCache*	programCache;
+    Stats			stats;
+};
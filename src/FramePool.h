@@ -0,0 +1,192 @@
+#pragma once
+
+#include <stddef.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Reference counted frame buffers of one size, recycled instead of freed.
+// acquire() hands out a free buffer, or allocates one when all are in use;
+// when the last handle to a buffer goes, it returns to the pool. Once the
+// pool has grown to what the pipeline keeps in flight, frames cost no
+// allocations at all: handles count references in the buffer itself and the
+// free list never grows past its reserve.
+//
+// Handles may be passed between threads and outlive the pool. Buffers are
+// plain memory; wrap one with ofPixels::setFromExternalPixels() for a CPU
+// view, or upload it for a GPU one.
+template<typename T>
+class FramePool {
+protected:
+    struct Shared;
+    struct Slot {
+        std::vector<T>		data;
+        int					width;
+        int					height;
+        int					channels;
+        std::atomic<int>	refs;
+        Shared*				owner;
+    };
+
+public:
+    class Buffer {
+    public:
+        Buffer() : slot(nullptr) {}
+        Buffer(const Buffer& _other) : slot(_other.slot)	{ if (slot) slot->refs.fetch_add(1, std::memory_order_relaxed); }
+        Buffer(Buffer&& _other) : slot(_other.slot)			{ _other.slot = nullptr; }
+        ~Buffer()											{ release(); }
+
+        Buffer& operator=(Buffer _other)					{ std::swap(slot, _other.slot); return *this; }
+        explicit operator bool() const						{ return slot != nullptr; }
+
+        T*			getData()					{ return slot->data.data(); }
+        const T*	getData() const				{ return slot->data.data(); }
+        size_t		size() const				{ return slot ? slot->data.size() : 0; }
+        int			getWidth() const			{ return slot ? slot->width : 0; }
+        int			getHeight() const			{ return slot ? slot->height : 0; }
+        int			getNumChannels() const		{ return slot ? slot->channels : 0; }
+        void		reset()						{ release(); }
+
+    protected:
+        friend class FramePool;
+        explicit Buffer(Slot* _slot) : slot(_slot) {}
+
+        void		release() {
+            if (slot && slot->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                slot->owner->recycle(slot);
+            slot = nullptr;
+        }
+
+        Slot*		slot;
+    };
+
+    struct Stats {
+        Stats() : numBuffers(0), numInUse(0), peakInUse(0), bytes(0), peakBytes(0) {}
+        size_t	numBuffers;
+        size_t	numInUse;
+        size_t	peakInUse;
+        size_t	bytes;			// allocated, in use or free
+        size_t	peakBytes;
+    };
+
+    FramePool() : shared(new Shared()) {}
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+    ~FramePool()				{ shared->close(); }
+
+    // a new size drops the free buffers, those still out are freed when they come back
+    void	setup(int _width, int _height, int _channels = 1, int _numBuffers = 0) {
+        shared->setup(_width, _height, _channels, _numBuffers);
+    }
+
+    Buffer	acquire()			{ return Buffer(shared->acquire()); }
+    Stats	getStats() const	{ return shared->getStats(); }
+
+protected:
+    // kept alive by the pool and by every buffer out of it, whichever goes last frees it
+    struct Shared {
+        Shared() : width(0), height(0), channels(0), bClosed(false), numRefs(1) {}
+        ~Shared()				{ for (Slot* slot : free) delete slot; }
+
+        void	setup(int _width, int _height, int _channels, int _numBuffers) {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (Slot* slot : free) {
+                stats.bytes -= slot->data.size() * sizeof(T);
+                stats.numBuffers--;
+                delete slot;
+            }
+            free.clear();
+            width = _width;
+            height = _height;
+            channels = _channels;
+            for (int i=0; i<_numBuffers; i++)
+                free.push_back(allocate());
+            reserve();
+        }
+
+        Slot*	acquire() {
+            std::lock_guard<std::mutex> lock(mutex);
+            Slot* slot;
+            if (free.empty()) {
+                slot = allocate();
+            }
+            else {
+                slot = free.back();
+                free.pop_back();
+            }
+            slot->refs.store(1, std::memory_order_relaxed);
+            numRefs++;
+            stats.numInUse++;
+            stats.peakInUse = std::max(stats.peakInUse, stats.numInUse);
+            return slot;
+        }
+
+        void	recycle(Slot* _slot) {
+            bool bDelete;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stats.numInUse--;
+                if (bClosed || _slot->width != width || _slot->height != height || _slot->channels != channels) {
+                    stats.bytes -= _slot->data.size() * sizeof(T);
+                    stats.numBuffers--;
+                    delete _slot;
+                }
+                else {
+                    free.push_back(_slot);
+                }
+                bDelete = --numRefs == 0;
+            }
+            if (bDelete)
+                delete this;
+        }
+
+        void	close() {
+            bool bDelete;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                bClosed = true;
+                bDelete = --numRefs == 0;
+            }
+            if (bDelete)
+                delete this;
+        }
+
+        Stats	getStats() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return stats;
+        }
+
+        Slot*	allocate() {
+            Slot* slot = new Slot();
+            slot->data.resize(getSize());
+            slot->width = width;
+            slot->height = height;
+            slot->channels = channels;
+            slot->owner = this;
+            stats.numBuffers++;
+            stats.bytes += getBytes();
+            stats.peakBytes = std::max(stats.peakBytes, stats.bytes);
+            reserve();
+            return slot;
+        }
+
+        // every buffer fits back into the free list without it growing
+        void	reserve()				{ free.reserve(stats.numBuffers); }
+        size_t	getSize() const			{ return (size_t)width * height * channels; }
+        size_t	getBytes() const		{ return getSize() * sizeof(T); }
+
+        int					width;
+        int					height;
+        int					channels;
+        bool				bClosed;
+        int					numRefs;		// the pool and the buffers out
+        std::vector<Slot*>	free;
+        Stats				stats;
+        mutable std::mutex	mutex;
+    };
+
+    Shared*		shared;
+};
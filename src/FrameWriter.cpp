@@ -0,0 +1,230 @@
+#include "FrameWriter.h"
+
+
+//--------------------------------------------------------------
+FrameWriter::FrameWriter() {
+    width = 0;
+    height = 0;
+    bOpen = false;
+    video = nullptr;
+    nextBuffer = 0;
+    numInFlight = 0;
+    numAdded = 0;
+    waitMillis = 0;
+    maxQueuedFrames = 8;
+    bClosing = false;
+    numWritten = 0;
+    numFailed = 0;
+}
+
+//--------------------------------------------------------------
+FrameWriter::~FrameWriter() {
+    close();
+}
+
+//--------------------------------------------------------------
+bool FrameWriter::open(const string& _path, int _width, int _height, float _fps, int _numBuffers) {
+    close();
+
+    path = _path;
+    width = _width;
+    height = _height;
+    if (ofToLower(ofFilePath::getFileExt(path)) == "y4m") {
+        video = fopen(path.c_str(), "wb");
+        if (!video)
+            return false;
+        // C420jpeg is full range BT.601 with centered chroma, which is what writeVideoFrame() produces
+        int rate = (int)(_fps * 1000 + 0.5);
+        fprintf(video, "YUV4MPEG2 W%d H%d F%d:1000 Ip A1:1 C420jpeg\n", width, height, rate);
+    }
+    else if (!ofDirectory::doesDirectoryExist(path, false) && !ofDirectory::createDirectory(path, false, true)) {
+        return false;
+    }
+
+    buffers.resize(max(_numBuffers, 2));
+    for (ofBufferObject& buffer : buffers)
+        buffer.allocate((size_t)width * height * 4, GL_STREAM_READ);
+    nextBuffer = 0;
+    numInFlight = 0;
+    numAdded = 0;
+    waitMillis = 0;
+    numWritten = 0;
+    numFailed = 0;
+
+    bOpen = true;
+    bClosing = false;
+    writer = thread(&FrameWriter::writerLoop, this);
+    return true;
+}
+
+//--------------------------------------------------------------
+void FrameWriter::addFrame(const ofTexture& _texture) {
+    if (!bOpen)
+        return;
+
+    // the oldest copy is read when its buffer is needed again
+    if (numInFlight == (int)buffers.size()) {
+        readBuffer(nextBuffer);
+        numInFlight--;
+    }
+    _texture.copyTo(buffers[nextBuffer]);
+    nextBuffer = (nextBuffer + 1) % buffers.size();
+    numInFlight++;
+    numAdded++;
+}
+
+//--------------------------------------------------------------
+void FrameWriter::readBuffer(int _index) {
+    ofPixels frame;
+    {
+        uint64_t start = ofGetElapsedTimeMicros();
+        unique_lock<mutex> lock(queueMutex);
+        freeCondition.wait(lock, [this]{ return queue.size() < maxQueuedFrames; });
+        if (!freeFrames.empty()) {
+            frame.swap(freeFrames.back());
+            freeFrames.pop_back();
+        }
+        waitMillis += (ofGetElapsedTimeMicros() - start) / 1000.0f;
+    }
+
+    if (!frame.isAllocated())
+        frame.allocate(width, height, 4);
+    ofBufferObject& buffer = buffers[_index];
+    const unsigned char* data = buffer.map<unsigned char>(GL_READ_ONLY);
+    if (data)
+        memcpy(frame.getData(), data, frame.getTotalBytes());
+    buffer.unmap();
+
+    {
+        lock_guard<mutex> lock(queueMutex);
+        queue.push_back(ofPixels());
+        queue.back().swap(frame);
+    }
+    queueCondition.notify_one();
+}
+
+//--------------------------------------------------------------
+void FrameWriter::close() {
+    if (!bOpen)
+        return;
+
+    // in flight buffers in the order they were added
+    int first = (nextBuffer - numInFlight + buffers.size()) % buffers.size();
+    for (int i=0; i<numInFlight; i++)
+        readBuffer((first + i) % buffers.size());
+    numInFlight = 0;
+
+    {
+        lock_guard<mutex> lock(queueMutex);
+        bClosing = true;
+    }
+    queueCondition.notify_one();
+    if (writer.joinable())
+        writer.join();
+
+    if (video) {
+        // what is still buffered is written here
+        if (fclose(video) != 0)
+            numFailed++;
+        video = nullptr;
+    }
+    buffers.clear();
+    queue.clear();
+    freeFrames.clear();
+    bOpen = false;
+}
+
+//--------------------------------------------------------------
+void FrameWriter::writerLoop() {
+    while (true) {
+        ofPixels frame;
+        {
+            unique_lock<mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this]{ return bClosing || !queue.empty(); });
+            if (queue.empty())
+                return;		// closing and drained
+            frame.swap(queue.front());
+            queue.pop_front();
+        }
+
+        bool written = video ? writeVideoFrame(frame) : writeImage(frame, numWritten);
+        if (!written)
+            numFailed++;
+        numWritten++;
+
+        {
+            lock_guard<mutex> lock(queueMutex);
+            freeFrames.push_back(ofPixels());
+            freeFrames.back().swap(frame);
+        }
+        freeCondition.notify_one();
+    }
+}
+
+//--------------------------------------------------------------
+bool FrameWriter::writeVideoFrame(const ofPixels& _frame) {
+    // fbo textures hold the image top down, as drawn
+    int chromaWidth = (width + 1) / 2;
+    int chromaHeight = (height + 1) / 2;
+    size_t lumaSize = (size_t)width * height;
+    size_t chromaSize = (size_t)chromaWidth * chromaHeight;
+    planes.resize(lumaSize + chromaSize * 2);
+    unsigned char* luma = planes.data();
+    unsigned char* cb = luma + lumaSize;
+    unsigned char* cr = cb + chromaSize;
+    const unsigned char* rgba = _frame.getData();
+
+    for (int y=0; y<height; y++) {
+        const unsigned char* src = rgba + (size_t)y * width * 4;
+        unsigned char* dst = luma + (size_t)y * width;
+        for (int x=0; x<width; x++, src+=4)
+            dst[x] = (unsigned char)(0.299f * src[0] + 0.587f * src[1] + 0.114f * src[2] + 0.5f);
+    }
+
+    // chroma of each 2x2 block, averaged
+    for (int cy=0; cy<chromaHeight; cy++) {
+        for (int cx=0; cx<chromaWidth; cx++) {
+            float r = 0, g = 0, b = 0;
+            int count = 0;
+            for (int y=cy * 2; y<min(cy * 2 + 2, height); y++) {
+                for (int x=cx * 2; x<min(cx * 2 + 2, width); x++) {
+                    const unsigned char* src = rgba + ((size_t)y * width + x) * 4;
+                    r += src[0];
+                    g += src[1];
+                    b += src[2];
+                    count++;
+                }
+            }
+            r /= count;
+            g /= count;
+            b /= count;
+            size_t i = (size_t)cy * chromaWidth + cx;
+            cb[i] = (unsigned char)ofClamp(128 - 0.168736f * r - 0.331264f * g + 0.5f * b + 0.5f, 0, 255);
+            cr[i] = (unsigned char)ofClamp(128 + 0.5f * r - 0.418688f * g - 0.081312f * b + 0.5f, 0, 255);
+        }
+    }
+
+    return fputs("FRAME\n", video) >= 0 && fwrite(planes.data(), 1, planes.size(), video) == planes.size();
+}
+
+//--------------------------------------------------------------
+bool FrameWriter::writeImage(const ofPixels& _frame, uint64_t _number) {
+    // alpha dropped
+    if (!image.isAllocated())
+        image.allocate(width, height, 3);
+    const unsigned char* rgba = _frame.getData();
+    unsigned char* rgb = image.getData();
+    for (int y=0; y<height; y++) {
+        const unsigned char* src = rgba + (size_t)y * width * 4;
+        unsigned char* dst = rgb + (size_t)y * width * 3;
+        for (int x=0; x<width; x++, src+=4, dst+=3) {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+        }
+    }
+    // ofSaveImage doesn't say whether it worked, a missing file is the only sign
+    string imagePath = ofFilePath::join(path, "frame_" + ofToString(_number, 6, '0') + ".png");
+    ofSaveImage(image, imagePath);
+    return ofFile::doesFileExist(imagePath, false);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "ofMain.h"
+#include <deque>
+#include <condition_variable>
+
+// Writes rendered frames to disk, either as one .y4m video (4:2:0, full
+// range) or as numbered PNGs in a folder. addFrame() only starts copying the
+// texture into one of a ring of pixel buffers; that buffer is read once the
+// ring comes round to it again, by which time the GPU has long finished, so
+// the render loop never waits on a read back. Conversion and writing happen
+// on a background thread. Unlike the depth recorder nothing is dropped: when
+// the disk falls behind, addFrame() waits for the writer. Frames that could
+// not be written, to a full disk say, are counted.
+class FrameWriter {
+public:
+    FrameWriter();
+    ~FrameWriter();
+
+    // frames must be _width x _height RGBA textures
+    bool			open(const string& _path, int _width, int _height, float _fps, int _numBuffers = 3);
+    void			addFrame(const ofTexture& _texture);
+    void			close();		// writes whatever is still in flight
+
+    bool			isOpen() const				{ return bOpen; }
+    bool			isVideo() const				{ return video != nullptr; }
+    const string&	getPath() const				{ return path; }
+    uint64_t		getNumAdded() const			{ return numAdded; }
+    uint64_t		getNumWritten() const		{ return numWritten; }
+    uint64_t		getNumFailed() const		{ return numFailed; }		// of the written, plus one if closing the video failed
+    float			getWaitMillis() const		{ return waitMillis; }		// spent waiting for the writer, in total
+
+protected:
+    void			readBuffer(int _index);
+    void			writerLoop();
+    bool			writeVideoFrame(const ofPixels& _frame);
+    bool			writeImage(const ofPixels& _frame, uint64_t _number);
+
+    string					path;
+    int						width;
+    int						height;
+    bool					bOpen;
+    FILE*					video;			// null when writing images
+
+    // render thread only
+    vector<ofBufferObject>	buffers;
+    int						nextBuffer;
+    int						numInFlight;
+    uint64_t				numAdded;
+    float					waitMillis;
+
+    thread					writer;
+    mutex					queueMutex;
+    condition_variable		queueCondition;		// something to write, or closing
+    condition_variable		freeCondition;		// a frame was written
+    deque<ofPixels>			queue;
+    vector<ofPixels>		freeFrames;
+    size_t					maxQueuedFrames;
+    bool					bClosing;
+
+    // writer thread only
+    vector<unsigned char>	planes;
+    ofPixels				image;
+    atomic<uint64_t>		numWritten;
+    atomic<uint64_t>		numFailed;
+};
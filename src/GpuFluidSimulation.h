@@ -0,0 +1,102 @@
+#pragma once
+
+#include "ofxFlowTools.h"
+#include "FluidSimulation.h"
+
+// The flowtools shader simulation behind the FluidSimulation interface
+class GpuFluidSimulation : public FluidSimulation {
+public:
+    GpuFluidSimulation() : bDynamicObstacle(false) {}
+
+    void	setup(int _simulationWidth, int _simulationHeight, int _densityWidth, int _densityHeight, const FieldPrecision& _precision) {
+        fluid.setup(_simulationWidth, _simulationHeight, _densityWidth, _densityHeight, _precision.isFluidHalfFloat());
+        dynamicObstacle.clear();
+        bDynamicObstacle = false;
+    }
+    void	update(float _deltaTime = 0);
+    void	draw(int _x, int _y, float _width, float _height)		{ fluid.draw(_x, _y, _width, _height); }
+    void	reset()													{ fluid.reset(); }
+    string	getName() const											{ return "gpu"; }
+
+    void	addVelocity(ofTexture& _texture, float _strength = 1.0)		{ fluid.addVelocity(_texture, _strength); }
+    void	addDensity(ofTexture& _texture, float _strength = 1.0)		{ fluid.addDensity(_texture, _strength); }
+    void	addTemperature(ofTexture& _texture, float _strength = 1.0)	{ fluid.addTemperature(_texture, _strength); }
+    void	addPressure(ofTexture& _texture, float _strength = 1.0)		{ fluid.addPressure(_texture, _strength); }
+    void	addObstacle(ofTexture& _texture)							{ fluid.addObstacle(_texture); }
+    void	addTempObstacle(ofTexture& _texture)						{ fluid.addTempObstacle(_texture); }
+    void	setDynamicObstacle(const ofPixels& _pixels, const vector<ofRectangle>& _dirtyTiles);
+
+    ofTexture&	getVelocity()			{ return fluid.getVelocity(); }
+    ofTexture&	getDensity()			{ return fluid.getDensity(); }
+    ofTexture&	getPressure()			{ return fluid.getPressure(); }
+    ofTexture&	getTemperature()		{ return fluid.getTemperature(); }
+    ofTexture&	getDivergence()			{ return fluid.getDivergence(); }
+    ofTexture&	getObstacle()			{ return fluid.getObstacle(); }
+    ofTexture&	getConfinement()		{ return fluid.getConfinement(); }
+    ofTexture&	getSmokeBuoyancy()		{ return fluid.getSmokeBuoyancy(); }
+
+    float	getSpeed()						{ return fluid.getSpeed(); }
+    float	getCellSize()					{ return fluid.getCellSize(); }
+    ofParameter<int>& getIterations()		{ return fluid.numJacobiIterations; }
+    ofParameterGroup& getParameters()		{ return fluid.parameters; }
+    FieldPrecision	getStoredPrecision(const FieldPrecision& _precision) const;
+
+    flowTools::ftFluidSimulation&	getFluid()	{ return fluid; }
+
+protected:
+    flowTools::ftFluidSimulation	fluid;
+    ofTexture	dynamicObstacle;
+    bool		bDynamicObstacle;		// anything inside it
+};
+
+//--------------------------------------------------------------
+inline void GpuFluidSimulation::update(float _deltaTime) {
+    // flowtools can't take an obstacle away again, so the dynamic one goes in as a temporary obstacle every step
+    if (bDynamicObstacle)
+        fluid.addTempObstacle(dynamicObstacle);
+    fluid.update(_deltaTime);
+}
+
+//--------------------------------------------------------------
+inline void GpuFluidSimulation::setDynamicObstacle(const ofPixels& _pixels, const vector<ofRectangle>& _dirtyTiles) {
+    int width = _pixels.getWidth();
+    int height = _pixels.getHeight();
+    if (!dynamicObstacle.isAllocated() || (int)dynamicObstacle.getWidth() != width || (int)dynamicObstacle.getHeight() != height) {
+        dynamicObstacle.allocate(_pixels);
+        dynamicObstacle.loadData(_pixels);
+    }
+    else if (!_dirtyTiles.empty()) {
+        // only the tiles that changed, straight out of the full grid
+        const ofTextureData& data = dynamicObstacle.getTextureData();
+        glBindTexture(data.textureTarget, data.textureID);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+        for (const ofRectangle& tile : _dirtyTiles) {
+            int x = tile.x;
+            int y = tile.y;
+            glTexSubImage2D(data.textureTarget, 0, x, y, tile.width, tile.height,
+                ofGetGLFormatFromInternal(data.glInternalFormat), GL_UNSIGNED_BYTE, _pixels.getData() + (size_t)y * width + x);
+        }
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(data.textureTarget, 0);
+    }
+    else {
+        return;
+    }
+
+    const unsigned char* pixels = _pixels.getData();
+    size_t size = (size_t)width * height;
+    bDynamicObstacle = find_if(pixels, pixels + size, [](unsigned char _value) { return _value != 0; }) != pixels + size;
+}
+
+//--------------------------------------------------------------
+inline FieldPrecision GpuFluidSimulation::getStoredPrecision(const FieldPrecision& _precision) const {
+    // one flag for all the buffers, see FieldPrecision::isFluidHalfFloat()
+    FieldPrecision stored = _precision;
+    fieldFormatEnum format = _precision.isFluidHalfFloat() ? FIELD_FORMAT_FP16 : FIELD_FORMAT_FP32;
+    stored.velocity = format;
+    stored.density = format;
+    stored.scalars = format;
+    return stored;
+}
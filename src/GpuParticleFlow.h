@@ -0,0 +1,47 @@
+#pragma once
+
+#include "ofxFlowTools.h"
+#include "ParticleFlow.h"
+
+// The flowtools shader particles behind the ParticleFlow interface. Their
+// buffers hold one particle per cell whatever the budget, a smaller budget
+// lowers the birth chance instead.
+class GpuParticleFlow : public ParticleFlow {
+public:
+    GpuParticleFlow() : budget(1), baseBirthChance(0) {}
+
+    void	setup(int _simulationWidth, int _simulationHeight, int _drawWidth, int _drawHeight, const FieldPrecision& _precision) {
+        particles.setup(_simulationWidth, _simulationHeight, _drawWidth, _drawHeight, _precision.isParticleHalfFloat());
+    }
+    void	update(float _deltaTime = 0)							{ particles.update(_deltaTime); }
+    void	draw(int _x, int _y, int _width, int _height)			{ particles.draw(_x, _y, _width, _height); }
+    bool	isActive()												{ return particles.isActive(); }
+    string	getName() const											{ return "gpu"; }
+
+    void	setSpeed(float _value)									{ particles.setSpeed(_value); }
+    void	setCellSize(float _value)								{ particles.setCellSize(_value); }
+    void	addFlowVelocity(ofTexture& _texture, float _strength = 1.0)	{ particles.addFlowVelocity(_texture, _strength); }
+    void	addFluidVelocity(ofTexture& _texture, float _strength = 1.0){ particles.addFluidVelocity(_texture, _strength); }
+    void	setObstacle(ofTexture& _texture)						{ particles.setObstacle(_texture); }
+
+    ofParameterGroup& getParameters()		{ return particles.parameters; }
+    void	setBudget(float _fraction);
+
+    flowTools::ftParticleFlow&	getParticles()	{ return particles; }
+
+protected:
+    flowTools::ftParticleFlow	particles;
+    float	budget;
+    float	baseBirthChance;		// as set in the gui before the budget was lowered
+};
+
+//--------------------------------------------------------------
+inline void GpuParticleFlow::setBudget(float _fraction) {
+    if (_fraction == budget || !particles.parameters.contains("birth chance"))
+        return;
+    ofParameter<float>& birthChance = particles.parameters.getFloat("birth chance");
+    if (budget >= 1)
+        baseBirthChance = birthChance;
+    budget = _fraction;
+    birthChance = budget >= 1 ? baseBirthChance : baseBirthChance * budget;
+}
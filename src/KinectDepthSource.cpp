@@ -0,0 +1,71 @@
+#include "KinectDepthSource.h"
+
+
+//--------------------------------------------------------------
+KinectDepthSource::KinectDepthSource(const string& _device) {
+    device = _device;
+    fps = 30;
+}
+
+//--------------------------------------------------------------
+KinectDepthSource::~KinectDepthSource() {
+    close();
+}
+
+//--------------------------------------------------------------
+bool KinectDepthSource::open() {
+    // enable depth->video image calibration, raw depth is in millimetres
+    kinect.setRegistration(true);
+
+    kinect.init(false, false, false);	// no video image and no textures
+    //kinect.init(true); // shows infrared instead of RGB video image
+
+    // when reopening, the kinect that was open before, whatever index it came back under
+    bool opened = !serial.empty() && kinect.open(serial);
+    if (!opened) {
+        if (device.empty())
+            opened = kinect.open();		// opens first available kinect
+        else if (device.find_first_not_of("0123456789") == string::npos)
+            opened = kinect.open(ofToInt(device));	// open a kinect by id, starting with 0 (sorted by serial # lexicographically))
+        else
+            opened = kinect.open(device);	// open a kinect using it's unique serial #
+    }
+
+    allocate(kinect.width, kinect.height);
+
+    // print the intrinsic IR sensor values
+    if (opened && kinect.isConnected()) {
+        serial = kinect.getSerial();
+        ofLogNotice() << "sensor-emitter dist: " << kinect.getSensorEmitterDistance() << "cm";
+        ofLogNotice() << "sensor-camera dist:  " << kinect.getSensorCameraDistance() << "cm";
+        ofLogNotice() << "zero plane pixel size: " << kinect.getZeroPlanePixelSize() << "mm";
+        ofLogNotice() << "zero plane dist: " << kinect.getZeroPlaneDistance() << "mm";
+    }
+    else {
+        ofLogWarning("KinectDepthSource") << "could not open kinect " << (device.empty() ? "(first available)" : device) << (serial.empty() ? "" : ", last serial " + serial);
+    }
+    return opened;
+}
+
+//--------------------------------------------------------------
+void KinectDepthSource::close() {
+    if (kinect.isConnected())
+        kinect.close();
+}
+
+//--------------------------------------------------------------
+void KinectDepthSource::update() {
+    bNewFrame = false;
+    kinect.update();
+
+    if (kinect.isFrameNew()) {
+        const ofShortPixels& raw = kinect.getRawDepthPixels();
+        memcpy(rawDepthPixels.getData(), raw.getData(), raw.getTotalBytes());
+        publishRawFrame();
+    }
+}
+
+//--------------------------------------------------------------
+string KinectDepthSource::getName() const {
+    return "kinect " + (device.empty() ? string("(first available)") : device);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxKinect.h"
+#include "DepthSource.h"
+
+// Live depth from a Kinect through ofxKinect. Textures are disabled on the
+// device, the app uploads the depth image itself like for every other source.
+class KinectDepthSource : public DepthSource {
+public:
+    KinectDepthSource(const string& _device = "");
+    ~KinectDepthSource();
+
+    bool	open();
+    void	close();
+    void	update();
+    bool	isConnected() const	{ return kinect.isConnected(); }
+    bool	isLive() const		{ return true; }
+    string	getName() const;
+
+    ofxKinect&	getKinect()		{ return kinect; }
+
+protected:
+    ofxKinect	kinect;
+    string		device;
+    string		serial;		// of the last kinect opened, a replugged device may come back under another index
+};
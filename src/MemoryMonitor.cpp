@@ -0,0 +1,83 @@
+#include "MemoryMonitor.h"
+
+#ifdef _WIN32
+#define PSAPI_VERSION 2		// the kernel32 entry points, no psapi.lib
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#define GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX	0x9048
+#define GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX	0x9049
+#define TEXTURE_FREE_MEMORY_ATI						0x87FC
+
+
+//--------------------------------------------------------------
+MemoryMonitor::MemoryMonitor() {
+    gpuInfo = GPU_INFO_NONE;
+    gpuTotalBytes = 0;
+    gpuFreeBytes = 0;
+    minGpuFreeBytes = 0;
+}
+
+//--------------------------------------------------------------
+void MemoryMonitor::setup() {
+    gpuInfo = GPU_INFO_NONE;
+    gpuTotalBytes = 0;
+    if (ofGLCheckExtension("GL_NVX_gpu_memory_info")) {
+        gpuInfo = GPU_INFO_NVX;
+        GLint totalKb = 0;
+        glGetIntegerv(GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX, &totalKb);
+        gpuTotalBytes = (uint64_t)totalKb * 1024;
+    }
+    else if (ofGLCheckExtension("GL_ATI_meminfo")) {
+        gpuInfo = GPU_INFO_ATI;
+    }
+    minGpuFreeBytes = 0;
+    update();
+}
+
+//--------------------------------------------------------------
+void MemoryMonitor::update() {
+    GLint freeKb[4] = { 0, 0, 0, 0 };
+    switch (gpuInfo) {
+        case GPU_INFO_NVX:
+            glGetIntegerv(GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, freeKb);
+            break;
+        case GPU_INFO_ATI:
+            glGetIntegerv(TEXTURE_FREE_MEMORY_ATI, freeKb);		// total free in the first of four
+            break;
+        default:
+            return;
+    }
+    gpuFreeBytes = (uint64_t)freeKb[0] * 1024;
+    if (minGpuFreeBytes == 0 || gpuFreeBytes < minGpuFreeBytes)
+        minGpuFreeBytes = gpuFreeBytes;
+}
+
+//--------------------------------------------------------------
+uint64_t MemoryMonitor::getPeakCpuBytes() const {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef TARGET_OSX
+    return usage.ru_maxrss;					// bytes
+#else
+    return (uint64_t)usage.ru_maxrss * 1024;	// kilobytes
+#endif
+#endif
+}
+
+//--------------------------------------------------------------
+uint64_t MemoryMonitor::getPeakGpuBytes() const {
+    if (gpuTotalBytes == 0 || minGpuFreeBytes > gpuTotalBytes)
+        return 0;
+    return gpuTotalBytes - minGpuFreeBytes;
+}
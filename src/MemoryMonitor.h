@@ -0,0 +1,34 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Peak memory of the process, for telling how many instances fit on a
+// machine. CPU is the peak resident set as the OS counts it. GPU memory is
+// only reported by some drivers (NVX_gpu_memory_info, ATI_meminfo), and
+// then for the whole device: the peak is what was in use at the lowest free
+// memory seen by update(), other processes included.
+class MemoryMonitor {
+public:
+    MemoryMonitor();
+
+    void			setup();		// with a GL context, finds out what the driver reports
+    void			update();		// samples the GPU, call now and then on the GL thread
+
+    uint64_t		getPeakCpuBytes() const;
+    bool			hasGpuInfo() const			{ return gpuInfo != GPU_INFO_NONE; }
+    uint64_t		getGpuTotalBytes() const	{ return gpuTotalBytes; }	// 0 when the driver doesn't tell
+    uint64_t		getGpuFreeBytes() const		{ return gpuFreeBytes; }
+    uint64_t		getPeakGpuBytes() const;	// used at the lowest free memory, 0 without the total
+
+protected:
+    enum gpuInfoEnum {
+        GPU_INFO_NONE = 0,
+        GPU_INFO_NVX,
+        GPU_INFO_ATI
+    };
+
+    gpuInfoEnum		gpuInfo;
+    uint64_t		gpuTotalBytes;
+    uint64_t		gpuFreeBytes;
+    uint64_t		minGpuFreeBytes;
+};
@@ -0,0 +1,114 @@
+#include "MotionGate.h"
+
+
+//--------------------------------------------------------------
+MotionGate::MotionGate() {
+    width = 0;
+    height = 0;
+    blockSize = 8;
+    gridWidth = 0;
+    gridHeight = 0;
+    energyThreshold = 0.002;
+    areaThreshold = 2;
+    holdFrames = 15;
+    holdCounter = 0;
+    bHasReference = false;
+    referenceArea = 0;
+    referenceRegions = 0;
+    referenceNearMm = 0;
+    referenceFarMm = 0;
+    energy = 0;
+    area = 0;
+    numRegions = 0;
+}
+
+//--------------------------------------------------------------
+void MotionGate::setup(int _width, int _height, int _blockSize) {
+    width = _width;
+    height = _height;
+    blockSize = max(_blockSize, 2);
+    gridWidth = width / blockSize;
+    gridHeight = height / blockSize;
+    occupancy.assign(gridWidth * gridHeight, 0);
+    reference.assign(gridWidth * gridHeight, 0);
+    visited.assign(gridWidth * gridHeight, 0);
+    bHasReference = false;
+}
+
+//--------------------------------------------------------------
+bool MotionGate::update(const ofShortPixels& _depth, int _nearMm, int _farMm) {
+    const unsigned short* depth = _depth.getData();
+    const unsigned short nearMm = max(_nearMm, 1);
+    const unsigned short range = max(_farMm, (int)nearMm) - nearMm;
+    const float sampleWeight = 1.0 / ((blockSize / 2) * (blockSize / 2));
+
+    area = 0;
+    energy = 0;
+    for (int by=0; by<gridHeight; by++) {
+        for (int bx=0; bx<gridWidth; bx++) {
+            int count = 0;
+            for (int y=by * blockSize; y<(by + 1) * blockSize; y+=2) {
+                const unsigned short* row = depth + (size_t)y * width + bx * blockSize;
+                for (int x=0; x<blockSize; x+=2) {
+                    // unsigned wrap puts readings below near out of range, like the band pass
+                    count += (unsigned short)(row[x] - nearMm) <= range;
+                }
+            }
+            int block = by * gridWidth + bx;
+            occupancy[block] = count * sampleWeight;
+            energy += fabs(occupancy[block] - reference[block]);
+            if (occupancy[block] > 0.5)
+                area++;
+        }
+    }
+    energy /= max(gridWidth * gridHeight, 1);
+    numRegions = countRegions();
+
+    bool bChanged = !bHasReference || energy > energyThreshold || numRegions != referenceRegions ||
+                    abs(area - referenceArea) > areaThreshold || _nearMm != referenceNearMm || _farMm != referenceFarMm;
+    if (bChanged) {
+        reference = occupancy;
+        referenceArea = area;
+        referenceRegions = numRegions;
+        referenceNearMm = _nearMm;
+        referenceFarMm = _farMm;
+        bHasReference = true;
+        holdCounter = holdFrames;
+        return true;
+    }
+    if (holdCounter > 0) {
+        holdCounter--;
+        return true;
+    }
+    return false;
+}
+
+//--------------------------------------------------------------
+int MotionGate::countRegions() {
+    // 4-connected flood fill over the occupied blocks, the grid is tiny
+    fill(visited.begin(), visited.end(), 0);
+    int count = 0;
+    for (int start=0; start<(int)occupancy.size(); start++) {
+        if (visited[start] || occupancy[start] <= 0.5)
+            continue;
+        count++;
+        regionStack.clear();
+        regionStack.push_back(start);
+        visited[start] = 1;
+        while (!regionStack.empty()) {
+            int block = regionStack.back();
+            regionStack.pop_back();
+            int x = block % gridWidth;
+            int y = block / gridWidth;
+            int neighbors[4] = { x > 0 ? block - 1 : -1, x < gridWidth - 1 ? block + 1 : -1,
+                                 y > 0 ? block - gridWidth : -1, y < gridHeight - 1 ? block + gridWidth : -1 };
+            for (int n : neighbors) {
+                if (n >= 0 && !visited[n] && occupancy[n] > 0.5) {
+                    visited[n] = 1;
+                    regionStack.push_back(n);
+                }
+            }
+        }
+    }
+    return count;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Decides whether a depth frame differs enough from the last one let through
+// to be worth processing. The band is sampled on a coarse block grid (every
+// other pixel of every block), and a frame passes when
+//  - the mean absolute change of block occupancy exceeds the energy threshold,
+//  - the number of occupied regions on the grid changes,
+//  - the occupied area changes by more than the area threshold (in blocks), or
+//  - the band itself changes.
+// Comparing against the last passed frame rather than the previous one
+// catches slow drifts; a few frames after the last change pass as well, so
+// the optical flow can settle back to zero.
+class MotionGate {
+public:
+    MotionGate();
+
+    void			setup(int _width, int _height, int _blockSize = 8);
+    void			setThresholds(float _energy, float _area)	{ energyThreshold = _energy; areaThreshold = _area; }
+    void			setHoldFrames(int _frames)					{ holdFrames = _frames; }
+    void			reset()										{ bHasReference = false; }	// passes the next frame
+
+    bool			update(const ofShortPixels& _depth, int _nearMm, int _farMm);	// true when the frame should be processed
+
+    float			getEnergy() const		{ return energy; }
+    int				getArea() const			{ return area; }
+    int				getNumRegions() const	{ return numRegions; }
+
+protected:
+    int				countRegions();
+
+    int				width;
+    int				height;
+    int				blockSize;
+    int				gridWidth;
+    int				gridHeight;
+
+    float			energyThreshold;
+    float			areaThreshold;
+    int				holdFrames;
+    int				holdCounter;
+
+    vector<float>	occupancy;			// fraction of sampled pixels in band, per block
+    vector<float>	reference;			// of the last passed frame
+    vector<int>		regionStack;
+    vector<unsigned char> visited;
+    bool			bHasReference;
+    int				referenceArea;
+    int				referenceRegions;
+    int				referenceNearMm;
+    int				referenceFarMm;
+
+    float			energy;
+    int				area;
+    int				numRegions;
+};
@@ -0,0 +1,115 @@
+#include "ObstacleMap.h"
+
+
+//--------------------------------------------------------------
+ObstacleMap::ObstacleMap() {
+    width = 0;
+    height = 0;
+    tileSize = 16;
+    tilesX = 0;
+    tilesY = 0;
+    numCells = 0;
+}
+
+//--------------------------------------------------------------
+void ObstacleMap::downsample(const ofPixels& _mask, ofPixels& _grid, int _gridWidth, int _gridHeight) {
+    if ((int)_grid.getWidth() != _gridWidth || (int)_grid.getHeight() != _gridHeight || _grid.getNumChannels() != 1)
+        _grid.allocate(_gridWidth, _gridHeight, 1);
+
+    int maskWidth = _mask.getWidth();
+    int maskHeight = _mask.getHeight();
+    int channels = _mask.getNumChannels();
+    const unsigned char* mask = _mask.getData();
+    unsigned char* grid = _grid.getData();
+
+    // the mask pixels each cell covers, every pixel is read once
+    vector<int> columnStart(_gridWidth + 1);
+    for (int x=0; x<=_gridWidth; x++)
+        columnStart[x] = min(x * maskWidth / _gridWidth, maskWidth);
+    vector<int> counts(_gridWidth);
+
+    for (int y=0; y<_gridHeight; y++) {
+        int rowStart = y * maskHeight / _gridHeight;
+        int rowEnd = max((y + 1) * maskHeight / _gridHeight, rowStart + 1);
+        fill(counts.begin(), counts.end(), 0);
+        for (int row=rowStart; row<rowEnd && row<maskHeight; row++) {
+            const unsigned char* line = mask + (size_t)row * maskWidth * channels;
+            for (int x=0; x<_gridWidth; x++) {
+                int end = max(columnStart[x + 1], columnStart[x] + 1);
+                for (int column=columnStart[x]; column<end && column<maskWidth; column++)
+                    counts[x] += line[column * channels] > 127;
+            }
+        }
+        for (int x=0; x<_gridWidth; x++) {
+            int area = max(columnStart[x + 1] - columnStart[x], 1) * (rowEnd - rowStart);
+            grid[(size_t)y * _gridWidth + x] = counts[x] * 2 > area ? 255 : 0;
+        }
+    }
+}
+
+//--------------------------------------------------------------
+void ObstacleMap::setup(int _width, int _height, int _tileSize) {
+    width = max(_width, 1);
+    height = max(_height, 1);
+    tileSize = max(_tileSize, 1);
+    tilesX = (width + tileSize - 1) / tileSize;
+    tilesY = (height + tileSize - 1) / tileSize;
+    pixels.allocate(width, height, 1);
+    pixels.set(0);
+    numCells = 0;
+    dirtyTiles.clear();
+}
+
+//--------------------------------------------------------------
+void ObstacleMap::clear() {
+    dirtyTiles.clear();
+    if (numCells == 0)
+        return;
+    pixels.set(0);
+    numCells = 0;
+    dirtyTiles.push_back(ofRectangle(0, 0, width, height));
+}
+
+//--------------------------------------------------------------
+bool ObstacleMap::update(const ofPixels& _grid, bool _flipX) {
+    dirtyTiles.clear();
+    if ((int)_grid.getWidth() != width || (int)_grid.getHeight() != height)
+        return false;
+
+    const unsigned char* grid = _grid.getData();
+    unsigned char* current = pixels.getData();
+    for (int ty=0; ty<tilesY; ty++) {
+        int y0 = ty * tileSize;
+        int y1 = min(y0 + tileSize, height);
+        for (int tx=0; tx<tilesX; tx++) {
+            int x0 = tx * tileSize;
+            int x1 = min(x0 + tileSize, width);
+
+            bool bChanged = false;
+            for (int y=y0; y<y1 && !bChanged; y++) {
+                const unsigned char* src = grid + (size_t)y * width;
+                const unsigned char* dst = current + (size_t)y * width;
+                for (int x=x0; x<x1; x++) {
+                    if (dst[x] != src[_flipX ? width - 1 - x : x]) {
+                        bChanged = true;
+                        break;
+                    }
+                }
+            }
+            if (!bChanged)
+                continue;
+
+            for (int y=y0; y<y1; y++) {
+                const unsigned char* src = grid + (size_t)y * width;
+                unsigned char* dst = current + (size_t)y * width;
+                for (int x=x0; x<x1; x++) {
+                    unsigned char value = src[_flipX ? width - 1 - x : x];
+                    numCells += (value != 0) - (dst[x] != 0);
+                    dst[x] = value;
+                }
+            }
+            dirtyTiles.push_back(ofRectangle(x0, y0, x1 - x0, y1 - y0));
+        }
+    }
+    return !dirtyTiles.empty();
+}
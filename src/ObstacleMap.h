@@ -0,0 +1,38 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Bodies in front of the sensor as a fluid obstacle at the simulation
+// resolution. The capture thread shrinks the band-passed mask to the grid
+// with downsample(); the render thread passes each new grid to update(),
+// which keeps the current obstacle and lists the tiles that differ from it,
+// so only those need to be uploaded or copied into a solver.
+class ObstacleMap {
+public:
+    ObstacleMap();
+
+    // a cell is an obstacle when more than half of the mask pixels it covers are set
+    static void		downsample(const ofPixels& _mask, ofPixels& _grid, int _gridWidth, int _gridHeight);
+
+    void			setup(int _width, int _height, int _tileSize = 16);	// empty, like a freshly set up simulation
+    void			clear();			// an empty obstacle, every tile that had one is dirty
+
+    bool			update(const ofPixels& _grid, bool _flipX);	// true when any tile changed, grids of another size are ignored
+
+    int				getWidth() const			{ return width; }
+    int				getHeight() const			{ return height; }
+    const ofPixels&	getPixels() const			{ return pixels; }	// 255 inside the obstacle
+    const vector<ofRectangle>& getDirtyTiles() const	{ return dirtyTiles; }	// of the last update, in cells
+    int				getNumTiles() const			{ return tilesX * tilesY; }
+    int				getNumCells() const			{ return numCells; }	// inside the obstacle
+
+protected:
+    int				width;
+    int				height;
+    int				tileSize;
+    int				tilesX;
+    int				tilesY;
+    ofPixels		pixels;
+    vector<ofRectangle> dirtyTiles;
+    int				numCells;
+};
@@ -0,0 +1,15 @@
+#include "ParticleFlow.h"
+#include "GpuParticleFlow.h"
+#include "CpuParticleFlow.h"
+
+
+//--------------------------------------------------------------
+shared_ptr<ParticleFlow> ParticleFlow::create(particleBackendEnum _backend, int _maxParticles, ThreadPool* _pool) {
+    switch (_backend) {
+        case PARTICLE_BACKEND_CPU:
+            return make_shared<CpuParticleFlow>(_maxParticles, _pool);
+        case PARTICLE_BACKEND_GPU:
+        default:
+            return make_shared<GpuParticleFlow>();
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "ofMain.h"
+#include "FieldPrecision.h"
+
+class ThreadPool;
+class ProgramCache;
+
+// Particle backends selectable from the command line (--particles)
+enum particleBackendEnum {
+    PARTICLE_BACKEND_GPU = 0,
+    PARTICLE_BACKEND_CPU
+};
+
+// The part of ftParticleFlow the app uses, so the shader particles and the
+// CPU particles can be swapped at startup, like FluidSimulation.
+class ParticleFlow {
+public:
+    virtual ~ParticleFlow() {}
+
+    virtual void	setup(int _simulationWidth, int _simulationHeight, int _drawWidth, int _drawHeight, const FieldPrecision& _precision) = 0;
+    virtual void	update(float _deltaTime = 0) = 0;	// 0 uses the last frame time
+    virtual void	draw(int _x, int _y, int _width, int _height) = 0;
+    virtual bool	isActive() = 0;
+    virtual string	getName() const = 0;
+
+    virtual void	setSpeed(float _value) = 0;
+    virtual void	setCellSize(float _value) = 0;
+    virtual void	addFlowVelocity(ofTexture& _texture, float _strength = 1.0) = 0;
+    virtual void	addFluidVelocity(ofTexture& _texture, float _strength = 1.0) = 0;
+    virtual void	setObstacle(ofTexture& _texture) = 0;
+
+    virtual ofParameterGroup& getParameters() = 0;
+
+    // fraction of the particles to keep alive, for when frames run over budget
+    virtual void	setBudget(float _fraction) = 0;
+
+    // positions of the live particles normalized to the simulation, for analysis; false where not supported
+    virtual bool	savePositions(const string& _path) { return false; }
+
+    // for the shaders the app compiles itself, before the first setup; flowtools compiles its own
+    virtual void	setProgramCache(ProgramCache* _cache) {}
+
+    // the format setup() stores the particles in for a precision, the rest as given
+    virtual FieldPrecision	getStoredPrecision(const FieldPrecision& _precision) const	{ return _precision; }
+
+    // _maxParticles and _pool are only used by the CPU backend
+    static shared_ptr<ParticleFlow> create(particleBackendEnum _backend, int _maxParticles = 0, ThreadPool* _pool = nullptr);
+};
@@ -0,0 +1,87 @@
+#include "PrecisionValidator.h"
+#include "StageProfiler.h"
+
+
+//--------------------------------------------------------------
+void PrecisionValidator::clear() {
+    reference.clear();
+    runs.clear();
+}
+
+//--------------------------------------------------------------
+bool PrecisionValidator::addRun(const string& _name, const string& _storedAs, float _frameMillis, const vector<pair<string, ofFloatPixels> >& _fields) {
+    Run run;
+    run.name = _name;
+    run.storedAs = _storedAs;
+    run.frameMillis = _frameMillis;
+    if (runs.empty()) {
+        reference = _fields;
+        runs.push_back(run);
+        return true;
+    }
+
+    if (_fields.size() != reference.size())
+        return false;
+    for (size_t i=0; i<_fields.size(); i++) {
+        const ofFloatPixels& expected = reference[i].second;
+        const ofFloatPixels& pixels = _fields[i].second;
+        if (pixels.getWidth() != expected.getWidth() || pixels.getHeight() != expected.getHeight() || pixels.getNumChannels() != expected.getNumChannels())
+            return false;
+        FieldError error = compare(expected, pixels);
+        error.name = _fields[i].first;
+        run.errors.push_back(error);
+    }
+    run.speedup = _frameMillis > 0 ? runs.front().frameMillis / _frameMillis : 0;
+    runs.push_back(run);
+    return true;
+}
+
+//--------------------------------------------------------------
+PrecisionValidator::FieldError PrecisionValidator::compare(const ofFloatPixels& _reference, const ofFloatPixels& _pixels) {
+    FieldError error;
+    const float* expected = _reference.getData();
+    const float* values = _pixels.getData();
+    size_t size = (size_t)_reference.getWidth() * _reference.getHeight() * _reference.getNumChannels();
+    if (size == 0)
+        return error;
+
+    double sumSquares = 0;
+    double sumReferenceSquares = 0;
+    for (size_t i=0; i<size; i++) {
+        double difference = values[i] - expected[i];
+        error.maxError = max(error.maxError, (float)fabs(difference));
+        sumSquares += difference * difference;
+        sumReferenceSquares += (double)expected[i] * expected[i];
+    }
+    error.rmsError = sqrt(sumSquares / size);
+    double referenceRms = sqrt(sumReferenceSquares / size);
+    error.relativeRmsError = referenceRms > 0 ? error.rmsError / referenceRms : 0;
+    return error;
+}
+
+//--------------------------------------------------------------
+bool PrecisionValidator::saveJson(const string& _path, const vector<pair<string, string> >& _info) const {
+    ofstream out(ofToDataPath(_path, true).c_str());
+    if (!out)
+        return false;
+
+    out << setprecision(6);
+    out << "{" << endl;
+    for (auto& info : _info)
+        out << "  \"" << StageProfiler::jsonEscape(info.first) << "\": \"" << StageProfiler::jsonEscape(info.second) << "\"," << endl;
+    out << "  \"reference\": \"" << (runs.empty() ? string() : StageProfiler::jsonEscape(runs.front().name)) << "\"," << endl;
+    out << "  \"runs\": [" << endl;
+    for (size_t i=0; i<runs.size(); i++) {
+        const Run& run = runs[i];
+        out << "    {\"precision\": \"" << StageProfiler::jsonEscape(run.name) << "\", \"storedAs\": \"" << StageProfiler::jsonEscape(run.storedAs)
+            << "\", \"frameMillis\": " << run.frameMillis << ", \"speedup\": " << run.speedup << ", \"fields\": {";
+        for (size_t j=0; j<run.errors.size(); j++) {
+            const FieldError& error = run.errors[j];
+            out << (j > 0 ? ", " : "") << "\"" << StageProfiler::jsonEscape(error.name) << "\": {\"max\": " << error.maxError << ", \"rms\": " << error.rmsError
+                << ", \"relativeRms\": " << error.relativeRmsError << "}";
+        }
+        out << "}}" << (i + 1 < runs.size() ? "," : "") << endl;
+    }
+    out << "  ]" << endl << "}" << endl;
+    return out.good();
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Compares the fields at the end of runs at different precisions against
+// the first run, the fp32 reference. Every run replays the same frames, so
+// whatever differs was lost to the storage formats: the maximum and RMS
+// difference over all cells and channels, and the RMS relative to the
+// reference's own RMS, which makes fields of different scales comparable.
+// Speedup is the reference's mean frame time over the run's.
+class PrecisionValidator {
+public:
+    struct FieldError {
+        FieldError() : maxError(0), rmsError(0), relativeRmsError(0) {}
+        string		name;
+        float		maxError;
+        float		rmsError;
+        float		relativeRmsError;	// 0 when the reference field is empty
+    };
+
+    struct Run {
+        Run() : frameMillis(0), speedup(1) {}
+        string		name;
+        string		storedAs;			// the formats the backends actually used, as FieldPrecision::getName()
+        float		frameMillis;		// mean
+        float		speedup;
+        vector<FieldError> errors;		// empty for the reference
+    };
+
+    void			clear();
+    // the fields in the same order and sizes on every run; false when they don't match the reference
+    bool			addRun(const string& _name, const string& _storedAs, float _frameMillis, const vector<pair<string, ofFloatPixels> >& _fields);
+
+    const vector<Run>&	getRuns() const		{ return runs; }
+    bool			saveJson(const string& _path, const vector<pair<string, string> >& _info) const;
+
+    static FieldError	compare(const ofFloatPixels& _reference, const ofFloatPixels& _pixels);
+
+protected:
+    vector<pair<string, ofFloatPixels> > reference;
+    vector<Run>		runs;
+};
@@ -0,0 +1,129 @@
+#include "ProgramCache.h"
+
+// linked first on a restore, the binary replaces them
+static const string emptyVertexShader = "#version 150\nvoid main() { gl_Position = vec4(0.0); }\n";
+static const string emptyFragmentShader = "#version 150\nout vec4 fragColor;\nvoid main() { fragColor = vec4(0.0); }\n";
+
+
+//--------------------------------------------------------------
+ProgramCache::ProgramCache() {
+    bSupported = false;
+}
+
+//--------------------------------------------------------------
+static uint64_t hashString(const string& _value, uint64_t _hash = 14695981039346656037ULL) {
+    // FNV-1a, the same on every platform and build unlike std::hash
+    for (unsigned char c : _value) {
+        _hash ^= c;
+        _hash *= 1099511628211ULL;
+    }
+    return _hash;
+}
+
+//--------------------------------------------------------------
+static string getGLString(GLenum _name) {
+    const GLubyte* value = glGetString(_name);
+    return value ? string((const char*)value) : string();
+}
+
+//--------------------------------------------------------------
+void ProgramCache::setup(const string& _path) {
+    path = _path;
+    driver = getGLString(GL_VENDOR) + "\n" + getGLString(GL_RENDERER) + "\n" + getGLString(GL_VERSION);
+    stats = Stats();
+
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    bSupported = numFormats > 0 && ofDirectory::createDirectory(path, false, true);
+    if (numFormats <= 0)
+        ofLogNotice("ProgramCache") << "the driver keeps no program binaries, shaders compile on every launch";
+    else if (!bSupported)
+        ofLogWarning("ProgramCache") << "could not create " << path << ", shaders compile on every launch";
+}
+
+//--------------------------------------------------------------
+bool ProgramCache::load(ofShader& _shader, const string& _vertexSource, const string& _fragmentSource, const vector<pair<GLuint, string> >& _attributes) {
+    uint64_t start = ofGetElapsedTimeMicros();
+    bool loaded;
+    if (!bSupported) {
+        loaded = compile(_shader, _vertexSource, _fragmentSource, _attributes);
+        stats.numCompiled++;
+    }
+    else {
+        uint64_t hash = hashString(driver);
+        hash = hashString(_vertexSource, hash);
+        hash = hashString(_fragmentSource, hash);
+        for (const pair<GLuint, string>& attribute : _attributes)
+            hash = hashString(ofToString((int)attribute.first) + attribute.second, hash);
+        string filePath = ofFilePath::join(path, ofToHex(hash) + ".bin");
+
+        loaded = restore(_shader, filePath);
+        if (loaded) {
+            stats.numRestored++;
+        }
+        else {
+            // stale or refused binaries are written over
+            _shader.unload();
+            loaded = compile(_shader, _vertexSource, _fragmentSource, _attributes, true);
+            if (loaded)
+                store(_shader, filePath);
+            stats.numCompiled++;
+        }
+    }
+    stats.millis += (ofGetElapsedTimeMicros() - start) / 1000.0f;
+    return loaded;
+}
+
+//--------------------------------------------------------------
+bool ProgramCache::compile(ofShader& _shader, const string& _vertexSource, const string& _fragmentSource, const vector<pair<GLuint, string> >& _attributes, bool _retrievable) {
+    if (!_shader.setupShaderFromSource(GL_VERTEX_SHADER, _vertexSource) || !_shader.setupShaderFromSource(GL_FRAGMENT_SHADER, _fragmentSource))
+        return false;
+    _shader.bindDefaults();
+    for (const pair<GLuint, string>& attribute : _attributes)
+        _shader.bindAttribute(attribute.first, attribute.second);
+    // the program exists once a stage is attached, the hint has to be set before linking
+    if (_retrievable)
+        glProgramParameteri(_shader.getProgram(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    if (!_shader.linkProgram())
+        return false;
+    GLint status = GL_FALSE;
+    glGetProgramiv(_shader.getProgram(), GL_LINK_STATUS, &status);
+    return status == GL_TRUE;
+}
+
+//--------------------------------------------------------------
+bool ProgramCache::restore(ofShader& _shader, const string& _filePath) {
+    if (!ofFile::doesFileExist(_filePath, false))
+        return false;
+    ofBuffer buffer = ofBufferFromFile(_filePath, true);
+    GLenum format;
+    if (buffer.size() <= sizeof(format))
+        return false;
+    memcpy(&format, buffer.getData(), sizeof(format));
+
+    if (!compile(_shader, emptyVertexShader, emptyFragmentShader, vector<pair<GLuint, string> >()))
+        return false;
+    glProgramBinary(_shader.getProgram(), format, buffer.getData() + sizeof(format), buffer.size() - sizeof(format));
+    GLint status = GL_FALSE;
+    glGetProgramiv(_shader.getProgram(), GL_LINK_STATUS, &status);
+    return status == GL_TRUE;
+}
+
+//--------------------------------------------------------------
+void ProgramCache::store(const ofShader& _shader, const string& _filePath) {
+    GLint length = 0;
+    glGetProgramiv(_shader.getProgram(), GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    // the binary's format first, then the binary
+    GLenum format = 0;
+    vector<char> data(sizeof(format) + length);
+    GLsizei written = 0;
+    glGetProgramBinary(_shader.getProgram(), length, &written, &format, data.data() + sizeof(format));
+    if (written <= 0)
+        return;
+    memcpy(data.data(), &format, sizeof(format));
+    if (!ofBufferToFile(_filePath, ofBuffer(data.data(), sizeof(format) + written), true))
+        ofLogWarning("ProgramCache") << "could not write " << _filePath;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Keeps the app's own linked GL programs on disk as driver binaries
+// (glGetProgramBinary) and restores them with glProgramBinary on later
+// launches, which skips compiling and linking them. Each binary is keyed on
+// the GL vendor, renderer and version and on a hash of the sources and
+// attributes, so a driver update or an edited shader compiles again. A
+// binary the driver refuses is compiled over; a driver that offers no
+// binary formats (macOS) compiles every time.
+//
+// ofShader can't take in a program it didn't link, so a restored shader is
+// linked from two empty stages first and the binary then replaces that
+// program. The flowtools shaders are compiled in its constructors and don't
+// come through here.
+class ProgramCache {
+public:
+    ProgramCache();
+
+    struct Stats {
+        Stats() : numRestored(0), numCompiled(0), millis(0) {}
+        int			numRestored;	// from the disk
+        int			numCompiled;
+        float		millis;			// spent in load(), either way
+    };
+
+    // needs the GL context, the folder is created when missing
+    void			setup(const string& _path);
+    bool			isSupported() const			{ return bSupported; }
+
+    // links _shader with the default attributes plus _attributes, from the disk when it was stored before
+    bool			load(ofShader& _shader, const string& _vertexSource, const string& _fragmentSource,
+                         const vector<pair<GLuint, string> >& _attributes = vector<pair<GLuint, string> >());
+    const Stats&	getStats() const			{ return stats; }
+
+    // without a cache
+    static bool		compile(ofShader& _shader, const string& _vertexSource, const string& _fragmentSource,
+                            const vector<pair<GLuint, string> >& _attributes, bool _retrievable = false);
+
+protected:
+    bool			restore(ofShader& _shader, const string& _filePath);
+    void			store(const ofShader& _shader, const string& _filePath);
+
+    string			path;
+    string			driver;
+    bool			bSupported;
+    Stats			stats;
+};
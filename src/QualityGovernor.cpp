@@ -0,0 +1,95 @@
+#include "QualityGovernor.h"
+#include <algorithm>
+#include <cstdio>
+
+using namespace std;
+
+
+//--------------------------------------------------------------
+QualityGovernor::QualityGovernor() {
+    budget = 1000.0f / 60.0f;
+    percentile = 95;
+    headroom = 0.75;
+    settleSeconds = 2;
+    baseUpDelay = 5;
+    maxUpDelay = 120;
+    minSamples = 30;
+
+    // cheapest savings first: visualizers, particles, solver, and only then the flow grid
+    vector<QualityLevel> defaults;
+    defaults.push_back(QualityLevel(1.0, 1.0, 1.0, 1.0));
+    defaults.push_back(QualityLevel(1.0, 1.0, 1.0, 0.5));
+    defaults.push_back(QualityLevel(1.0, 1.0, 0.5, 0.5));
+    defaults.push_back(QualityLevel(1.0, 0.6, 0.5, 0.5));
+    defaults.push_back(QualityLevel(1.0, 0.6, 0.25, 0.5));
+    defaults.push_back(QualityLevel(0.8, 0.6, 0.25, 0.5));
+    defaults.push_back(QualityLevel(0.67, 0.4, 0.25, 0.5));
+    defaults.push_back(QualityLevel(0.5, 0.4, 0.25, 0.5));
+    setLadder(defaults);
+}
+
+//--------------------------------------------------------------
+void QualityGovernor::setLadder(const vector<QualityLevel>& _ladder) {
+    ladder = _ladder;
+    if (ladder.empty())
+        ladder.push_back(QualityLevel());
+    reset();
+}
+
+//--------------------------------------------------------------
+void QualityGovernor::reset() {
+    // long enough for the settling time plus a few seconds, in quarter milliseconds up to 100
+    frames.setup(settleSeconds + 1, 0.25, 400);
+    upDelays.assign(ladder.size(), baseUpDelay);
+    level = 0;
+    lastChangeTime = 0;
+    lastUpTime = -1;
+    underSince = -1;
+    reason.clear();
+}
+
+//--------------------------------------------------------------
+bool QualityGovernor::update(float _frameMillis, double _time) {
+    frames.add(_frameMillis, _time);
+    if (_time - lastChangeTime < settleSeconds || frames.getCount() < minSamples)
+        return false;
+
+    float load = getLoad();
+    char text[128];
+    if (load > budget) {
+        underSince = -1;
+        if (level + 1 >= (int)ladder.size())
+            return false;
+        // straight back down from a level just reached, try it less often
+        if (lastUpTime >= 0 && _time - lastUpTime < upDelays[level] + settleSeconds)
+            upDelays[level] = min(upDelays[level] * 2, maxUpDelay);
+        lastUpTime = -1;
+        snprintf(text, sizeof(text), "p%.0f %.1fms over the %.1fms budget", percentile, load, budget);
+        setLevel(level + 1, _time, text);
+        return true;
+    }
+
+    if (load > budget * headroom || level == 0) {
+        underSince = -1;
+        return false;
+    }
+    if (underSince < 0)
+        underSince = _time;
+    double delay = upDelays[level - 1];
+    if (_time - underSince < delay)
+        return false;
+
+    snprintf(text, sizeof(text), "p%.0f %.1fms under %.0f%% of the %.1fms budget for %.0fs", percentile, load, headroom * 100, budget, delay);
+    setLevel(level - 1, _time, text);
+    lastUpTime = _time;
+    return true;
+}
+
+//--------------------------------------------------------------
+void QualityGovernor::setLevel(int _level, double _time, const string& _reason) {
+    level = _level;
+    reason = _reason;
+    lastChangeTime = _time;
+    underSince = -1;
+    frames.clear();
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "RollingStats.h"
+
+// One rung of the quality ladder, the first rung is full quality. Each
+// value scales what is set in the gui.
+struct QualityLevel {
+    QualityLevel(float _flowScale = 1, float _iterationScale = 1, float _particleScale = 1, float _fieldScale = 1) :
+        flowScale(_flowScale), iterationScale(_iterationScale), particleScale(_particleScale), fieldScale(_fieldScale) {}
+
+    float	flowScale;			// of the flow grid size
+    float	iterationScale;		// of the solver iterations
+    float	particleScale;		// of the particle capacity
+    float	fieldScale;			// of the field visualizer grid size
+};
+
+// Moves along a quality ladder to keep a percentile of the frame time within
+// a budget. Frames over budget step down after a short settling time; frames
+// well under it step up only after they have stayed there for a while. A
+// level that had to be left again soon after stepping up to it waits twice
+// as long before the next try, so a load right at the edge of the budget
+// doesn't flip between two levels.
+//
+// Every change clears the measured frames, each decision is made on frames
+// rendered at the current level only.
+class QualityGovernor {
+public:
+    QualityGovernor();
+
+    void			setLadder(const std::vector<QualityLevel>& _ladder);
+    void			setBudget(float _millis, float _percentile = 95)	{ budget = _millis; percentile = _percentile; }
+    void			reset();		// back to full quality
+
+    bool			update(float _frameMillis, double _time);		// true when the level changed
+
+    int				getLevel() const			{ return level; }
+    int				getNumLevels() const		{ return ladder.size(); }
+    const QualityLevel& getQuality() const		{ return ladder[level]; }
+    float			getLoad() const				{ return frames.getPercentile(percentile); }
+    float			getBudget() const			{ return budget; }
+    const std::string& getReason() const		{ return reason; }		// of the last change
+
+protected:
+    void			setLevel(int _level, double _time, const std::string& _reason);
+
+    std::vector<QualityLevel> ladder;
+    std::vector<double> upDelays;		// seconds under budget before stepping up to each level
+    RollingStats	frames;
+    float			budget;
+    float			percentile;
+    float			headroom;			// fraction of the budget to stay under before stepping up
+    double			settleSeconds;
+    double			baseUpDelay;
+    double			maxUpDelay;
+    int				minSamples;
+
+    int				level;
+    double			lastChangeTime;
+    double			lastUpTime;
+    double			underSince;			// negative while over the headroom
+    std::string		reason;
+};
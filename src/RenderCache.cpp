@@ -0,0 +1,33 @@
+#include "RenderCache.h"
+
+
+//--------------------------------------------------------------
+RenderCache::RenderCache() {
+    numRenders = 0;
+    numHits = 0;
+}
+
+//--------------------------------------------------------------
+void RenderCache::setup(int _width, int _height) {
+    if (fbo.isAllocated() && (int)fbo.getWidth() == _width && (int)fbo.getHeight() == _height)
+        return;
+    fbo.allocate(max(_width, 1), max(_height, 1), GL_RGBA);
+    key.clear();
+}
+
+//--------------------------------------------------------------
+bool RenderCache::begin(const vector<double>& _key) {
+    if (!key.empty() && _key == key) {
+        numHits++;
+        return false;
+    }
+    key = _key;
+    numRenders++;
+    fbo.begin();
+    return true;
+}
+
+//--------------------------------------------------------------
+void RenderCache::end() {
+    fbo.end();
+}
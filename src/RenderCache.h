@@ -0,0 +1,29 @@
+#pragma once
+
+#include "ofMain.h"
+
+// A drawing kept in an fbo and drawn again until anything it shows changes.
+// What it depends on is passed to begin() as a key of plain values, e.g. the
+// simulation step and the settings involved; a key that differs from the one
+// the fbo was last rendered with means rendering again, an equal one means
+// the fbo is still good and nothing needs to be computed.
+class RenderCache {
+public:
+    RenderCache();
+
+    void			setup(int _width, int _height);		// drops the content when the size changes
+    void			invalidate()				{ key.clear(); }
+
+    bool			begin(const vector<double>& _key);	// true when the content must be rendered, then call end()
+    void			end();
+    void			draw(int _x, int _y)		{ fbo.draw(_x, _y); }
+
+    uint64_t		getNumRenders() const		{ return numRenders; }
+    uint64_t		getNumHits() const			{ return numHits; }
+
+protected:
+    ofFbo			fbo;
+    vector<double>	key;				// of the content, empty when there is none
+    uint64_t		numRenders;
+    uint64_t		numHits;
+};
@@ -0,0 +1,81 @@
+#include "RollingStats.h"
+#include <algorithm>
+#include <cmath>
+
+
+//--------------------------------------------------------------
+RollingStats::RollingStats() {
+    setup(10, 0.25, 400);
+}
+
+//--------------------------------------------------------------
+void RollingStats::setup(double _windowSeconds, float _binWidth, int _numBins) {
+    windowSeconds = _windowSeconds;
+    binWidth = _binWidth;
+    histogram.assign(std::max(_numBins, 2), 0);
+    clear();
+}
+
+//--------------------------------------------------------------
+void RollingStats::clear() {
+    samples.clear();
+    minQueue.clear();
+    maxQueue.clear();
+    std::fill(histogram.begin(), histogram.end(), 0);
+    sum = 0;
+}
+
+//--------------------------------------------------------------
+void RollingStats::add(float _value, double _time) {
+    evict(_time - windowSeconds);
+
+    Sample sample;
+    sample.time = _time;
+    sample.value = _value;
+    sample.bin = std::min(std::max((int)(_value / binWidth), 0), (int)histogram.size() - 1);
+
+    samples.push_back(sample);
+    histogram[sample.bin]++;
+    sum += _value;
+
+    // a new sample makes every larger (smaller) one before it irrelevant for the min (max)
+    while (!minQueue.empty() && minQueue.back().value >= _value)
+        minQueue.pop_back();
+    minQueue.push_back(sample);
+    while (!maxQueue.empty() && maxQueue.back().value <= _value)
+        maxQueue.pop_back();
+    maxQueue.push_back(sample);
+}
+
+//--------------------------------------------------------------
+void RollingStats::evict(double _time) {
+    while (!samples.empty() && samples.front().time < _time) {
+        const Sample& oldest = samples.front();
+        histogram[oldest.bin]--;
+        sum -= oldest.value;
+        if (!minQueue.empty() && minQueue.front().time <= oldest.time)
+            minQueue.pop_front();
+        if (!maxQueue.empty() && maxQueue.front().time <= oldest.time)
+            maxQueue.pop_front();
+        samples.pop_front();
+    }
+    if (samples.empty())
+        sum = 0;	// don't let rounding errors pile up
+}
+
+//--------------------------------------------------------------
+float RollingStats::getPercentile(float _percent) const {
+    if (samples.empty())
+        return 0;
+
+    int rank = std::ceil(_percent / 100.0f * samples.size());
+    rank = std::min(std::max(rank, 1), (int)samples.size());
+    int count = 0;
+    for (size_t i=0; i<histogram.size() - 1; i++) {
+        count += histogram[i];
+        if (count >= rank)
+            // upper edge of the bin, but never beyond what was actually seen
+            return std::min((i + 1) * binWidth, getMax());
+    }
+    return getMax();
+}
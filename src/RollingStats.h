@@ -0,0 +1,41 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+
+// Statistics over the samples of the last few seconds. Adding a sample is
+// O(1) amortized: min and max come from monotonic queues and percentiles
+// from a fixed-bin histogram, so nothing is rescanned per frame. Percentiles
+// are accurate to one bin width, values past the last bin count as max.
+class RollingStats {
+public:
+    RollingStats();
+
+    void	setup(double _windowSeconds, float _binWidth, int _numBins);
+    void	clear();
+    void	add(float _value, double _time);	// times must not decrease
+
+    int		getCount() const			{ return samples.size(); }
+    float	getMin() const				{ return minQueue.empty() ? 0 : minQueue.front().value; }
+    float	getMax() const				{ return maxQueue.empty() ? 0 : maxQueue.front().value; }
+    float	getMean() const				{ return samples.empty() ? 0 : sum / samples.size(); }
+    float	getLast() const				{ return samples.empty() ? 0 : samples.back().value; }
+    float	getPercentile(float _percent) const;
+
+protected:
+    struct Sample {
+        double	time;
+        float	value;
+        int		bin;
+    };
+
+    void	evict(double _time);
+
+    double				windowSeconds;
+    float				binWidth;
+    std::deque<Sample>	samples;
+    std::deque<Sample>	minQueue;	// increasing values, front is the min
+    std::deque<Sample>	maxQueue;	// decreasing values, front is the max
+    std::vector<int>	histogram;	// last bin collects everything above the range
+    double				sum;
+};
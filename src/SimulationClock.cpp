@@ -0,0 +1,42 @@
+#include "SimulationClock.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+
+//--------------------------------------------------------------
+SimulationClock::SimulationClock() {
+    step = 1.0 / 60.0;
+    maxSteps = 4;
+    accumulator = 0;
+    numSteps = 0;
+    numDropped = 0;
+}
+
+//--------------------------------------------------------------
+void SimulationClock::setStep(double _seconds) {
+    if (_seconds <= 0 || _seconds == step)
+        return;
+    // keep the fraction of a step already accumulated
+    accumulator *= _seconds / step;
+    step = _seconds;
+}
+
+//--------------------------------------------------------------
+void SimulationClock::reset() {
+    accumulator = 0;
+}
+
+//--------------------------------------------------------------
+int SimulationClock::advance(double _frameSeconds) {
+    if (_frameSeconds > 0)
+        accumulator += _frameSeconds;
+
+    double whole = floor(accumulator / step);
+    accumulator = max(accumulator - whole * step, 0.0);
+    int steps = (int)min(whole, (double)maxSteps);
+    numDropped += (uint64_t)whole - steps;
+    numSteps += steps;
+    return steps;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+// Turns variable frame times into whole simulation steps of a fixed length.
+// Frame time accumulates until it covers a step; a frame that covers more
+// runs several, up to a cap, and whatever is left beyond the cap is dropped
+// so a hitch slows the simulation down instead of snowballing. With a step
+// longer than the display interval some frames run no step at all and draw
+// the last state again.
+class SimulationClock {
+public:
+    SimulationClock();
+
+    void		setStep(double _seconds);
+    void		setMaxSteps(int _steps)			{ maxSteps = _steps < 1 ? 1 : _steps; }
+    void		reset();						// drops the accumulated time
+
+    int			advance(double _frameSeconds);	// steps to run for this frame
+
+    double		getStep() const					{ return step; }
+    int			getMaxSteps() const				{ return maxSteps; }
+    double		getMaxFrameTime() const			{ return step * maxSteps; }
+    float		getAlpha() const				{ return accumulator / step; }	// of the next step, for interpolation
+    uint64_t	getNumSteps() const				{ return numSteps; }			// since startup
+    uint64_t	getNumDropped() const			{ return numDropped; }			// to the cap
+
+protected:
+    double		step;
+    int			maxSteps;
+    double		accumulator;
+    uint64_t	numSteps;
+    uint64_t	numDropped;
+};
@@ -0,0 +1,126 @@
+#include "SourceSupervisor.h"
+#include <algorithm>
+
+using namespace std;
+
+
+//--------------------------------------------------------------
+SourceSupervisor::SourceSupervisor() {
+    fps = 30;
+    stallSeconds = 2;
+    minBackoff = 0.5;
+    maxBackoff = 8;
+    backoff = minBackoff;
+    bHasFrame = false;
+    lastFrameTime = 0;
+    deadlineTime = 0;
+    lostTime = 0;
+    nextAttemptTime = 0;
+}
+
+//--------------------------------------------------------------
+void SourceSupervisor::setup(float _fps, bool _connected, double _time) {
+    lock_guard<mutex> lock(statusMutex);
+    status = Status();
+    fps = max(_fps, 1.0f);
+    backoff = minBackoff;
+    bHasFrame = false;
+    lastFrameTime = _time;
+    deadlineTime = _time + stallSeconds;
+
+    // the first attempt was the one that just failed
+    if (!_connected) {
+        setLost(SOURCE_DISCONNECTED, _time);
+        nextAttemptTime = _time + backoff;
+        backoff = min(backoff * 2, maxBackoff);
+    }
+}
+
+//--------------------------------------------------------------
+void SourceSupervisor::setTimeouts(float _stallSeconds, float _minBackoff, float _maxBackoff) {
+    lock_guard<mutex> lock(statusMutex);
+    stallSeconds = max(_stallSeconds, 0.1f);
+    minBackoff = max(_minBackoff, 0.1f);
+    maxBackoff = max(_maxBackoff, minBackoff);
+    backoff = minBackoff;
+}
+
+//--------------------------------------------------------------
+void SourceSupervisor::frameArrived(double _time) {
+    lock_guard<mutex> lock(statusMutex);
+    float gap = _time - lastFrameTime;
+    if (bHasFrame && gap > 3 / fps) {
+        status.numGaps++;
+        status.longestGapMillis = max(status.longestGapMillis, gap * 1000);
+    }
+    bHasFrame = true;
+    lastFrameTime = _time;
+    deadlineTime = _time + stallSeconds;
+
+    if (status.state != SOURCE_CONNECTED) {
+        if (status.state == SOURCE_RECONNECTING)
+            status.numReconnects++;
+        status.state = SOURCE_CONNECTED;
+        backoff = minBackoff;
+    }
+}
+
+//--------------------------------------------------------------
+bool SourceSupervisor::isReopenDue(bool _connected, double _time) {
+    lock_guard<mutex> lock(statusMutex);
+    if (status.state == SOURCE_CONNECTED) {
+        if (_connected && _time < deadlineTime)
+            return false;
+        setLost(_connected ? SOURCE_STALLED : SOURCE_DISCONNECTED, _time);
+        nextAttemptTime = _time;
+    }
+    else if (!_connected) {
+        status.state = SOURCE_DISCONNECTED;
+    }
+    return _time >= nextAttemptTime;
+}
+
+//--------------------------------------------------------------
+void SourceSupervisor::reopened(bool _success, double _time) {
+    lock_guard<mutex> lock(statusMutex);
+    status.numAttempts++;
+    if (_success) {
+        // an open sensor gets at least the stall timeout to deliver its first frame
+        status.state = SOURCE_RECONNECTING;
+        nextAttemptTime = _time + max(backoff, stallSeconds);
+    }
+    else {
+        status.state = SOURCE_DISCONNECTED;
+        nextAttemptTime = _time + backoff;
+    }
+    backoff = min(backoff * 2, maxBackoff);
+}
+
+//--------------------------------------------------------------
+SourceSupervisor::Status SourceSupervisor::getStatus(double _time) const {
+    lock_guard<mutex> lock(statusMutex);
+    Status current = status;
+    current.secondsSinceFrame = max(_time - lastFrameTime, 0.0);
+    if (current.state != SOURCE_CONNECTED) {
+        current.secondsLost = max(_time - lostTime, 0.0);
+        current.secondsToRetry = max(nextAttemptTime - _time, 0.0);
+    }
+    return current;
+}
+
+//--------------------------------------------------------------
+string SourceSupervisor::getStateName(sourceStateEnum _state) {
+    switch (_state) {
+        case SOURCE_CONNECTED:		return "connected";
+        case SOURCE_STALLED:		return "stalled";
+        case SOURCE_DISCONNECTED:	return "disconnected";
+        case SOURCE_RECONNECTING:	return "reconnecting";
+    }
+    return "unknown";
+}
+
+//--------------------------------------------------------------
+void SourceSupervisor::setLost(sourceStateEnum _state, double _time) {
+    status.state = _state;
+    lostTime = _time;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+#include <mutex>
+#include <string>
+
+enum sourceStateEnum {
+    SOURCE_CONNECTED = 0,
+    SOURCE_STALLED,			// open, but no frame for longer than the stall timeout
+    SOURCE_DISCONNECTED,	// closed or failed to open, waiting for the next attempt
+    SOURCE_RECONNECTING		// reopened, waiting for its first frame
+};
+
+// Watches the frames of a live sensor and decides when it has to be closed
+// and opened again. A sensor that reports itself disconnected or stops
+// delivering for the stall timeout is reopened right away; every failed
+// attempt, or one that opens but delivers nothing, doubles the wait before
+// the next one up to the maximum backoff. The first frame resets it.
+//
+// Only the capture thread reports frames and attempts; the status can be
+// read from any thread. Times are in seconds on any steady clock.
+class SourceSupervisor {
+public:
+    SourceSupervisor();
+
+    struct Status {
+        Status() : state(SOURCE_CONNECTED), numAttempts(0), numReconnects(0), numGaps(0), longestGapMillis(0), secondsSinceFrame(0), secondsLost(0), secondsToRetry(0) {}
+        sourceStateEnum	state;
+        uint64_t		numAttempts;		// to reopen the sensor
+        uint64_t		numReconnects;		// that brought frames back
+        uint64_t		numGaps;			// between frames longer than a few source periods, outages included
+        float			longestGapMillis;
+        float			secondsSinceFrame;
+        float			secondsLost;		// since the state left SOURCE_CONNECTED, 0 while connected
+        float			secondsToRetry;		// until the next attempt, 0 while connected
+    };
+
+    void			setup(float _fps, bool _connected, double _time);
+    void			setTimeouts(float _stallSeconds, float _minBackoff, float _maxBackoff);
+
+    // capture thread
+    void			frameArrived(double _time);
+    bool			isReopenDue(bool _connected, double _time);	// true when the source should be closed and opened now
+    void			reopened(bool _success, double _time);
+
+    Status			getStatus(double _time) const;
+
+    static std::string	getStateName(sourceStateEnum _state);
+
+protected:
+    void			setLost(sourceStateEnum _state, double _time);
+
+    mutable std::mutex	statusMutex;
+    Status			status;
+    float			fps;
+    float			stallSeconds;
+    float			minBackoff;
+    float			maxBackoff;
+    float			backoff;			// before the next attempt after a failed one
+    bool			bHasFrame;
+    double			lastFrameTime;		// or the setup time before the first frame
+    double			deadlineTime;		// stalled without a frame until then
+    double			lostTime;
+    double			nextAttemptTime;
+};
@@ -0,0 +1,267 @@
+#include "SparseFlow.h"
+
+// of the solve on each level
+static const int MAX_ITERATIONS = 10;
+static const float MIN_STEP = 0.01;			// pixels, where the iterations stop
+static const float MIN_EIGENVALUE = 1e-3;	// of the gradient matrix over the window's area, flat windows can't be tracked
+static const float MAX_RESIDUAL = 24;		// mean grey level difference of a tracked window
+static const int MAX_WINDOW_SIZE = 31 * 31;	// of the largest radius
+
+
+//--------------------------------------------------------------
+SparseFlow::SparseFlow() {
+    width = 0;
+    height = 0;
+    pool = nullptr;
+    pointSpacing = 6;
+    maxPoints = 400;
+    windowRadius = 7;
+    numLevels = 3;
+    bHasPrevious = false;
+    seedSpacing = 0;
+}
+
+//--------------------------------------------------------------
+void SparseFlow::setup(int _width, int _height) {
+    width = _width;
+    height = _height;
+    levels.clear();
+    previousLevels.clear();
+    reset();
+}
+
+//--------------------------------------------------------------
+void SparseFlow::reset() {
+    bHasPrevious = false;
+    seeds.clear();
+    seedSpacing = 0;
+    points.clear();
+    stats = Stats();
+}
+
+//--------------------------------------------------------------
+static void forRange(ThreadPool* _pool, int _count, int _minChunk, const std::function<void(int, int)>& _function) {
+    if (_pool)
+        _pool->parallelFor(_count, _function, _minChunk);
+    else
+        _function(0, _count);
+}
+
+//--------------------------------------------------------------
+void SparseFlow::update(const unsigned char* _image, const vector<Blob>& _blobs) {
+    // the current pyramid becomes the previous one and its buffers are reused
+    swap(levels, previousLevels);
+    buildPyramid(_image, levels);
+
+    // a change of the number of levels starts over
+    bool canTrack = bHasPrevious && previousLevels.size() == levels.size();
+    points.clear();
+    stats.numSeeds = canTrack ? seeds.size() : 0;
+    stats.numTracked = 0;
+    stats.pointSpacing = canTrack ? seedSpacing : 0;
+    if (canTrack && !seeds.empty()) {
+        tracked.resize(seeds.size());
+        bTracked.assign(seeds.size(), 0);
+        forRange(pool, seeds.size(), 8, [&](int _begin, int _end) {
+            for (int i=_begin; i<_end; i++) {
+                ofVec2f position;
+                bTracked[i] = track(seeds[i], position);
+                tracked[i].position = position;
+                tracked[i].velocity = position - seeds[i];
+            }
+        });
+        for (size_t i=0; i<seeds.size(); i++) {
+            if (bTracked[i])
+                points.push_back(tracked[i]);
+        }
+        stats.numTracked = points.size();
+    }
+
+    sampleSeeds(_blobs);
+    bHasPrevious = true;
+}
+
+//--------------------------------------------------------------
+void SparseFlow::buildPyramid(const unsigned char* _image, vector<Level>& _levels) {
+    _levels.resize(numLevels);
+    for (int l=0; l<numLevels; l++) {
+        Level& level = _levels[l];
+        level.width = l == 0 ? width : max(_levels[l - 1].width / 2, 1);
+        level.height = l == 0 ? height : max(_levels[l - 1].height / 2, 1);
+        size_t size = (size_t)level.width * level.height;
+        level.image.resize(size);
+        level.gradX.resize(size);
+        level.gradY.resize(size);
+
+        if (l == 0) {
+            for (size_t i=0; i<size; i++)
+                level.image[i] = _image[i];
+        }
+        else {
+            // a 1 2 1 binomial under every other pixel of the finer level, clamped at its edges
+            const Level& fine = _levels[l - 1];
+            forRange(pool, level.height, 8, [&](int _begin, int _end) {
+                for (int y=_begin; y<_end; y++) {
+                    int y0 = max(2 * y - 1, 0);
+                    int y1 = min(2 * y, fine.height - 1);
+                    int y2 = min(2 * y + 1, fine.height - 1);
+                    const float* rows[3] = { &fine.image[y0 * fine.width], &fine.image[y1 * fine.width], &fine.image[y2 * fine.width] };
+                    float* out = &level.image[y * level.width];
+                    for (int x=0; x<level.width; x++) {
+                        int x0 = max(2 * x - 1, 0);
+                        int x1 = min(2 * x, fine.width - 1);
+                        int x2 = min(2 * x + 1, fine.width - 1);
+                        float sum = 0;
+                        static const float weights[3] = { 1, 2, 1 };
+                        for (int r=0; r<3; r++)
+                            sum += weights[r] * (rows[r][x0] + 2 * rows[r][x1] + rows[r][x2]);
+                        out[x] = sum / 16;
+                    }
+                }
+            });
+        }
+
+        // central differences, one sided at the edges
+        forRange(pool, level.height, 8, [&](int _begin, int _end) {
+            for (int y=_begin; y<_end; y++) {
+                const float* row = &level.image[y * level.width];
+                const float* above = &level.image[max(y - 1, 0) * level.width];
+                const float* below = &level.image[min(y + 1, level.height - 1) * level.width];
+                float* gradX = &level.gradX[y * level.width];
+                float* gradY = &level.gradY[y * level.width];
+                for (int x=0; x<level.width; x++) {
+                    gradX[x] = (row[min(x + 1, level.width - 1)] - row[max(x - 1, 0)]) * 0.5f;
+                    gradY[x] = (below[x] - above[x]) * 0.5f;
+                }
+            }
+        });
+    }
+}
+
+//--------------------------------------------------------------
+void SparseFlow::sampleSeeds(const vector<Blob>& _blobs) {
+    // evenly along all contours together, wider apart when there is more contour than points
+    float length = 0;
+    for (const Blob& blob : _blobs) {
+        const vector<ofPoint>& vertices = blob.contour.getVertices();
+        for (size_t i=1; i<vertices.size(); i++)
+            length += vertices[i].distance(vertices[i - 1]);
+    }
+    float spacing = max(pointSpacing, length / maxPoints);
+    seedSpacing = spacing;
+
+    seeds.clear();
+    for (const Blob& blob : _blobs) {
+        const vector<ofPoint>& vertices = blob.contour.getVertices();
+        float distance = spacing;		// each contour starts with a point
+        for (size_t i=0; i<vertices.size(); i++) {
+            if (i > 0)
+                distance += vertices[i].distance(vertices[i - 1]);
+            if (distance >= spacing && (int)seeds.size() < maxPoints) {
+                seeds.push_back(ofVec2f(vertices[i].x, vertices[i].y));
+                distance = 0;
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------
+static inline float sampleBilinear(const vector<float>& _image, int _width, float _x, float _y) {
+    int x = _x;
+    int y = _y;
+    float fx = _x - x;
+    float fy = _y - y;
+    const float* row = &_image[y * _width + x];
+    return (row[0] * (1 - fx) + row[1] * fx) * (1 - fy) + (row[_width] * (1 - fx) + row[_width + 1] * fx) * fy;
+}
+
+//--------------------------------------------------------------
+bool SparseFlow::track(const ofVec2f& _from, ofVec2f& _to) const {
+    int r = windowRadius;
+    int windowSize = (2 * r + 1) * (2 * r + 1);
+    float templateValues[MAX_WINDOW_SIZE];
+    float templateGradX[MAX_WINDOW_SIZE];
+    float templateGradY[MAX_WINDOW_SIZE];
+
+    ofVec2f guess(0, 0);		// the shift carried down from the coarser level
+    for (int l=numLevels - 1; l>=0; l--) {
+        const Level& previous = previousLevels[l];
+        const Level& current = levels[l];
+        float scale = 1.0f / (1 << l);
+        ofVec2f point = _from * scale;
+
+        // the window has to stay inside, with a pixel for the bilinear neighbour
+        bool inside = point.x - r >= 0 && point.y - r >= 0 && point.x + r < previous.width - 1 && point.y + r < previous.height - 1;
+        if (!inside) {
+            if (l == 0)
+                return false;
+            guess *= 2;
+            continue;
+        }
+
+        // the window of the previous frame and the gradient matrix, the same for every iteration
+        float gxx = 0, gxy = 0, gyy = 0;
+        int i = 0;
+        for (int dy=-r; dy<=r; dy++) {
+            for (int dx=-r; dx<=r; dx++, i++) {
+                float x = point.x + dx;
+                float y = point.y + dy;
+                templateValues[i] = sampleBilinear(previous.image, previous.width, x, y);
+                templateGradX[i] = sampleBilinear(previous.gradX, previous.width, x, y);
+                templateGradY[i] = sampleBilinear(previous.gradY, previous.width, x, y);
+                gxx += templateGradX[i] * templateGradX[i];
+                gxy += templateGradX[i] * templateGradY[i];
+                gyy += templateGradY[i] * templateGradY[i];
+            }
+        }
+        float determinant = gxx * gyy - gxy * gxy;
+        float minEigenvalue = (gxx + gyy - sqrt((gxx - gyy) * (gxx - gyy) + 4 * gxy * gxy)) * 0.5f;
+        if (minEigenvalue / windowSize < MIN_EIGENVALUE || determinant < 1e-6) {
+            if (l == 0)
+                return false;
+            guess *= 2;
+            continue;
+        }
+
+        ofVec2f shift(0, 0);
+        for (int k=0; k<MAX_ITERATIONS; k++) {
+            ofVec2f target = point + guess + shift;
+            if (target.x - r < 0 || target.y - r < 0 || target.x + r >= current.width - 1 || target.y + r >= current.height - 1)
+                return false;
+
+            float bx = 0, by = 0;
+            i = 0;
+            for (int dy=-r; dy<=r; dy++) {
+                for (int dx=-r; dx<=r; dx++, i++) {
+                    float difference = templateValues[i] - sampleBilinear(current.image, current.width, target.x + dx, target.y + dy);
+                    bx += difference * templateGradX[i];
+                    by += difference * templateGradY[i];
+                }
+            }
+            ofVec2f step((gyy * bx - gxy * by) / determinant, (gxx * by - gxy * bx) / determinant);
+            shift += step;
+            if (step.lengthSquared() < MIN_STEP * MIN_STEP)
+                break;
+        }
+
+        guess += shift;
+        if (l > 0)
+            guess *= 2;
+    }
+
+    _to = _from + guess;
+    if (_to.x - r < 0 || _to.y - r < 0 || _to.x + r >= width - 1 || _to.y + r >= height - 1)
+        return false;
+
+    // what still differs once matched, an occluded or reshaped window
+    const Level& previous = previousLevels[0];
+    const Level& current = levels[0];
+    float residual = 0;
+    for (int dy=-r; dy<=r; dy++) {
+        for (int dx=-r; dx<=r; dx++) {
+            float expected = sampleBilinear(previous.image, previous.width, _from.x + dx, _from.y + dy);
+            residual += fabs(expected - sampleBilinear(current.image, current.width, _to.x + dx, _to.y + dy));
+        }
+    }
+    return residual / windowSize < MAX_RESIDUAL;
+}
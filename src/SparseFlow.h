@@ -0,0 +1,86 @@
+#pragma once
+
+#include "ofMain.h"
+#include "BlobFinder.h"
+#include "ThreadPool.h"
+
+enum flowModeEnum {
+    FLOW_MODE_DENSE = 0,	// ftOpticalFlow over the flow grid, on the GPU
+    FLOW_MODE_SPARSE		// SparseFlow along the blob contours, on the CPU
+};
+
+// The motion of one point of a contour
+struct FlowPoint {
+    ofVec2f			position;	// pixels, where it is in the newer frame
+    ofVec2f			velocity;	// pixels per frame
+};
+
+// Optical flow at points along the blob contours only, which is where a
+// depth masked image moves. Points are spaced evenly along the contours of
+// one frame and tracked into the next with pyramidal Lucas-Kanade: each
+// level solves for the shift that best matches a window around the point,
+// starting from twice the shift found on the coarser level, so a few levels
+// catch motions of many times the window's size.
+//
+// Points on a straight edge only move across it as far as the window can
+// tell, ones whose window is flat or leaves the image are dropped, as are
+// those that still differ much from where they started once tracked. The
+// pyramid's rows and the points are split across the thread pool.
+class SparseFlow {
+public:
+    SparseFlow();
+
+    struct Stats {
+        Stats() : numSeeds(0), numTracked(0), pointSpacing(0) {}
+        int			numSeeds;		// points tracked from the last frame
+        int			numTracked;		// of those, found again
+        float		pointSpacing;	// pixels between them, wider than set when the points were capped
+    };
+
+    void			setup(int _width, int _height);
+    void			setThreadPool(ThreadPool* _pool)	{ pool = _pool; }
+    void			setPointSpacing(float _value)		{ pointSpacing = max(_value, 1.0f); }	// pixels along the contours
+    void			setMaxPoints(int _value)			{ maxPoints = max(_value, 1); }		// the spacing grows to stay below
+    void			setWindowRadius(int _value)			{ windowRadius = min(max(_value, 1), 15); }	// the window is twice this plus one wide
+    void			setNumLevels(int _value)			{ numLevels = min(max(_value, 1), (int)MAX_LEVELS); }
+    void			reset();			// the next frame has nothing to track from
+
+    // _image is 8 bit at the size of the setup, the blobs with their contours
+    void			update(const unsigned char* _image, const vector<Blob>& _blobs);
+
+    const vector<FlowPoint>& getPoints() const	{ return points; }
+    const Stats&	getStats() const			{ return stats; }
+
+    static const int MAX_LEVELS = 5;
+
+protected:
+    struct Level {
+        int				width;
+        int				height;
+        vector<float>	image;
+        vector<float>	gradX;		// of the image, only used once it is the previous frame's
+        vector<float>	gradY;
+    };
+
+    void			buildPyramid(const unsigned char* _image, vector<Level>& _levels);
+    void			sampleSeeds(const vector<Blob>& _blobs);
+    bool			track(const ofVec2f& _from, ofVec2f& _to) const;	// from the previous pyramid into the current one
+
+    int				width;
+    int				height;
+    ThreadPool*		pool;
+    float			pointSpacing;
+    int				maxPoints;
+    int				windowRadius;
+    int				numLevels;
+
+    vector<Level>	levels;
+    vector<Level>	previousLevels;
+    bool			bHasPrevious;
+    vector<ofVec2f>	seeds;			// on the previous frame's contours
+    float			seedSpacing;
+    vector<FlowPoint> tracked;		// per seed
+    vector<char>	bTracked;
+    vector<FlowPoint> points;
+    Stats			stats;
+};
@@ -0,0 +1,167 @@
+#include "StageGraph.h"
+#include "ThreadPool.h"
+#include "StageProfiler.h"
+
+
+//--------------------------------------------------------------
+StageGraph::StageGraph() {
+    pool = nullptr;
+    profiler = nullptr;
+    bDirty = false;
+}
+
+//--------------------------------------------------------------
+int StageGraph::addStage(const string& _name, stageQueueEnum _queue, const vector<string>& _inputs, const vector<string>& _outputs,
+                         const function<void()>& _function, int _profilerStage) {
+    stages.emplace_back();
+    Stage& stage = stages.back();
+    stage.name = _name;
+    stage.queue = _queue;
+    for (const string& input : _inputs)
+        stage.inputs.push_back(getResource(input));
+    for (const string& output : _outputs)
+        stage.outputs.push_back(getResource(output));
+    stage.work = _function;
+    stage.profilerStage = _profilerStage;
+    bDirty = true;
+    return stages.size() - 1;
+}
+
+//--------------------------------------------------------------
+int StageGraph::getResource(const string& _name) {
+    auto it = resources.find(_name);
+    if (it != resources.end())
+        return it->second;
+    int id = resources.size();
+    resources[_name] = id;
+    return id;
+}
+
+//--------------------------------------------------------------
+int StageGraph::findStage(const string& _name) const {
+    for (int i=0; i<(int)stages.size(); i++) {
+        if (stages[i].name == _name)
+            return i;
+    }
+    return -1;
+}
+
+//--------------------------------------------------------------
+void StageGraph::build() {
+    // the wave after the last one that touched each resource, reading or writing
+    vector<int> readyAfterWrite(resources.size(), 0);
+    vector<int> readyAfterAccess(resources.size(), 0);
+    int lastGlWave = -1;
+    int numWaves = 0;
+    for (Stage& stage : stages) {
+        int wave = 0;
+        for (int input : stage.inputs)
+            wave = max(wave, readyAfterWrite[input]);
+        for (int output : stage.outputs)
+            wave = max(wave, readyAfterAccess[output]);
+        if (stage.queue == STAGE_QUEUE_GL) {
+            wave = max(wave, lastGlWave);		// same wave is fine, they run in order within it
+            lastGlWave = wave;
+        }
+        stage.wave = wave;
+        for (int input : stage.inputs)
+            readyAfterAccess[input] = max(readyAfterAccess[input], wave + 1);
+        for (int output : stage.outputs) {
+            readyAfterWrite[output] = max(readyAfterWrite[output], wave + 1);
+            readyAfterAccess[output] = max(readyAfterAccess[output], wave + 1);
+        }
+        numWaves = max(numWaves, wave + 1);
+    }
+
+    waves.assign(numWaves, Wave());
+    for (int i=0; i<(int)stages.size(); i++) {
+        Wave& wave = waves[stages[i].wave];
+        if (stages[i].queue == STAGE_QUEUE_GL)
+            wave.glStages.push_back(i);
+        else
+            wave.cpuStages.push_back(i);
+    }
+    bDirty = false;
+}
+
+//--------------------------------------------------------------
+void StageGraph::run() {
+    if (bDirty)
+        build();
+
+    for (Stage& stage : stages)
+        stage.millis = 0;
+
+    for (Wave& wave : waves) {
+        running.clear();
+        for (int i : wave.cpuStages) {
+            if (stages[i].bEnabled)
+                running.push_back(&stages[i]);
+        }
+        if (pool && running.size() > 1) {
+            pool->parallelFor(running.size(), [this](int _begin, int _end) {
+                for (int i=_begin; i<_end; i++)
+                    runCpuStage(*running[i]);
+            });
+        }
+        else {
+            for (Stage* stage : running)
+                runCpuStage(*stage);
+        }
+        if (profiler) {
+            for (Stage* stage : running) {
+                if (stage->profilerStage >= 0)
+                    profiler->addCpuTime(stage->profilerStage, stage->millis);
+            }
+        }
+
+        for (int i : wave.glStages) {
+            Stage& stage = stages[i];
+            if (!stage.bEnabled)
+                continue;
+            bool bProfile = profiler && stage.profilerStage >= 0;
+            if (bProfile)
+                profiler->begin(stage.profilerStage);
+            uint64_t start = ofGetElapsedTimeMicros();
+            stage.work();
+            stage.millis = (ofGetElapsedTimeMicros() - start) / 1000.0f;
+            if (bProfile)
+                profiler->end(stage.profilerStage);
+        }
+    }
+}
+
+//--------------------------------------------------------------
+void StageGraph::runCpuStage(Stage& _stage) {
+    uint64_t start = ofGetElapsedTimeMicros();
+    _stage.work();
+    _stage.millis = (ofGetElapsedTimeMicros() - start) / 1000.0f;
+}
+
+//--------------------------------------------------------------
+int StageGraph::getMaxWidth() {
+    if (bDirty)
+        build();
+    size_t width = 1;
+    for (const Wave& wave : waves)
+        width = max(width, wave.cpuStages.size());
+    return width;
+}
+
+//--------------------------------------------------------------
+string StageGraph::getSchedule() {
+    if (bDirty)
+        build();
+    string schedule;
+    for (size_t w=0; w<waves.size(); w++) {
+        if (w > 0)
+            schedule += " -> ";
+        vector<string> names;
+        for (int i : waves[w].cpuStages)
+            names.push_back(stages[i].name);
+        for (int i : waves[w].glStages)
+            names.push_back(stages[i].name + " (gl)");
+        schedule += "[" + ofJoinString(names, ", ") + "]";
+    }
+    return schedule;
+}
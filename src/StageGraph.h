@@ -0,0 +1,76 @@
+#pragma once
+
+#include "ofMain.h"
+
+class ThreadPool;
+class StageProfiler;
+
+enum stageQueueEnum {
+    STAGE_QUEUE_CPU = 0,	// on the thread pool, next to the other CPU stages that are ready
+    STAGE_QUEUE_GL			// on the thread running the graph, in the order declared
+};
+
+// One frame of a pipeline as stages that declare the data they read and
+// write. A stage runs after every stage declared before it that writes what
+// it reads, or reads or writes what it writes, which sorts the stages into
+// waves. The CPU stages of a wave run side by side on the thread pool, the
+// calling thread included; the GL stages run after them on the calling
+// thread, always in the order they were declared, since GL state carries
+// from one to the next. Declared in the order of the sequential code, the
+// graph computes exactly what that code did.
+//
+// A stage switched off is skipped and its outputs keep what they last held;
+// the stages reading them still run. Every stage is timed: CPU stages on the
+// clock, handed to the profiler when there is one, GL stages through the
+// profiler's CPU and GPU timers. Without a pool everything runs inline.
+class StageGraph {
+public:
+    StageGraph();
+
+    int				addStage(const string& _name, stageQueueEnum _queue, const vector<string>& _inputs, const vector<string>& _outputs,
+                             const function<void()>& _function, int _profilerStage = -1);
+    void			setThreadPool(ThreadPool* _pool)		{ pool = _pool; }
+    void			setProfiler(StageProfiler* _profiler)	{ profiler = _profiler; }	// only from the thread that would time GL
+
+    void			run();
+
+    int				getNumStages() const				{ return stages.size(); }
+    int				findStage(const string& _name) const;		// -1 if there is none
+    const string&	getName(int _stage) const			{ return stages[_stage].name; }
+    void			setEnabled(int _stage, bool _value)	{ stages[_stage].bEnabled = _value; }	// from any thread, from the next run on
+    bool			isEnabled(int _stage) const			{ return stages[_stage].bEnabled; }
+    float			getMillis(int _stage) const			{ return stages[_stage].millis; }	// of the last run, 0 when skipped
+    int				getMaxWidth();						// the most CPU stages of a wave, the threads worth having
+    string			getSchedule();						// the waves, for the log
+
+protected:
+    struct Stage {
+        Stage() : queue(STAGE_QUEUE_CPU), profilerStage(-1), bEnabled(true), millis(0), wave(0) {}
+        string				name;
+        stageQueueEnum		queue;
+        vector<int>			inputs;
+        vector<int>			outputs;
+        function<void()>	work;
+        int					profilerStage;
+        atomic<bool>		bEnabled;
+        float				millis;
+        int					wave;
+    };
+
+    struct Wave {
+        vector<int>			cpuStages;
+        vector<int>			glStages;
+    };
+
+    int				getResource(const string& _name);
+    void			build();
+    void			runCpuStage(Stage& _stage);
+
+    ThreadPool*		pool;
+    StageProfiler*	profiler;
+    deque<Stage>	stages;			// atomics don't move
+    map<string, int> resources;
+    vector<Wave>	waves;
+    vector<Stage*>	running;		// the CPU stages of the current wave
+    bool			bDirty;
+};
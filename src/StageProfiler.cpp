@@ -0,0 +1,364 @@
+#include "StageProfiler.h"
+#include <iomanip>
+
+
+//--------------------------------------------------------------
+StageProfiler::StageProfiler() {
+    bEnabled = false;
+    bTimeGpu = false;
+    bBlocking = false;
+    bKeepSamples = false;
+    windowSeconds = 10;
+    numFrames = 0;
+    frameStart = 0;
+    lastFrameStart = 0;
+    currentSet = -1;
+    nextSet = 0;
+    activeGpuStage = -1;
+    numGpuSkipped = 0;
+}
+
+//--------------------------------------------------------------
+StageProfiler::~StageProfiler() {
+    for (auto& set : querySets) {
+        if (!set.queries.empty())
+            glDeleteQueries(set.queries.size(), set.queries.data());
+    }
+}
+
+//--------------------------------------------------------------
+void StageProfiler::setup(const vector<string>& _stageNames, bool _timeGpu) {
+    stages.clear();
+    stages.resize(_stageNames.size());
+    for (size_t i=0; i<_stageNames.size(); i++)
+        stages[i].name = _stageNames[i];
+    bTimeGpu = _timeGpu;
+    setWindow(10);
+}
+
+//--------------------------------------------------------------
+void StageProfiler::setWindow(double _seconds) {
+    windowSeconds = _seconds;
+    // quarter millisecond bins up to 100ms, slower frames count as the max
+    for (auto& stage : stages) {
+        stage.cpuStats.setup(_seconds, 0.25, 400);
+        stage.gpuStats.setup(_seconds, 0.25, 400);
+    }
+    frameStats.setup(_seconds, 0.25, 400);
+    intervalStats.setup(_seconds, 0.25, 400);
+    gpuFrameStats.setup(_seconds, 0.25, 400);
+    clear();
+}
+
+//--------------------------------------------------------------
+void StageProfiler::clear() {
+    for (auto& stage : stages) {
+        stage.cpuSamples.clear();
+        stage.gpuSamples.clear();
+        stage.cpuStats.clear();
+        stage.gpuStats.clear();
+        stage.ranThisFrame = false;
+    }
+    frameSamples.clear();
+    frameStats.clear();
+    intervalStats.clear();
+    gpuFrameStats.clear();
+    numFrames = 0;
+    numGpuSkipped = 0;
+    lastFrameStart = 0;
+}
+
+//--------------------------------------------------------------
+uint64_t StageProfiler::getMicros() {
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//--------------------------------------------------------------
+GLuint StageProfiler::getQuery(int _stage) {
+    QuerySet& set = querySets[currentSet];
+    if (set.numUsed == set.queries.size()) {
+        GLuint query;
+        glGenQueries(1, &query);
+        set.queries.push_back(query);
+        set.stages.push_back(_stage);
+    }
+    set.stages[set.numUsed] = _stage;
+    return set.queries[set.numUsed++];
+}
+
+//--------------------------------------------------------------
+bool StageProfiler::readQueries(QuerySet& _set, bool _wait) {
+    if (!_wait) {
+        // queries finish in order, the last one being ready means all are
+        GLint available = 0;
+        glGetQueryObjectiv(_set.queries[_set.numUsed - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return false;
+    }
+
+    for (size_t i=0; i<_set.numUsed; i++)
+        stages[_set.stages[i]].gpuFrameNanos = 0;
+    GLuint64 totalNanos = 0;
+    for (size_t i=0; i<_set.numUsed; i++) {
+        GLuint64 nanos = 0;
+        glGetQueryObjectui64v(_set.queries[i], GL_QUERY_RESULT, &nanos);
+        stages[_set.stages[i]].gpuFrameNanos += nanos;
+        totalNanos += nanos;
+    }
+    gpuFrameStats.add(totalNanos / 1000000.0f, _set.time);
+
+    // a stage timed more than once in the frame gets one sample with the sum
+    for (size_t i=0; i<_set.numUsed; i++) {
+        Stage& stage = stages[_set.stages[i]];
+        if (stage.gpuFrameNanos == numeric_limits<uint64_t>::max())
+            continue;
+        float millis = stage.gpuFrameNanos / 1000000.0f;
+        stage.gpuStats.add(millis, _set.time);
+        if (bKeepSamples)
+            stage.gpuSamples.push_back(millis);
+        stage.gpuFrameNanos = numeric_limits<uint64_t>::max();
+    }
+
+    _set.numUsed = 0;
+    _set.bPending = false;
+    return true;
+}
+
+//--------------------------------------------------------------
+void StageProfiler::beginFrame() {
+    if (!bEnabled)
+        return;
+
+    // collect whatever the GPU has finished since the last frame, oldest set first
+    for (int i=0; i<NUM_QUERY_SETS; i++) {
+        QuerySet& set = querySets[(nextSet + i) % NUM_QUERY_SETS];
+        if (set.bPending && !readQueries(set, false))
+            break;
+    }
+
+    for (auto& stage : stages) {
+        stage.ranThisFrame = false;
+        stage.cpuFrameMicros = 0;
+    }
+    activeGpuStage = -1;
+
+    currentSet = -1;
+    if (bTimeGpu) {
+        if (querySets[nextSet].bPending) {
+            // the GPU is more than a ring behind, rather skip than wait
+            numGpuSkipped++;
+        }
+        else {
+            currentSet = nextSet;
+            nextSet = (nextSet + 1) % NUM_QUERY_SETS;
+            querySets[currentSet].numUsed = 0;
+        }
+    }
+
+    frameStart = getMicros();
+    if (lastFrameStart > 0)
+        intervalStats.add((frameStart - lastFrameStart) / 1000.0f, frameStart / 1000000.0);
+    lastFrameStart = frameStart;
+}
+
+//--------------------------------------------------------------
+void StageProfiler::begin(int _stage) {
+    if (!bEnabled)
+        return;
+    Stage& stage = stages[_stage];
+    stage.ranThisFrame = true;
+
+    if (currentSet >= 0 && activeGpuStage < 0) {
+        glBeginQuery(GL_TIME_ELAPSED, getQuery(_stage));
+        activeGpuStage = _stage;
+    }
+    stage.cpuStart = getMicros();
+}
+
+//--------------------------------------------------------------
+void StageProfiler::end(int _stage) {
+    if (!bEnabled)
+        return;
+    Stage& stage = stages[_stage];
+    stage.cpuFrameMicros += getMicros() - stage.cpuStart;
+
+    if (activeGpuStage == _stage) {
+        glEndQuery(GL_TIME_ELAPSED);
+        activeGpuStage = -1;
+    }
+}
+
+//--------------------------------------------------------------
+void StageProfiler::addCpuTime(int _stage, float _millis) {
+    if (!bEnabled)
+        return;
+    Stage& stage = stages[_stage];
+    stage.ranThisFrame = true;
+    stage.cpuFrameMicros += _millis * 1000;
+}
+
+//--------------------------------------------------------------
+void StageProfiler::endFrame() {
+    if (!bEnabled)
+        return;
+
+    uint64_t now = getMicros();
+    double time = now / 1000000.0;
+    for (auto& stage : stages) {
+        if (!stage.ranThisFrame)
+            continue;
+        float millis = stage.cpuFrameMicros / 1000.0f;
+        stage.cpuStats.add(millis, time);
+        if (bKeepSamples)
+            stage.cpuSamples.push_back(millis);
+    }
+    float frameMillis = (now - frameStart) / 1000.0f;
+    frameStats.add(frameMillis, time);
+    if (bKeepSamples)
+        frameSamples.push_back(frameMillis);
+    numFrames++;
+
+    if (currentSet >= 0) {
+        QuerySet& set = querySets[currentSet];
+        set.time = time;
+        set.bPending = set.numUsed > 0;
+        // blocks until the GPU has caught up with this frame
+        if (set.bPending && bBlocking)
+            readQueries(set, true);
+        currentSet = -1;
+    }
+}
+
+//--------------------------------------------------------------
+StageProfiler::Summary StageProfiler::summarize(const vector<float>& _samples) {
+    Summary summary;
+    if (_samples.empty())
+        return summary;
+
+    vector<float> sorted = _samples;
+    sort(sorted.begin(), sorted.end());
+    summary.count = sorted.size();
+    summary.mean = accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size();
+    summary.p50 = sorted[(sorted.size() - 1) * 50 / 100];
+    summary.p99 = sorted[(sorted.size() - 1) * 99 / 100];
+    summary.max = sorted.back();
+    return summary;
+}
+
+//--------------------------------------------------------------
+StageProfiler::Summary StageProfiler::summarize(const RollingStats& _stats) {
+    Summary summary;
+    summary.count = _stats.getCount();
+    summary.mean = _stats.getMean();
+    summary.p50 = _stats.getPercentile(50);
+    summary.p99 = _stats.getPercentile(99);
+    summary.max = _stats.getMax();
+    return summary;
+}
+
+//--------------------------------------------------------------
+StageProfiler::Summary StageProfiler::getCpuSummary(int _stage) const {
+    return bKeepSamples ? summarize(stages[_stage].cpuSamples) : summarize(stages[_stage].cpuStats);
+}
+
+//--------------------------------------------------------------
+StageProfiler::Summary StageProfiler::getGpuSummary(int _stage) const {
+    return bKeepSamples ? summarize(stages[_stage].gpuSamples) : summarize(stages[_stage].gpuStats);
+}
+
+//--------------------------------------------------------------
+StageProfiler::Summary StageProfiler::getFrameSummary() const {
+    return bKeepSamples ? summarize(frameSamples) : summarize(frameStats);
+}
+
+//--------------------------------------------------------------
+string StageProfiler::jsonEscape(const string& _value) {
+    string escaped;
+    for (char c : _value) {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        if ((unsigned char)c >= 0x20)
+            escaped += c;
+    }
+    return escaped;
+}
+
+//--------------------------------------------------------------
+static void writeSummary(ofstream& _out, const char* _key, const StageProfiler::Summary& _summary) {
+    _out << "\"" << _key << "\": {\"mean\": " << _summary.mean << ", \"p50\": " << _summary.p50
+         << ", \"p99\": " << _summary.p99 << ", \"max\": " << _summary.max << "}";
+}
+
+//--------------------------------------------------------------
+bool StageProfiler::saveJson(const string& _path, const vector<pair<string, string> >& _info) const {
+    ofstream out(ofToDataPath(_path, true).c_str());
+    if (!out)
+        return false;
+
+    out << fixed << setprecision(4);
+    out << "{" << endl;
+    for (auto& info : _info)
+        out << "  \"" << jsonEscape(info.first) << "\": \"" << jsonEscape(info.second) << "\"," << endl;
+    out << "  \"frames\": " << numFrames << "," << endl;
+    out << "  \"units\": \"ms\"," << endl;
+    out << "  ";
+    writeSummary(out, "frame", getFrameSummary());
+    out << "," << endl;
+    if (!bKeepSamples) {
+        out << "  ";
+        writeSummary(out, "interval", getIntervalSummary());
+        out << "," << endl;
+    }
+    out << "  \"stages\": {" << endl;
+
+    bool first = true;
+    for (int i=0; i<getNumStages(); i++) {
+        Summary cpu = getCpuSummary(i);
+        Summary gpu = getGpuSummary(i);
+        if (cpu.count == 0)
+            continue;
+        if (!first)
+            out << "," << endl;
+        first = false;
+
+        out << "    \"" << jsonEscape(stages[i].name) << "\": {\"samples\": " << cpu.count << ", ";
+        writeSummary(out, "cpu", cpu);
+        if (gpu.count > 0) {
+            out << ", ";
+            writeSummary(out, "gpu", gpu);
+        }
+        out << "}";
+    }
+    out << endl << "  }" << endl << "}" << endl;
+    return out.good();
+}
+
+//--------------------------------------------------------------
+bool StageProfiler::appendCsv(const string& _path) const {
+    string path = ofToDataPath(_path, true);
+    bool bNewFile = !ifstream(path.c_str()).good();
+    ofstream out(path.c_str(), ios::app);
+    if (!out)
+        return false;
+
+    if (bNewFile) {
+        out << "time,frames,interval_p50,interval_p99,interval_max,frame_p50,frame_p99";
+        for (auto& stage : stages) {
+            string name = stage.name;
+            replace(name.begin(), name.end(), ' ', '_');
+            out << "," << name << "_cpu_p50," << name << "_cpu_p99," << name << "_gpu_p50," << name << "_gpu_p99";
+        }
+        out << endl;
+    }
+
+    out << fixed << setprecision(3);
+    out << ofGetTimestampString("%Y-%m-%d %H:%M:%S") << "," << numFrames << ","
+        << intervalStats.getPercentile(50) << "," << intervalStats.getPercentile(99) << "," << intervalStats.getMax() << ","
+        << frameStats.getPercentile(50) << "," << frameStats.getPercentile(99);
+    for (auto& stage : stages) {
+        out << "," << stage.cpuStats.getPercentile(50) << "," << stage.cpuStats.getPercentile(99)
+            << "," << stage.gpuStats.getPercentile(50) << "," << stage.gpuStats.getPercentile(99);
+    }
+    out << endl;
+    return out.good();
+}
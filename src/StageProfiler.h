@@ -0,0 +1,119 @@
+#pragma once
+
+#include "ofMain.h"
+#include "RollingStats.h"
+
+// Per stage CPU wall time and GPU time (GL_TIME_ELAPSED) for every frame.
+// Stages are registered by index, wrap each one in begin()/end() and close
+// the frame with endFrame(). GPU queries can't nest, a stage begun inside
+// another one only gets CPU time.
+//
+// GPU results are collected from a ring of query sets a few frames later,
+// so timing never stalls the pipeline; if the GPU falls further behind a
+// frame goes without GPU times. Blocking mode instead waits for each
+// frame's results, meant for benchmark runs, and keeping samples stores
+// every frame for exact summaries.
+class StageProfiler {
+public:
+    StageProfiler();
+    ~StageProfiler();
+
+    struct Summary {
+        Summary() : count(0), mean(0), p50(0), p99(0), max(0) {}
+        int		count;
+        float	mean;		// milliseconds
+        float	p50;
+        float	p99;
+        float	max;
+    };
+
+    void	setup(const vector<string>& _stageNames, bool _timeGpu = true);
+    void	setEnabled(bool _value)		{ bEnabled = _value; }
+    bool	isEnabled() const			{ return bEnabled; }
+    void	setBlocking(bool _value)	{ bBlocking = _value; }
+    void	setKeepSamples(bool _value)	{ bKeepSamples = _value; }
+    void	setWindow(double _seconds);	// of the rolling statistics, default 10
+    double	getWindow() const			{ return windowSeconds; }
+    void	clear();
+
+    void	beginFrame();
+    void	endFrame();
+    void	begin(int _stage);
+    void	end(int _stage);
+    void	addCpuTime(int _stage, float _millis);	// for work timed elsewhere, e.g. on another thread
+
+    int		getNumStages() const		{ return stages.size(); }
+    const string& getName(int _stage) const	{ return stages[_stage].name; }
+    int		getNumFrames() const		{ return numFrames; }
+    int		getNumGpuSkipped() const	{ return numGpuSkipped; }
+
+    // over all kept samples, or over the rolling window when samples aren't kept
+    Summary	getCpuSummary(int _stage) const;
+    Summary	getGpuSummary(int _stage) const;
+    Summary	getFrameSummary() const;	// beginFrame() to endFrame()
+    Summary	getIntervalSummary() const	{ return summarize(intervalStats); }	// beginFrame() to the next one
+
+    const RollingStats& getCpuStats(int _stage) const	{ return stages[_stage].cpuStats; }
+    const RollingStats& getGpuStats(int _stage) const	{ return stages[_stage].gpuStats; }
+    const RollingStats& getFrameStats() const			{ return frameStats; }
+    const RollingStats& getIntervalStats() const		{ return intervalStats; }
+    const RollingStats& getGpuFrameStats() const		{ return gpuFrameStats; }	// all GPU timed stages of a frame, arrives late
+
+    // writes all stage summaries plus the given key/value pairs as JSON
+    bool	saveJson(const string& _path, const vector<pair<string, string> >& _info) const;
+    // appends one line of rolling p50/p99 per stage, with a header for a new file
+    bool	appendCsv(const string& _path) const;
+
+    // for the string values of JSON written elsewhere too, quotes and backslashes escaped, control characters dropped
+    static string	jsonEscape(const string& _value);
+
+protected:
+    struct Stage {
+        string			name;
+        vector<float>	cpuSamples;
+        vector<float>	gpuSamples;
+        RollingStats	cpuStats;
+        RollingStats	gpuStats;
+        uint64_t		cpuStart;
+        uint64_t		cpuFrameMicros;
+        uint64_t		gpuFrameNanos;
+        bool			ranThisFrame;
+    };
+
+    // the queries issued during one frame
+    struct QuerySet {
+        QuerySet() : numUsed(0), bPending(false), time(0) {}
+        vector<GLuint>	queries;
+        vector<int>		stages;
+        size_t			numUsed;
+        bool			bPending;
+        double			time;
+    };
+
+    static Summary	summarize(const vector<float>& _samples);
+    static Summary	summarize(const RollingStats& _stats);
+    static uint64_t	getMicros();
+    GLuint			getQuery(int _stage);
+    bool			readQueries(QuerySet& _set, bool _wait);
+
+    vector<Stage>	stages;
+    bool			bEnabled;
+    bool			bTimeGpu;
+    bool			bBlocking;
+    bool			bKeepSamples;
+    double			windowSeconds;
+    int				numFrames;
+    uint64_t		frameStart;
+    uint64_t		lastFrameStart;
+    vector<float>	frameSamples;
+    RollingStats	frameStats;
+    RollingStats	intervalStats;
+    RollingStats	gpuFrameStats;
+
+    enum { NUM_QUERY_SETS = 4 };
+    QuerySet		querySets[NUM_QUERY_SETS];
+    int				currentSet;		// -1 when this frame isn't timed on the GPU
+    int				nextSet;		// next one to issue, also the oldest one in flight
+    int				activeGpuStage;
+    int				numGpuSkipped;
+};
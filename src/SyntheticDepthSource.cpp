@@ -0,0 +1,164 @@
+#include "SyntheticDepthSource.h"
+
+// cheap integer hash for repeatable per pixel jitter
+static inline unsigned int hashPixel(unsigned int _x, unsigned int _y, unsigned int _frame) {
+    unsigned int h = _x * 374761393u + _y * 668265263u + _frame * 2246822519u;
+    h = (h ^ (h >> 13)) * 1274126177u;
+    return h ^ (h >> 16);
+}
+
+//--------------------------------------------------------------
+SyntheticDepthSource::SyntheticDepthSource(const DepthSourceSettings& _settings) {
+    type = _settings.type;
+    stillPath = _settings.path;
+    numBlobs = max(_settings.numBlobs, 0);
+    fps = _settings.fps;
+    width = _settings.width;
+    height = _settings.height;
+    bOpen = false;
+    bStillDone = false;
+    wallDepth = 3500;
+}
+
+//--------------------------------------------------------------
+bool SyntheticDepthSource::open() {
+    allocate(width, height);
+    bOpen = true;
+    bStillDone = false;
+
+    if (type == DEPTH_SOURCE_STILL && !stillPath.empty() && !loadStill(stillPath))
+        ofLogWarning("SyntheticDepthSource") << "could not load " << stillPath << ", using a generated frame";
+
+    ofLogNotice("SyntheticDepthSource") << getName() << " " << width << "x" << height << " @ " << fps << " fps";
+    return true;
+}
+
+//--------------------------------------------------------------
+void SyntheticDepthSource::update() {
+    bNewFrame = false;
+    if (!bOpen || !isFrameDue())
+        return;
+
+    float time = frameNum / fps;
+    switch (type) {
+        case DEPTH_SOURCE_NOISE:
+            generateNoise(time);
+            break;
+        case DEPTH_SOURCE_STILL:
+            // the frame never changes, but it is still delivered at the source rate
+            if (!bStillDone) {
+                generateBlobs(0);
+                bStillDone = true;
+            }
+            break;
+        default:
+            generateBlobs(time);
+            break;
+    }
+    publishRawFrame();
+}
+
+//--------------------------------------------------------------
+string SyntheticDepthSource::getName() const {
+    switch (type) {
+        case DEPTH_SOURCE_NOISE:	return "noise";
+        case DEPTH_SOURCE_STILL:	return stillPath.empty() ? "still" : "still " + stillPath;
+        default:					return "blobs";
+    }
+}
+
+//--------------------------------------------------------------
+void SyntheticDepthSource::generateBlobs(float _time) {
+    unsigned short* raw = rawDepthPixels.getData();
+    unsigned short wall = wallDepth;
+    std::fill(raw, raw + (size_t)width * height, wall);
+
+    for (int b=0; b<numBlobs; b++) {
+        // every blob gets its own lissajous path, size and distance
+        float phase = b * 2.39996f;
+        float cx = width  * (0.5f + 0.35f * sinf(_time * (0.31f + 0.07f * b) + phase));
+        float cy = height * (0.55f + 0.25f * sinf(_time * (0.23f + 0.05f * b) + phase * 1.7f));
+        float rx = width  * (0.06f + 0.02f * sinf(_time * 0.5f + phase));
+        float ry = height * (0.22f + 0.03f * cosf(_time * 0.4f + phase));
+        float depth = 1200 + 600 * (0.5f + 0.5f * sinf(_time * 0.17f + phase));
+        float bulge = 250;
+
+        int x0 = max(0, (int)(cx - rx)), x1 = min(width - 1, (int)(cx + rx));
+        int y0 = max(0, (int)(cy - ry)), y1 = min(height - 1, (int)(cy + ry));
+        for (int y=y0; y<=y1; y++) {
+            float dy = (y - cy) / ry;
+            unsigned short* row = raw + (size_t)y * width;
+            for (int x=x0; x<=x1; x++) {
+                float dx = (x - cx) / rx;
+                float d2 = dx * dx + dy * dy;
+                if (d2 >= 1.0f)
+                    continue;
+                unsigned short z = depth - bulge * sqrtf(1.0f - d2);
+                if (z < row[x])
+                    row[x] = z;
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------
+void SyntheticDepthSource::generateNoise(float _time) {
+    // evaluate the noise on a coarse lattice and interpolate, per pixel ofNoise is far too slow
+    const int cell = 8;
+    int gw = width / cell + 2;
+    int gh = height / cell + 2;
+    noiseGrid.resize(gw * gh);
+    for (int gy=0; gy<gh; gy++)
+        for (int gx=0; gx<gw; gx++)
+            noiseGrid[gy * gw + gx] = ofNoise(gx * 0.08f, gy * 0.08f, _time * 0.25f);
+
+    unsigned short* raw = rawDepthPixels.getData();
+    unsigned int frame = frameNum;
+    for (int y=0; y<height; y++) {
+        int gy = y / cell;
+        float fy = (y % cell) / (float)cell;
+        const float* g0 = &noiseGrid[gy * gw];
+        const float* g1 = g0 + gw;
+        unsigned short* row = raw + (size_t)y * width;
+        for (int x=0; x<width; x++) {
+            int gx = x / cell;
+            float fx = (x % cell) / (float)cell;
+            float top = g0[gx] + (g0[gx + 1] - g0[gx]) * fx;
+            float bottom = g1[gx] + (g1[gx + 1] - g1[gx]) * fx;
+            float n = top + (bottom - top) * fy;
+            // +-8mm of sensor jitter and a few dropped readings like a real kinect
+            unsigned int h = hashPixel(x, y, frame);
+            if ((h & 1023) == 0) {
+                row[x] = 0;
+                continue;
+            }
+            row[x] = 800 + n * 2700 + (int)(h >> 28) - 8;
+        }
+    }
+}
+
+//--------------------------------------------------------------
+bool SyntheticDepthSource::loadStill(const string& _path) {
+    ofShortPixels still;
+    if (ofLoadImage(still, _path) && still.getNumChannels() == 1) {
+        // 16 bit greyscale files are taken as millimetres
+        allocate(still.getWidth(), still.getHeight());
+        rawDepthPixels.swap(still);
+        bStillDone = true;
+        return true;
+    }
+
+    ofPixels still8;
+    if (!ofLoadImage(still8, _path))
+        return false;
+    // 8 bit images are taken as near = white over the clipping range
+    allocate(still8.getWidth(), still8.getHeight());
+    unsigned short* raw = rawDepthPixels.getData();
+    size_t channels = still8.getNumChannels();
+    for (size_t i=0; i<(size_t)width * height; i++) {
+        unsigned char v = still8[i * channels];
+        raw[i] = v == 0 ? 0 : (unsigned short)ofMap(v, 255, 1, nearClip, farClip);
+    }
+    bStillDone = true;
+    return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "ofMain.h"
+#include "DepthSource.h"
+
+// Procedural depth frames for running the pipeline without a sensor.
+// Frames are a pure function of the frame number, so a run with the same
+// settings reproduces exactly.
+//  blobs: rounded bodies moving on lissajous paths in front of a back wall
+//  noise: smooth animated noise surface with per pixel sensor jitter
+//  still: the same frame forever, loaded from an image or a single blob scene
+class SyntheticDepthSource : public DepthSource {
+public:
+    SyntheticDepthSource(const DepthSourceSettings& _settings);
+
+    bool	open();
+    void	update();
+    bool	isConnected() const	{ return bOpen; }
+    string	getName() const;
+
+protected:
+    void	generateBlobs(float _time);
+    void	generateNoise(float _time);
+    bool	loadStill(const string& _path);
+
+    depthSourceTypeEnum	type;
+    string		stillPath;
+    int			numBlobs;
+    bool		bOpen;
+    bool		bStillDone;
+
+    float		wallDepth;			// millimetres
+    vector<float> noiseGrid;		// coarse noise lattice, upsampled per frame
+};
@@ -0,0 +1,25 @@
+#include "TextureReader.h"
+
+
+//--------------------------------------------------------------
+void TextureReader::allocate(int _width, int _height) {
+    width = _width;
+    height = _height;
+    fbo.allocate(width, height, GL_RGBA32F);
+}
+
+//--------------------------------------------------------------
+const float* TextureReader::read(ofTexture& _texture) {
+    // blending would scale the values by alpha
+    ofPushStyle();
+    ofEnableBlendMode(OF_BLENDMODE_DISABLED);
+    fbo.begin();
+    ofClear(0, 0);
+    ofSetColor(255);
+    _texture.draw(0, 0, width, height);
+    fbo.end();
+    ofPopStyle();
+
+    fbo.readToPixels(pixels);
+    return pixels.getData();
+}
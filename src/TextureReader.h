@@ -0,0 +1,23 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Reads textures back to the CPU as RGBA floats at a fixed size. Inputs of
+// any size and format are drawn into a float buffer first, so the caller
+// always gets four channels per cell at its own grid resolution.
+class TextureReader {
+public:
+    TextureReader() : width(0), height(0) {}
+
+    void			allocate(int _width, int _height);
+    const float*	read(ofTexture& _texture);		// valid until the next read
+
+    int				getWidth() const	{ return width; }
+    int				getHeight() const	{ return height; }
+
+protected:
+    int				width;
+    int				height;
+    ofFbo			fbo;
+    ofFloatPixels	pixels;
+};
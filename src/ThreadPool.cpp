@@ -0,0 +1,114 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+using namespace std;
+
+// set on the pool's own threads so nested loops run inline instead of deadlocking
+static thread_local bool bInsideLoop = false;
+
+
+//--------------------------------------------------------------
+ThreadPool::ThreadPool() {
+    generation = 0;
+    numBusy = 0;
+    bClosing = false;
+    function = nullptr;
+    count = 0;
+    chunkSize = 1;
+    nextChunk = 0;
+}
+
+//--------------------------------------------------------------
+ThreadPool::~ThreadPool() {
+    close();
+}
+
+//--------------------------------------------------------------
+void ThreadPool::setup(int _numThreads) {
+    close();
+    if (_numThreads <= 0)
+        _numThreads = max((int)thread::hardware_concurrency(), 1);
+
+    // new workers start at the current generation, or a pool set up again would wake them on the last job
+    uint64_t currentGeneration;
+    {
+        lock_guard<std::mutex> lock(mutex);
+        bClosing = false;
+        currentGeneration = generation;
+    }
+    for (int i=1; i<_numThreads; i++)
+        workers.push_back(thread(&ThreadPool::workerLoop, this, currentGeneration));
+}
+
+//--------------------------------------------------------------
+void ThreadPool::close() {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        bClosing = true;
+    }
+    startCondition.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+    workers.clear();
+}
+
+//--------------------------------------------------------------
+void ThreadPool::parallelFor(int _count, const std::function<void(int, int)>& _function, int _minChunk) {
+    if (_count <= 0)
+        return;
+    if (workers.empty() || bInsideLoop || _count <= _minChunk) {
+        _function(0, _count);
+        return;
+    }
+
+    lock_guard<std::mutex> jobLock(jobMutex);
+    {
+        lock_guard<std::mutex> lock(mutex);
+        function = &_function;
+        count = _count;
+        // a few chunks per thread evens out uneven rows without much counter traffic
+        chunkSize = max(_minChunk, _count / (getNumThreads() * 4));
+        nextChunk = 0;
+        numBusy = workers.size();
+        generation++;
+    }
+    startCondition.notify_all();
+
+    bInsideLoop = true;
+    runChunks();
+    bInsideLoop = false;
+
+    unique_lock<std::mutex> lock(mutex);
+    doneCondition.wait(lock, [this]{ return numBusy == 0; });
+    function = nullptr;
+}
+
+//--------------------------------------------------------------
+void ThreadPool::runChunks() {
+    int numChunks = (count + chunkSize - 1) / chunkSize;
+    for (int chunk = nextChunk++; chunk < numChunks; chunk = nextChunk++) {
+        int begin = chunk * chunkSize;
+        (*function)(begin, min(begin + chunkSize, count));
+    }
+}
+
+//--------------------------------------------------------------
+void ThreadPool::workerLoop(uint64_t _generation) {
+    bInsideLoop = true;
+    uint64_t seenGeneration = _generation;
+    while (true) {
+        {
+            unique_lock<std::mutex> lock(mutex);
+            startCondition.wait(lock, [&]{ return bClosing || generation != seenGeneration; });
+            if (bClosing)
+                return;
+            seenGeneration = generation;
+        }
+
+        runChunks();
+
+        lock_guard<std::mutex> lock(mutex);
+        if (--numBusy == 0)
+            doneCondition.notify_one();
+    }
+}
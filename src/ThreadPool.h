@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+// A fixed set of worker threads for data parallel loops. parallelFor() splits
+// a range into chunks that the workers and the calling thread pull from a
+// shared counter, and returns when all of them are done. One loop runs at a
+// time; a parallelFor() issued from inside a loop body runs inline.
+class ThreadPool {
+public:
+    ThreadPool();
+    ~ThreadPool();
+
+    void	setup(int _numThreads = 0);		// including the caller, 0 uses every core
+    void	close();
+    int		getNumThreads() const			{ return workers.size() + 1; }
+
+    // calls _function(begin, end) for consecutive chunks of [0, _count)
+    void	parallelFor(int _count, const std::function<void(int, int)>& _function, int _minChunk = 1);
+
+protected:
+    void	workerLoop(uint64_t _generation);
+    void	runChunks();
+
+    std::vector<std::thread>	workers;
+    std::mutex					jobMutex;		// one parallelFor at a time
+    std::mutex					mutex;
+    std::condition_variable		startCondition;
+    std::condition_variable		doneCondition;
+    uint64_t					generation;
+    int							numBusy;
+    bool						bClosing;
+
+    // the current loop
+    const std::function<void(int, int)>* function;
+    int							count;
+    int							chunkSize;
+    std::atomic<int>			nextChunk;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+
+// Lock-free handoff of the latest item from one producer thread to one
+// consumer thread. The producer fills getWriteBuffer() and publishes it, the
+// consumer acquires the most recent published buffer. Neither side ever
+// waits; when the producer is faster, unread items are overwritten.
+template<typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : writeIndex(0), readIndex(1), shared(2) {}
+
+    // producer
+    T&		getWriteBuffer()	{ return buffers[writeIndex]; }
+
+    // returns false when the previously published item was never acquired
+    bool	publish() {
+        int previous = shared.exchange(writeIndex | FRESH, std::memory_order_acq_rel);
+        writeIndex = previous & INDEX;
+        return (previous & FRESH) == 0;
+    }
+
+    // consumer, returns false when nothing was published since the last call
+    bool	acquire() {
+        if ((shared.load(std::memory_order_acquire) & FRESH) == 0)
+            return false;
+        int previous = shared.exchange(readIndex, std::memory_order_acq_rel);
+        readIndex = previous & INDEX;
+        return true;
+    }
+
+    T&		getReadBuffer()		{ return buffers[readIndex]; }
+
+    // for allocating up front, only while neither side is running
+    T&		getBuffer(int _index) { return buffers[_index]; }
+
+protected:
+    enum { INDEX = 3, FRESH = 4 };
+
+    T					buffers[3];
+    int					writeIndex;		// producer only
+    int					readIndex;		// consumer only
+    std::atomic<int>	shared;			// index of the middle buffer plus the FRESH flag
+};
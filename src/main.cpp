@@ -1,8 +1,229 @@
 #include "ofMain.h"
 #include "ofApp.h"
+#include "ofAppGLFWWindow.h"
 
 //========================================================================
-int main(){
+static void printUsage() {
+    cout << "usage: FlowGen [options]" << endl
+         << "  --source <kinect|file|blobs|noise|still>  depth input (default kinect)" << endl
+         << "  --device <serial|index>                   kinect to open" << endl
+         << "  --file <path>                             recording to replay, or image for --source still" << endl
+         << "  --size <width>x<height>                   generator resolution (default 640x480)" << endl
+         << "  --fps <rate>                              generator and playback rate (default 30)" << endl
+         << "  --blobs <count>                           number of generated bodies (default 3)" << endl
+         << "  --fixed-step                              deliver a source frame on every update" << endl
+         << "  --speed <factor>                          playback speed of .fdr recordings (default 1)" << endl
+         << "  --no-loop                                 stop at the end of a recording" << endl
+         << "  --record <path.fdr>                       record the depth input from startup" << endl
+         << "  --fluid <gpu|cpu>                         fluid simulation backend (default gpu)" << endl
+         << "  --particles <gpu|cpu>                     particle backend (default gpu)" << endl
+         << "  --flow <dense|sparse>                     optical flow over the grid, or along the contours on the cpu (default dense)" << endl
+         << "  --max-particles <count>                   cpu particle capacity (default four per flow cell)" << endl
+         << "  --particles-out <path.csv>                write the cpu particles on exit" << endl
+         << "  --threads <count>                         threads for the cpu backends (default every core)" << endl
+         << "  --precision <tier>[,<field>=<format>]     field storage: fp32, packed, fp16 or density8 (default fp16)," << endl
+         << "                                            fields velocity, density, scalars, particles as fp32, fp16, unorm8" << endl
+         << "  --validate-precision <precision|all>      benchmark against fp32 and compare the fields, repeatable" << endl
+         << "  --benchmark <frames>                      run headless for a number of frames and write timings" << endl
+         << "  --warmup <frames>                         unmeasured frames before a benchmark (default 30)" << endl
+         << "  --dt <seconds>                            fixed benchmark time step (default 1/60)" << endl
+         << "  --out <path.json>                         benchmark report (default benchmark.json)" << endl
+         << "  --render <path.y4m|folder>                render the composite offline to a video or PNG frames" << endl
+         << "  --render-size <width>x<height>            render resolution (default 1920x1080)" << endl
+         << "  --render-frames <count>                   frames to render (default until a --no-loop recording ends)" << endl
+         << "  --render-fps <rate>                       render frame rate and simulation step (default 60)" << endl
+         << "  --export <name>                           publish flow, velocity and contours to shared memory" << endl
+         << "  --export-size <width>x<height>            size of the exported fields (default 160x90)" << endl
+         << "  --stats <path.csv|path.json>              periodically write rolling frame statistics" << endl
+         << "  --stats-interval <seconds>                how often (default 10)" << endl;
+}
+
+//========================================================================
+static bool parseArguments(int argc, char *argv[], DepthSourceSettings& _source, string& _recordPath, SimulationSettings& _simulation, BenchmarkSettings& _benchmark, RenderSettings& _render, ExportSettings& _export, StatsSettings& _stats) {
+    for (int i=1; i<argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return false;
+        }
+        else if (arg == "--source" && hasValue) {
+            if (!_source.setType(argv[++i])) {
+                cout << "unknown source " << argv[i] << endl;
+                printUsage();
+                return false;
+            }
+        }
+        else if (arg == "--fluid" && hasValue) {
+            string backend = argv[++i];
+            if (backend == "gpu")		_simulation.fluidBackend = FLUID_BACKEND_GPU;
+            else if (backend == "cpu")	_simulation.fluidBackend = FLUID_BACKEND_CPU;
+            else {
+                cout << "unknown fluid backend " << backend << endl;
+                printUsage();
+                return false;
+            }
+        }
+        else if (arg == "--particles" && hasValue) {
+            string backend = argv[++i];
+            if (backend == "gpu")		_simulation.particleBackend = PARTICLE_BACKEND_GPU;
+            else if (backend == "cpu")	_simulation.particleBackend = PARTICLE_BACKEND_CPU;
+            else {
+                cout << "unknown particle backend " << backend << endl;
+                printUsage();
+                return false;
+            }
+        }
+        else if (arg == "--flow" && hasValue) {
+            string mode = argv[++i];
+            if (mode == "dense")		_simulation.flowMode = FLOW_MODE_DENSE;
+            else if (mode == "sparse")	_simulation.flowMode = FLOW_MODE_SPARSE;
+            else {
+                cout << "unknown flow mode " << mode << endl;
+                printUsage();
+                return false;
+            }
+        }
+        else if (arg == "--device" && hasValue)	_source.device = argv[++i];
+        else if (arg == "--file" && hasValue)	_source.path = argv[++i];
+        else if (arg == "--fps" && hasValue)	_source.fps = max(ofToFloat(argv[++i]), 1.0f);
+        else if (arg == "--blobs" && hasValue)	_source.numBlobs = ofToInt(argv[++i]);
+        else if (arg == "--speed" && hasValue)	_source.speed = max(ofToFloat(argv[++i]), 0.01f);
+        else if (arg == "--record" && hasValue)	_recordPath = argv[++i];
+        else if (arg == "--threads" && hasValue)	_simulation.numThreads = max(ofToInt(argv[++i]), 0);
+        else if (arg == "--max-particles" && hasValue)	_simulation.maxParticles = max(ofToInt(argv[++i]), 0);
+        else if (arg == "--particles-out" && hasValue)	_simulation.particleExportPath = argv[++i];
+        else if ((arg == "--precision" || arg == "--validate-precision") && hasValue) {
+            string spec = argv[++i];
+            if (arg == "--validate-precision" && spec == "all") {
+                for (const string& name : FieldPrecision::getTierNames()) {
+                    if (name != "fp32")
+                        _benchmark.validatePrecisions.push_back(FieldPrecision::getTier(name));
+                }
+                continue;
+            }
+            FieldPrecision precision = _simulation.precision;
+            if (!precision.set(spec)) {
+                cout << "unknown precision " << spec << endl;
+                printUsage();
+                return false;
+            }
+            if (arg == "--precision")
+                _simulation.precision = precision;
+            else
+                _benchmark.validatePrecisions.push_back(precision);
+        }
+        else if (arg == "--benchmark" && hasValue)	_benchmark.numFrames = max(ofToInt(argv[++i]), 0);
+        else if (arg == "--warmup" && hasValue)	_benchmark.warmupFrames = max(ofToInt(argv[++i]), 0);
+        else if (arg == "--dt" && hasValue)		_benchmark.deltaTime = max(ofToFloat(argv[++i]), 0.0001f);
+        else if (arg == "--out" && hasValue)	_benchmark.outputPath = argv[++i];
+        else if (arg == "--render" && hasValue)	_render.path = argv[++i];
+        else if (arg == "--render-frames" && hasValue)	_render.numFrames = max(ofToInt(argv[++i]), 0);
+        else if (arg == "--render-fps" && hasValue)	_render.fps = max(ofToFloat(argv[++i]), 1.0f);
+        else if (arg == "--export" && hasValue)	_export.name = argv[++i];
+        else if (arg == "--stats" && hasValue)	_stats.path = argv[++i];
+        else if (arg == "--stats-interval" && hasValue)	_stats.interval = max(ofToFloat(argv[++i]), 1.0f);
+        else if (arg == "--fixed-step")			_source.fixedStep = true;
+        else if (arg == "--no-loop")			_source.loop = false;
+        else if (arg == "--size" && hasValue) {
+            vector<string> size = ofSplitString(argv[++i], "x");
+            if (size.size() == 2) {
+                _source.width = max(ofToInt(size[0]), 16);
+                _source.height = max(ofToInt(size[1]), 16);
+            }
+        }
+        else if (arg == "--export-size" && hasValue) {
+            vector<string> size = ofSplitString(argv[++i], "x");
+            if (size.size() == 2) {
+                _export.width = max(ofToInt(size[0]), 1);
+                _export.height = max(ofToInt(size[1]), 1);
+            }
+        }
+        else if (arg == "--render-size" && hasValue) {
+            vector<string> size = ofSplitString(argv[++i], "x");
+            if (size.size() == 2) {
+                _render.width = max(ofToInt(size[0]), 16);
+                _render.height = max(ofToInt(size[1]), 16);
+            }
+        }
+        else {
+            cout << "unknown argument " << arg << endl;
+            printUsage();
+            return false;
+        }
+    }
+    return true;
+}
+
+//========================================================================
+static void setDefaultEnvironment(const string& _name, const string& _value) {
+    if (getenv(_name.c_str()))
+        return;
+#ifdef _WIN32
+    _putenv_s(_name.c_str(), _value.c_str());
+#else
+    setenv(_name.c_str(), _value.c_str(), 0);
+#endif
+}
+
+//========================================================================
+static void setupShaderCache() {
+    // the app's own shaders go through ProgramCache. Flowtools compiles its programs in its own constructors, out of
+    // reach of glProgramBinary, so as a best effort for those the drivers that keep binaries keyed on driver and
+    // source themselves (NVIDIA, Mesa) are pointed next to the app, where they survive a locked down home. Others
+    // ignore these, and an environment that already sets them wins.
+    string path = ofToDataPath("shadercache", true);
+    ofDirectory::createDirectory(path, false, true);
+    setDefaultEnvironment("__GL_SHADER_DISK_CACHE", "1");				// nvidia
+    setDefaultEnvironment("__GL_SHADER_DISK_CACHE_PATH", path);
+    setDefaultEnvironment("__GL_SHADER_DISK_CACHE_SKIP_CLEANUP", "1");
+    setDefaultEnvironment("MESA_SHADER_CACHE_DIR", path);				// mesa
+    setDefaultEnvironment("MESA_GLSL_CACHE_DIR", path);
+}
+
+//========================================================================
+int main(int argc, char *argv[]){
+    chrono::steady_clock::time_point launchTime = chrono::steady_clock::now();
+    StartupTimes startupTimes;
+    
+    DepthSourceSettings sourceSettings;
+    string recordPath;
+    SimulationSettings simulation;
+    BenchmarkSettings benchmark;
+    RenderSettings render;
+    ExportSettings exportSettings;
+    StatsSettings stats;
+    if (!parseArguments(argc, argv, sourceSettings, recordPath, simulation, benchmark, render, exportSettings, stats))
+        return 1;
+    
+    // a precision validation is a benchmark per precision
+    if (!benchmark.validatePrecisions.empty() && benchmark.numFrames == 0)
+        benchmark.numFrames = 300;
+    
+    // a benchmark consumes one source frame per simulation step, however long the step takes
+    if (benchmark.numFrames > 0)
+        sourceSettings.fixedStep = true;
+    
+    // a render plays the source at its own rate on the time of the rendered frames
+    bool isRendering = !render.path.empty() && benchmark.numFrames == 0;
+    if (isRendering) {
+        sourceSettings.fixedStep = true;
+        sourceSettings.stepRate = render.fps;
+        if (render.numFrames == 0) {
+            if (sourceSettings.type != DEPTH_SOURCE_FILE) {
+                cout << "--render needs --render-frames unless the source is a recording" << endl;
+                return 1;
+            }
+            sourceSettings.loop = false;
+        }
+    }
+    else {
+        render.path.clear();
+    }
+
+    setupShaderCache();
+    
     ofGLFWWindowSettings windowSettings;
 #ifdef USE_PROGRAMMABLE_GL
     windowSettings.setGLVersion(4, 1);
@@ -10,8 +231,25 @@ int main(){
     windowSettings.width = 1280;
     windowSettings.height = 720;
     windowSettings.windowMode = OF_WINDOW;
+
+    shared_ptr<ofAppBaseWindow> window = ofCreateWindow(windowSettings);
+    startupTimes.window = chrono::duration<float, milli>(chrono::steady_clock::now() - launchTime).count();
     
-    ofCreateWindow(windowSettings);
-    
-    ofRunApp(new ofApp());
+    // benchmarks and renders draw to the hidden window or an fbo, nothing needs to be on screen
+    shared_ptr<ofAppGLFWWindow> glfwWindow = dynamic_pointer_cast<ofAppGLFWWindow>(window);
+    if ((benchmark.numFrames > 0 || isRendering) && glfwWindow)
+        glfwHideWindow(glfwWindow->getGLFWWindow());
+
+    ofApp* app = new ofApp();
+    startupTimes.constructed = chrono::duration<float, milli>(chrono::steady_clock::now() - launchTime).count();
+    app->launchTime = launchTime;
+    app->startupTimes = startupTimes;
+    app->depthSourceSettings = sourceSettings;
+    app->recordDepthPath = recordPath;
+    app->simulation = simulation;
+    app->benchmark = benchmark;
+    app->render = render;
+    app->exportSettings = exportSettings;
+    app->stats = stats;
+    ofRunApp(app);
 }
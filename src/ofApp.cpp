@@ -1,4 +1,5 @@
 #include "ofApp.h"
+#include "DepthFilePlayer.h"
 
 
 //--------------------------------------------------------------
@@ -7,79 +8,292 @@ void ofApp::setup(){
     ofSetVerticalSync(false);
     ofSetLogLevel(OF_LOG_NOTICE);
     
-    drawWidth = 1280;
-    drawHeight = 720;
+    // everything is allocated by setResolution(), the gui can change it later
+    drawWidth = 0;
+    drawHeight = 0;
+    flowWidth = 0;
+    flowHeight = 0;
+    fieldWidth = 0;
+    fieldHeight = 0;
+    resolutionChangeTime = -1;
+    quality = qualityGovernor.getQuality();
+    baseIterations = 0;
+    
+    // DEPTH SOURCE & ASSETS, opening a sensor can take seconds, the rest of the setup goes on meanwhile
+    depthSource = DepthSource::create(depthSourceSettings);
+    isStarted = false;
+    isStartupLoaded = false;
+    isSourceOpened = false;
+    startupLoader = thread([this]{
+        isSourceOpened = depthSource->open();
+        ofLoadImage(obstaclePixels, "obstacle.png");
+        isStartupLoaded = true;
+    });
+    didCamUpdate = false;
+    
+    // FLUID & PARTICLES
+    if (simulation.fluidBackend == FLUID_BACKEND_CPU || simulation.particleBackend == PARTICLE_BACKEND_CPU) {
+        threadPool.setup(simulation.numThreads);
+        ofLogNotice() << "cpu simulation on " << threadPool.getNumThreads() << " threads";
+    }
+    if (isSparseFlow())
+        ofLogNotice() << "sparse optical flow along the blob contours";
+    fluidSimulation = FluidSimulation::create(simulation.fluidBackend, &threadPool);
+    particleFlow = ParticleFlow::create(simulation.particleBackend, simulation.maxParticles, &threadPool);
+    programCache.setup(ofToDataPath("shadercache/programs", true));
+    particleFlow->setProgramCache(&programCache);
+    forceSplatter.setProgramCache(&programCache);
+    flowSplatter.setProgramCache(&programCache);
+    // a precision validation starts with its reference
+    validationRun = 0;
+    if (isValidating()) {
+        simulation.precision = FieldPrecision::getTier("fp32");
+        skipStoredPrecisions();
+    }
+    logPrecision();
+    
+    // FLOW, MASK, FLUID, PARTICLES & VISUALIZATION
     // process all but the density on 16th resolution
-    flowWidth = drawWidth / 4;
-    flowHeight = drawHeight / 4;
+    setResolution(1280, 720, 1280 / 4, 720 / 4);
     
-    // FLOW & MASK
-    opticalFlow.setup(flowWidth, flowHeight);
-    velocityMask.setup(drawWidth, drawHeight);
+    // MOUSE DRAW
+    mouseForces.setup(flowWidth, flowHeight, drawWidth, drawHeight);
     
-    // enable depth->video image calibration
-    kinect.setRegistration(true);
+    // GUI
+    setupPipeline();
+    setupGui();
+    updateResolution(true);     // as loaded from the settings
+    const ProgramCache::Stats& shaderStats = programCache.getStats();
+    ofLogNotice() << "app shaders ready in " << ofToString(shaderStats.millis, 1) << " ms, " << shaderStats.numRestored << " from the program cache, "
+                  << shaderStats.numCompiled << " compiled";
+    
+    // IDLE
+    isIdle = false;
+    lastInputTime = 0;
+    sourceInputScale = 1;
+    nextIdleCheckTime = 0;
+    
+    // BENCHMARK
+    setupProfiler();
+    memoryMonitor.setup();
+    nextMemoryTime = 0;
     
-    kinect.init();
-    //kinect.init(true); // shows infrared instead of RGB video image
-    //kinect.init(false, false); // disable video image (faster fps)
+    lastTime = ofGetElapsedTimef();
+    lastFlowTime = lastTime;
+    numDepthFrames = 0;
     
-    kinect.open();		// opens first available kinect
-    //kinect.open(1);	// open a kinect by id, starting with 0 (sorted by serial # lexicographically))
-    //kinect.open("A00362A08602047A");	// open a kinect using it's unique serial #
+    startupTimes.setupDone = getMillisSinceLaunch();
+    // offline runs start with everything in place
+    if (isOffline())
+        finishStartup();
+}
 
-    // print the intrinsic IR sensor values
-    if(kinect.isConnected()) {
-        ofLogNotice() << "sensor-emitter dist: " << kinect.getSensorEmitterDistance() << "cm";
-        ofLogNotice() << "sensor-camera dist:  " << kinect.getSensorCameraDistance() << "cm";
-        ofLogNotice() << "zero plane pixel size: " << kinect.getZeroPlanePixelSize() << "mm";
-        ofLogNotice() << "zero plane dist: " << kinect.getZeroPlaneDistance() << "mm";
+//--------------------------------------------------------------
+bool ofApp::finishStartup() {
+    if (startupLoader.joinable())
+        startupLoader.join();
+    // a sensor that isn't there yet is reopened by the capture, a recording or generator that didn't open never will be
+    bool hasSize = depthSource->getWidth() > 0 && depthSource->getHeight() > 0;
+    if (!hasSize || (!isSourceOpened && !depthSource->isLive())) {
+        startupError = "could not open " + depthSource->getName();
+        ofLogError() << startupError;
+        if (isOffline())
+            ofExit(1);
+        return false;
     }
-    didCamUpdate = false;
-    cameraFbo.allocate(kinect.getWidth(), kinect.getHeight());
-    cameraFbo.clear();
+    if (!isSourceOpened)
+        ofLogWarning() << "depth source " << depthSource->getName() << " not connected, retrying in the background";
+    ofLogNotice() << "depth source: " << depthSource->getName();
     
-    // Allocate images
-    colorImg.allocate(kinect.width, kinect.height, OF_IMAGE_COLOR);
-    grayImage.allocate(kinect.width, kinect.height, OF_IMAGE_GRAYSCALE);
-    grayThreshNear.allocate(kinect.width, kinect.height, OF_IMAGE_GRAYSCALE);
-    grayThreshFar.allocate(kinect.width, kinect.height, OF_IMAGE_GRAYSCALE);
-    grayPreprocImage.allocate(kinect.width, kinect.height, OF_IMAGE_GRAYSCALE);
+    int sourceWidth = depthSource->getWidth();
+    int sourceHeight = depthSource->getHeight();
+    cameraFbo.allocate(sourceWidth, sourceHeight);
+    cameraFbo.clear();
+    depthTexture.allocate(sourceWidth, sourceHeight, GL_LUMINANCE);
+    flowRegion.setup(sourceWidth, sourceHeight);
     
-    // Configure contour finder
-    contourFinder.setMinAreaRadius(10);
-    contourFinder.setMaxAreaRadius(200);
-    contourFinder.setFindHoles(false);
+    // fixed step runs take exactly one source frame per update, so they capture inline
+    depthCapture.setup(depthSource, !depthSourceSettings.fixedStep);
     
+    if (obstaclePixels.isAllocated()) {
+        obstacleImage.setFromPixels(obstaclePixels);
+        fluidSimulation->addObstacle(obstacleImage.getTexture());
+    }
 
-    
-    // FLUID & PARTICLES
-#ifdef USE_FASTER_INTERNAL_FORMATS
-    fluidSimulation.setup(flowWidth, flowHeight, drawWidth, drawHeight, true);
-    particleFlow.setup(flowWidth, flowHeight, drawWidth, drawHeight, true);
-#else
-    fluidSimulation.setup(flowWidth, flowHeight, drawWidth, drawHeight, false);
-    particleFlow.setup(flowWidth, flowHeight, drawWidth, drawHeight, false);
-#endif
-    
-    obstacleImage.load("obstacle.png");
-    fluidSimulation.addObstacle(obstacleImage.getTexture());
-    
-    // VISUALIZATION
-    displayScalar.setup(flowWidth, flowHeight);
-    velocityField.setup(flowWidth / 4, flowHeight / 4);
-    temperatureField.setup(flowWidth / 4, flowHeight / 4);
-    pressureField.setup(flowWidth / 4, flowHeight / 4);
-    velocityTemperatureField.setup(flowWidth / 4, flowHeight / 4);
-    
-    // MOUSE DRAW
-    mouseForces.setup(flowWidth, flowHeight, drawWidth, drawHeight);
-    
-    // GUI
-    setupGui();
+    // recording asked for before the source was open
+    if (!recordDepthPath.empty() || doRecordDepth) {
+        bool record = true;
+        setRecordDepth(record);
+        doRecordDepth.setWithoutEventNotifications(true);
+    }
     
     lastTime = ofGetElapsedTimef();
+    lastFlowTime = lastTime;
+    lastInputTime = lastTime;
+    isStarted = true;
+    startupTimes.started = getMillisSinceLaunch();
+    return true;
+}
     
+//--------------------------------------------------------------
+float ofApp::getMillisSinceLaunch() const {
+    return chrono::duration<float, milli>(chrono::steady_clock::now() - launchTime).count();
+}
+
+//--------------------------------------------------------------
+static const char* drawModeNames[] = {
+    "composite", "fluid density", "particles", "fluid fields", "fluid velocity", "fluid pressure", "fluid temperature",
+    "fluid divergence", "fluid vorticity", "fluid buoyancy", "fluid obstacle", "flow mask", "optical flow", "source", "mouse"
+};
+
+//--------------------------------------------------------------
+void ofApp::setupProfiler() {
+    vector<string> stageNames = {
+        "source", "depth image", "band pass", "obstacle grid", "blobs", "sparse flow", "depth upload", "camera fbo",
+        "flow region", "optical flow", "flow splat", "velocity mask", "force splat", "fluid input", "fluid", "particles"
+    };
+    for (int i=DRAW_COMPOSITE; i<=DRAW_MOUSE; i++)
+        stageNames.push_back(string("draw ") + drawModeNames[i]);
+    profiler.setup(stageNames, true);
+    profiler.setEnabled(true);
+    nextStatsTime = stats.interval;
+    
+    benchmarkFrame = 0;
+    if (isBenchmarking()) {
+        // exact numbers over every measured frame, worth a stall per frame
+        profiler.setBlocking(true);
+        profiler.setKeepSamples(true);
+        ofSetFrameRate(0);
+        ofLogNotice() << "benchmark: " << benchmark.warmupFrames << " warmup + " << benchmark.numFrames
+                      << " frames at a fixed step of " << benchmark.deltaTime << "s";
+        if (isValidating())
+            ofLogNotice() << "validating " << benchmark.validatePrecisions.size() << " precisions against fp32, the source replays for each";
+    }
+    renderFrame = 0;
+    if (isRendering())
+        setupRender();
+    
+    exportFramesLeft = 0;
+    if (!exportSettings.name.empty()) {
+        if (fieldExporter.setup(exportSettings.name, exportSettings.width, exportSettings.height))
+            ofLogNotice() << "exporting " << exportSettings.width << "x" << exportSettings.height << " fields to shared memory " << exportSettings.name;
+        else
+            ofLogError() << "could not create shared memory " << exportSettings.name;
+    }
+}
+
+//--------------------------------------------------------------
+void ofApp::setupPipeline() {
+    // declared in the order they always ran, GL state and all
+    depthGraph.addStage("depth upload", STAGE_QUEUE_GL, {"depth"}, {"depth texture"}, [this]{
+        DepthFrame& depthFrame = depthCapture.getFrame();
+        if (depthFrame.depth)
+            depthTexture.loadData(depthFrame.depth.getData(), depthFrame.depth.getWidth(), depthFrame.depth.getHeight(), GL_LUMINANCE);
+    }, STAGE_DEPTH_UPLOAD);
+    depthGraph.addStage("camera fbo", STAGE_QUEUE_GL, {"depth texture"}, {"camera"}, [this]{
+        ofPushStyle();
+        ofEnableBlendMode(OF_BLENDMODE_DISABLED);
+        cameraFbo.begin();
+        ofSetColor(ofColor::white);
+        if (doFlipCamera)
+            depthTexture.draw(cameraFbo.getWidth(), 0, -cameraFbo.getWidth(), cameraFbo.getHeight());  // Flip Horizontal
+        else
+            depthTexture.draw(0, 0, cameraFbo.getWidth(), cameraFbo.getHeight());
+        cameraFbo.end();
+        ofDisableBlendMode();
+        ofPopStyle();
+    }, STAGE_CAMERA_FBO);
+    // only the silhouettes and a margin around them go through the flow and the mask
+    depthGraph.addStage("flow region", STAGE_QUEUE_CPU, {"blobs"}, {"region"}, [this]{
+        flowRegion.setEnabled(doFlowRegion);
+        flowRegion.setPadding(flowRegionPadding);
+        flowRegion.setHoldFrames(flowRegionHold);
+        flowRegion.update(depthCapture.getFrame().blobs);
+    }, STAGE_FLOW_REGION);
+    // the source is copied whole, the previous frame is current wherever the region grows
+    depthGraph.addStage("optical flow", STAGE_QUEUE_GL, {"camera", "region"}, {"flow"}, [this]{
+        if (isSparseFlow())
+            return;
+        opticalFlow.setSource(cameraFbo.getTexture());
+        if (!flowRegion.isEmpty()) {
+            flowRegion.beginScissor(flowWidth, flowHeight, doFlipCamera);
+            opticalFlow.update(flowDeltaTime);
+            flowRegion.endScissor();
+        }
+        flowRegion.clearOutside(opticalFlow.getOpticalFlow(), doFlipCamera);
+        flowRegion.clearOutside(opticalFlow.getOpticalFlowDecay(), doFlipCamera);
+    }, STAGE_OPTICAL_FLOW);
+    // the points tracked on the capture side, already inside the region
+    depthGraph.addStage("flow splat", STAGE_QUEUE_GL, {"flow points"}, {"flow"}, [this]{
+        if (!isSparseFlow())
+            return;
+        addFlowPoints(depthCapture.getFrame());
+        flowSplatter.setMaxForces(maxFlowPoints);
+        flowSplatter.update();
+    }, STAGE_FLOW_SPLAT);
+    depthGraph.addStage("velocity mask", STAGE_QUEUE_GL, {"camera", "flow", "region"}, {"mask"}, [this]{
+        if (!flowRegion.isEmpty()) {
+            velocityMask.setDensity(cameraFbo.getTexture());
+            velocityMask.setVelocity(getFlowVelocity(false));
+            flowRegion.beginScissor(drawWidth, drawHeight, doFlipCamera);
+            velocityMask.update();
+            flowRegion.endScissor();
+        }
+        flowRegion.clearOutside(velocityMask.getColorMask(), doFlipCamera);
+        flowRegion.clearOutside(velocityMask.getLuminanceMask(), doFlipCamera);
+    }, STAGE_VELOCITY_MASK);
+    // held until the next depth frame replaces them, like the optical flow
+    depthGraph.addStage("force splat", STAGE_QUEUE_GL, {"blobs"}, {"forces"}, [this]{
+        if (doBlobForces)
+            addBlobForces(depthCapture.getFrame());
+        forceSplatter.setMaxForces(maxForces);
+        forceSplatter.setMergeDistance(forceMergeDistance);
+        forceSplatter.update();
+    }, STAGE_FORCE_SPLAT);
+    depthGraph.setProfiler(&profiler);
+    
+    stepGraph.addStage("fluid input", STAGE_QUEUE_GL, {"flow", "mask", "forces", "mouse"}, {"fluid"}, [this]{
+        addSimulationInput();
+    }, STAGE_FLUID_INPUT);
+    stepGraph.addStage("fluid", STAGE_QUEUE_GL, {"fluid"}, {"fluid"}, [this]{
+        fluidSimulation->update(stepTime);
+    }, STAGE_FLUID);
+    stepGraph.addStage("particles", STAGE_QUEUE_GL, {"flow", "fluid"}, {"particles"}, [this]{
+        if (particleFlow->isActive()) {
+            particleFlow->setSpeed(fluidSimulation->getSpeed());
+            particleFlow->setCellSize(fluidSimulation->getCellSize());
+            if (!flowRegion.isEmpty() && sourceInputScale > 0)
+                particleFlow->addFlowVelocity(getFlowVelocity(false), sourceInputScale);
+            particleFlow->addFluidVelocity(fluidSimulation->getVelocity());
+            //		particleFlow->addDensity(fluidSimulation->getDensity());
+            particleFlow->setObstacle(fluidSimulation->getObstacle());
+        }
+        particleFlow->update(stepTime);
+    }, STAGE_PARTICLES);
+    stepGraph.setProfiler(&profiler);
+    flowDeltaTime = 0;
+    stepTime = 0;
+    
+    // one switch per stage, all on with the motion gate, flow region and adaptive quality off (their defaults) reproduces the fixed pipeline
+    StageGraph* graphs[] = { &depthCapture.getStages(), &depthGraph, &stepGraph };
+    stageToggles.clear();
+    for (StageGraph* graph : graphs) {
+        for (int i=0; i<graph->getNumStages(); i++)
+            stageToggles.push_back(ofParameter<bool>().set(graph->getName(i), true));
+    }
+    ofLogNotice() << "capture stages: " << depthCapture.getStages().getSchedule();
+    ofLogNotice() << "depth frame stages: " << depthGraph.getSchedule();
+    ofLogNotice() << "simulation step stages: " << stepGraph.getSchedule();
+}
+
+//--------------------------------------------------------------
+void ofApp::applyStageToggles() {
+    StageGraph* graphs[] = { &depthCapture.getStages(), &depthGraph, &stepGraph };
+    int toggle = 0;
+    for (StageGraph* graph : graphs) {
+        for (int i=0; i<graph->getNumStages(); i++)
+            graph->setEnabled(i, stageToggles[toggle++]);
+    }
 }
 
 //--------------------------------------------------------------
@@ -90,6 +304,8 @@ void ofApp::setupGui() {
     gui.setDefaultFillColor(ofColor(160, 160, 160, 160));
     gui.add(guiFPS.set("average FPS", 0, 0, 60));
     gui.add(guiMinFPS.set("minimum FPS", 0, 0, 60));
+    gui.add(showStats.set("show stats (P)", false));
+    gui.add(guiCaptureDrops.set("dropped src/gpu/rec", "0 / 0 / 0"));
     gui.add(doFullScreen.set("fullscreen (F)", false));
     doFullScreen.addListener(this, &ofApp::setFullScreen);
     gui.add(toggleGuiDraw.set("show gui (G)", false));
@@ -123,12 +339,12 @@ void ofApp::setupGui() {
     gui.setDefaultHeaderBackgroundColor(guiHeaderColor[guiColorSwitch]);
     gui.setDefaultFillColor(guiFillColor[guiColorSwitch]);
     guiColorSwitch = 1 - guiColorSwitch;
-    gui.add(fluidSimulation.parameters);
+    gui.add(fluidSimulation->getParameters());
     
     gui.setDefaultHeaderBackgroundColor(guiHeaderColor[guiColorSwitch]);
     gui.setDefaultFillColor(guiFillColor[guiColorSwitch]);
     guiColorSwitch = 1 - guiColorSwitch;
-    gui.add(particleFlow.parameters);
+    gui.add(particleFlow->getParameters());
     
     gui.setDefaultHeaderBackgroundColor(guiHeaderColor[guiColorSwitch]);
     gui.setDefaultFillColor(guiFillColor[guiColorSwitch]);
@@ -142,8 +358,19 @@ void ofApp::setupGui() {
     
     
     kinectParameters.setName("input source");
-    kinectParameters.add(nearThreshold.set("near threshold", 230, 0, 500));
-    kinectParameters.add(farThreshold.set("near threshold", 220, 0, 500));
+    kinectParameters.add(nearThreshold.set("near threshold (mm)", 500, 0, 8000));
+    kinectParameters.add(farThreshold.set("far threshold (mm)", 2000, 0, 8000));
+    kinectParameters.add(maskDilation.set("mask dilation", 2, 0, 4));
+    kinectParameters.add(doMotionGate.set("motion gate", false));
+    kinectParameters.add(motionThreshold.set("motion threshold", 0.002, 0, 0.02));
+    kinectParameters.add(motionArea.set("motion area (blocks)", 2, 0, 50));
+    kinectParameters.add(doFlowRegion.set("flow region", false));
+    kinectParameters.add(flowRegionPadding.set("region padding", 0.05, 0, 0.25));
+    kinectParameters.add(flowRegionHold.set("region hold (frames)", 30, 1, 120));
+    kinectParameters.add(doDepthObstacles.set("depth obstacles", false));
+    kinectParameters.add(sourceLostFade.set("fade when lost (s)", 2, 0, 10));
+    kinectParameters.add(doRecordDepth.set("record depth (D)", false));
+    doRecordDepth.addListener(this, &ofApp::setRecordDepth);
     
     gui.setDefaultHeaderBackgroundColor(guiHeaderColor[guiColorSwitch]);
     gui.setDefaultFillColor(guiFillColor[guiColorSwitch]);
@@ -151,6 +378,97 @@ void ofApp::setupGui() {
     gui.add(kinectParameters);
     
     
+    forceParameters.setName("blob forces");
+    forceParameters.add(doBlobForces.set("blob forces", false));
+    forceParameters.add(blobVelocity.set("velocity", 10, 0, 100));
+    forceParameters.add(blobDensity.set("density", 0.2, 0, 1));
+    forceParameters.add(blobRadius.set("radius", 1, 0.1, 3));
+    forceParameters.add(maxForces.set("max per field", 64, 1, 512));
+    forceParameters.add(forceMergeDistance.set("merge distance", 0.03, 0, 0.2));
+    
+    gui.setDefaultHeaderBackgroundColor(guiHeaderColor[guiColorSwitch]);
+    gui.setDefaultFillColor(guiFillColor[guiColorSwitch]);
+    guiColorSwitch = 1 - guiColorSwitch;
+    gui.add(forceParameters);
+    
+    
+    sparseFlowParameters.setName("sparse flow");
+    sparseFlowParameters.add(flowPointSpacing.set("point spacing", 6, 2, 32));
+    sparseFlowParameters.add(maxFlowPoints.set("max points", 400, 16, 2000));
+    sparseFlowParameters.add(flowWindowRadius.set("window radius", 7, 2, 15));
+    sparseFlowParameters.add(flowLevels.set("pyramid levels", 3, 1, SparseFlow::MAX_LEVELS));
+    sparseFlowParameters.add(flowPointVelocity.set("velocity", 10, 0, 100));
+    sparseFlowParameters.add(flowPointRadius.set("radius", 1.5, 0.5, 4));
+    
+    gui.setDefaultHeaderBackgroundColor(guiHeaderColor[guiColorSwitch]);
+    gui.setDefaultFillColor(guiFillColor[guiColorSwitch]);
+    guiColorSwitch = 1 - guiColorSwitch;
+    gui.add(sparseFlowParameters);
+    
+    
+    // particles live for up to lifespan * (1 + spread), the delay should outlast them
+    idleParameters.setName("idle");
+    idleParameters.add(doIdle.set("idle when still", true));
+    idleParameters.add(idleVelocity.set("idle velocity", 0.01, 0, 0.1));
+    idleParameters.add(idleDelay.set("idle after (s)", 8, 0, 60));
+    idleParameters.add(idleFrameRate.set("idle fps", 10, 1, 60));
+    idleParameters.add(guiIdleState.set("state", "active"));
+    
+    gui.setDefaultHeaderBackgroundColor(guiHeaderColor[guiColorSwitch]);
+    gui.setDefaultFillColor(guiFillColor[guiColorSwitch]);
+    guiColorSwitch = 1 - guiColorSwitch;
+    gui.add(idleParameters);
+    
+    
+    resolutionParameters.setName("resolution");
+    resolutionParameters.add(targetDrawWidth.set("draw width", drawWidth, 320, 3840));
+    resolutionParameters.add(targetDrawHeight.set("draw height", drawHeight, 180, 2160));
+    resolutionParameters.add(flowDivisor.set("flow divisor", drawWidth / flowWidth, 1, 16));
+    resolutionParameters.add(fieldDivisor.set("field divisor", 4, 1, 16));
+    targetDrawWidth.addListener(this, &ofApp::resolutionChanged);
+    targetDrawHeight.addListener(this, &ofApp::resolutionChanged);
+    flowDivisor.addListener(this, &ofApp::resolutionChanged);
+    fieldDivisor.addListener(this, &ofApp::resolutionChanged);
+    
+    gui.setDefaultHeaderBackgroundColor(guiHeaderColor[guiColorSwitch]);
+    gui.setDefaultFillColor(guiFillColor[guiColorSwitch]);
+    guiColorSwitch = 1 - guiColorSwitch;
+    gui.add(resolutionParameters);
+    
+    
+    clockParameters.setName("simulation clock");
+    clockParameters.add(simulationRate.set("steps per second", 60, 10, 120));
+    clockParameters.add(maxSimulationSteps.set("max steps per frame", 4, 1, 8));
+    clockParameters.add(guiSimulationSteps.set("steps / dropped", "0 / 0"));
+    
+    gui.setDefaultHeaderBackgroundColor(guiHeaderColor[guiColorSwitch]);
+    gui.setDefaultFillColor(guiFillColor[guiColorSwitch]);
+    guiColorSwitch = 1 - guiColorSwitch;
+    gui.add(clockParameters);
+    
+    
+    qualityParameters.setName("quality");
+    qualityParameters.add(doAdaptiveQuality.set("adaptive quality", false));
+    qualityParameters.add(frameBudget.set("frame budget (ms)", 16.6, 5, 50));
+    qualityParameters.add(budgetPercentile.set("budget percentile", 95, 50, 99));
+    qualityParameters.add(guiQualityLevel.set("level", "0 / " + ofToString(qualityGovernor.getNumLevels() - 1)));
+    
+    gui.setDefaultHeaderBackgroundColor(guiHeaderColor[guiColorSwitch]);
+    gui.setDefaultFillColor(guiFillColor[guiColorSwitch]);
+    guiColorSwitch = 1 - guiColorSwitch;
+    gui.add(qualityParameters);
+    
+    
+    pipelineParameters.setName("pipeline");
+    for (ofParameter<bool>& toggle : stageToggles)
+        pipelineParameters.add(toggle);
+    
+    gui.setDefaultHeaderBackgroundColor(guiHeaderColor[guiColorSwitch]);
+    gui.setDefaultFillColor(guiFillColor[guiColorSwitch]);
+    guiColorSwitch = 1 - guiColorSwitch;
+    gui.add(pipelineParameters);
+    
+    
     visualizeParameters.setName("visualizers");
     visualizeParameters.add(showScalar.set("show scalar", true));
     visualizeParameters.add(displayScalarScale.set("scalar scale", 0.15, 0.05, 0.5));
@@ -183,106 +501,468 @@ void ofApp::setupGui() {
 //--------------------------------------------------------------
 void ofApp::update(){
     
-    kinect.update();
+    if (!isStarted) {
+        if (!isStartupLoaded || !startupError.empty() || !finishStartup())
+            return;
+    }
     
-    deltaTime = ofGetElapsedTimef() - lastTime;
-    lastTime = ofGetElapsedTimef();
+    updateQuality();
+    updateResolution();
     
-    if (kinect.isFrameNew()) {
-
-        // Load grayscale depth image from the kinect source
-        grayImage.setFromPixels(kinect.getDepthPixels(), kinect.width, kinect.height, OF_IMAGE_GRAYSCALE);
-        
-        // Threshold image
-        threshold(grayImage, grayThreshNear, nearThreshold, true);
-        threshold(grayImage, grayThreshFar, farThreshold);
-        
-        // Convert to CV to perform AND operation
-        Mat grayThreshNearMat = toCv(grayThreshNear);
-        Mat grayThreshFarMat = toCv(grayThreshFar);
-        Mat grayImageMat = toCv(grayImage);
-        
-        // cvAnd to get the pixels which are a union of the two thresholds
-        bitwise_and(grayThreshNearMat, grayThreshFarMat, grayImageMat);
-        
-        // Save pre-processed image for drawing it
-        grayPreprocImage = grayImage;
-        
-        // Process image
-        dilate(grayImage);
-        dilate(grayImage);
-        //erode(grayImage);
-        
-        // Mark image as changed
-        grayImage.update();
-        
-        // Find contours
-        //contourFinder.setThreshold(ofMap(mouseX, 0, ofGetWidth(), 0, 255));
-        contourFinder.findContours(grayImage);
-        
-        ofPushStyle();
-        ofEnableBlendMode(OF_BLENDMODE_DISABLED);
-        cameraFbo.begin();
-        ofSetColor(ofColor::white);
-        if (doFlipCamera)
-            kinect.drawDepth(cameraFbo.getWidth(), 0, -cameraFbo.getWidth(), cameraFbo.getHeight());  // Flip Horizontal
-        else
-            kinect.drawDepth(0, 0, cameraFbo.getWidth(), cameraFbo.getHeight());
-        cameraFbo.end();
-        ofDisableBlendMode();
-        ofPopStyle();
+    if (isBenchmarking())
+        profiler.setEnabled(benchmarkFrame >= benchmark.warmupFrames);
+    profiler.beginFrame();
+    
+    // with everything the last frame drew still allocated
+    if (ofGetElapsedTimef() >= nextMemoryTime) {
+        memoryMonitor.update();
+        nextMemoryTime = ofGetElapsedTimef() + 1;
+    }
+    
+    depthCapture.setBandPass(nearThreshold, farThreshold, maskDilation);
+    depthCapture.setMotionGate(doMotionGate, motionThreshold, motionArea);
+    depthCapture.setObstacleGrid(doDepthObstacles ? flowWidth : 0, flowHeight);
+    depthCapture.setTraceContours(fieldExporter.isOpen());
+    depthCapture.setSparseFlow(isSparseFlow(), flowPointSpacing, maxFlowPoints, flowWindowRadius, flowLevels);
+    applyStageToggles();
+    bool isDepthFrameNew = depthCapture.update();
+    
+    // a full disk ends the recording, the frames written until then stay readable
+    if (doRecordDepth && depthCapture.getStats().bRecorderFailed) {
+        ofLogError() << "writing " << depthCapture.getRecorder().getPath() << " failed, recording stopped";
+        doRecordDepth = false;
+    }
+    
+    // a lost sensor leaves its last mask in place, the flow it left behind fades out instead of pushing forever
+    SourceSupervisor::Status sourceStatus = depthCapture.getSourceStatus();
+    if (sourceStatus.state == SOURCE_CONNECTED)
+        sourceInputScale = 1;
+    else
+        sourceInputScale = sourceLostFade > 0 ? ofClamp(1 - sourceStatus.secondsLost / sourceLostFade, 0, 1) : 0;
+    
+    // benchmarks and renders run exactly one step per frame
+    simulationClock.setStep(isOffline() ? getOfflineStep() : 1.0 / simulationRate);
+    simulationClock.setMaxSteps(isOffline() ? 1 : maxSimulationSteps.get());
+    if (isOffline()) {
+        deltaTime = getOfflineStep();
+    }
+    else {
+        // a hitch isn't passed on to anything as one huge step
+        deltaTime = min(ofGetElapsedTimef() - lastTime, (float)simulationClock.getMaxFrameTime());
+        lastTime = ofGetElapsedTimef();
+    }
+    
+    if (isDepthFrameNew) {
+        DepthFrame& depthFrame = depthCapture.getFrame();
+        lastInputTime = ofGetElapsedTimef();
+        setIdle(false);
+        numDepthFrames++;
         
-        opticalFlow.setSource(cameraFbo.getTexture());
-        opticalFlow.update(deltaTime);
+        // the flow decays per depth frame, over the time since the last one
+        flowDeltaTime = deltaTime;
+        if (!isOffline()) {
+            flowDeltaTime = min(ofGetElapsedTimef() - lastFlowTime, (float)simulationClock.getMaxFrameTime());
+            lastFlowTime = ofGetElapsedTimef();
+        }
+
+        // timed on the capture side
+        profiler.addCpuTime(STAGE_SOURCE, depthFrame.sourceMillis);
+        profiler.addCpuTime(STAGE_DEPTH_IMAGE, depthFrame.depthImageMillis);
+        profiler.addCpuTime(STAGE_BAND_PASS, depthFrame.bandPassMillis);
+        profiler.addCpuTime(STAGE_OBSTACLE_GRID, depthFrame.obstacleMillis);
+        profiler.addCpuTime(STAGE_BLOBS, depthFrame.blobsMillis);
+        profiler.addCpuTime(STAGE_SPARSE_FLOW, depthFrame.sparseFlowMillis);
         
-        velocityMask.setDensity(cameraFbo.getTexture());
-        velocityMask.setVelocity(opticalFlow.getOpticalFlow());
-        velocityMask.update();
+        depthGraph.run();
     }
     
+    updateDepthObstacle(isDepthFrameNew);
     
-    fluidSimulation.addVelocity(opticalFlow.getOpticalFlowDecay());
-    fluidSimulation.addDensity(velocityMask.getColorMask());
-    fluidSimulation.addTemperature(velocityMask.getLuminanceMask());
     
+    // mouse input at display rate, applied with the next simulation step
     mouseForces.update(deltaTime);
-    
+    pendingMouseForces.resize(mouseForces.getNumForces(), false);
     for (int i=0; i<mouseForces.getNumForces(); i++) {
         if (mouseForces.didChange(i)) {
-            switch (mouseForces.getType(i)) {
-                case FT_DENSITY:
-                    fluidSimulation.addDensity(mouseForces.getTextureReference(i), mouseForces.getStrength(i));
-                    break;
-                case FT_VELOCITY:
-                    fluidSimulation.addVelocity(mouseForces.getTextureReference(i), mouseForces.getStrength(i));
-                    particleFlow.addFlowVelocity(mouseForces.getTextureReference(i), mouseForces.getStrength(i));
-                    break;
-                case FT_TEMPERATURE:
-                    fluidSimulation.addTemperature(mouseForces.getTextureReference(i), mouseForces.getStrength(i));
-                    break;
-                case FT_PRESSURE:
-                    fluidSimulation.addPressure(mouseForces.getTextureReference(i), mouseForces.getStrength(i));
-                    break;
-                case FT_OBSTACLE:
-                    fluidSimulation.addTempObstacle(mouseForces.getTextureReference(i));
-                default:
-                    break;
-            }
+            pendingMouseForces[i] = true;
+            lastInputTime = ofGetElapsedTimef();
+            setIdle(false);
+        }
+    }
+    
+    // benchmarks measure the full pipeline on every frame, renders show it
+    if (doIdle && !isOffline())
+        updateIdle();
+    else
+        setIdle(false);
+    if (isIdle) {
+        simulationClock.reset();
+        updateExport(false);
+        return;
+    }
+    
+    // frames without a step draw the last state again
+    int numSteps = simulationClock.advance(deltaTime);
+    stepTime = simulationClock.getStep();
+    for (int step=0; step<numSteps; step++)
+        stepGraph.run();
+    
+    updateExport(isDepthFrameNew || numSteps > 0);
+}
+
+//--------------------------------------------------------------
+void ofApp::updateExport(bool _isNew) {
+    if (!fieldExporter.isOpen())
+        return;
+    
+    // a frame comes out of the read back a few publishes later, keep going that long after the last change
+    if (_isNew)
+        exportFramesLeft = fieldExporter.getLatency() + 1;
+    if (exportFramesLeft == 0)
+        return;
+    exportFramesLeft--;
+    
+    const DepthFrame& depthFrame = depthCapture.getFrame();
+    fieldExporter.publish(getFlowVelocity(true), fluidSimulation->getVelocity(), depthFrame.blobs,
+                          depthSource->getWidth(), depthSource->getHeight(), doFlipCamera, depthFrame.frameNum, depthFrame.captureMicros);
+}
+
+//--------------------------------------------------------------
+void ofApp::addSimulationInput() {
+    // the add passes ping-pong, a scissor would leave older frames outside it, an empty region skips them instead
+    if (!flowRegion.isEmpty() && sourceInputScale > 0) {
+        fluidSimulation->addVelocity(getFlowVelocity(true), sourceInputScale);
+        fluidSimulation->addDensity(velocityMask.getColorMask(), sourceInputScale);
+        fluidSimulation->addTemperature(velocityMask.getLuminanceMask(), sourceInputScale);
+    }
+    
+    // every blob force of a field in one pass, however many there are
+    if (doBlobForces && sourceInputScale > 0) {
+        if (forceSplatter.hasForces(FT_DENSITY))
+            fluidSimulation->addDensity(forceSplatter.getTexture(FT_DENSITY), sourceInputScale);
+        if (forceSplatter.hasForces(FT_VELOCITY)) {
+            fluidSimulation->addVelocity(forceSplatter.getTexture(FT_VELOCITY), sourceInputScale);
+            particleFlow->addFlowVelocity(forceSplatter.getTexture(FT_VELOCITY), sourceInputScale);
+        }
+    }
+    
+    for (int i=0; i<mouseForces.getNumForces(); i++) {
+        if (!pendingMouseForces[i])
+            continue;
+        pendingMouseForces[i] = false;
+        switch (mouseForces.getType(i)) {
+            case FT_DENSITY:
+                fluidSimulation->addDensity(mouseForces.getTextureReference(i), mouseForces.getStrength(i));
+                break;
+            case FT_VELOCITY:
+                fluidSimulation->addVelocity(mouseForces.getTextureReference(i), mouseForces.getStrength(i));
+                particleFlow->addFlowVelocity(mouseForces.getTextureReference(i), mouseForces.getStrength(i));
+                break;
+            case FT_TEMPERATURE:
+                fluidSimulation->addTemperature(mouseForces.getTextureReference(i), mouseForces.getStrength(i));
+                break;
+            case FT_PRESSURE:
+                fluidSimulation->addPressure(mouseForces.getTextureReference(i), mouseForces.getStrength(i));
+                break;
+            case FT_OBSTACLE:
+                fluidSimulation->addTempObstacle(mouseForces.getTextureReference(i));
+            default:
+                break;
+        }
+    }
+}
+
+//--------------------------------------------------------------
+void ofApp::addBlobForces(const DepthFrame& _frame) {
+    // velocities relative to the field, like the optical flow
+    float sourceWidth = depthSource->getWidth();
+    float sourceHeight = depthSource->getHeight();
+    for (const Blob& blob : _frame.blobs) {
+        ofVec2f position(blob.centroid.x / sourceWidth, blob.centroid.y / sourceHeight);
+        ofVec2f velocity(blob.velocity.x / sourceWidth, blob.velocity.y / sourceHeight);
+        if (doFlipCamera) {
+            position.x = 1 - position.x;
+            velocity.x = -velocity.x;
+        }
+        float radius = blobRadius * 0.5 * min(blob.bounds.width, blob.bounds.height) / sourceWidth;
+        
+        if (velocity != ofVec2f())
+            forceSplatter.add(PointForce(FT_VELOCITY, position, ofFloatColor(velocity.x * blobVelocity, velocity.y * blobVelocity, 0, 0), radius));
+        if (blobDensity > 0)
+            forceSplatter.add(PointForce(FT_DENSITY, position, ofFloatColor(blobDensity, blobDensity, blobDensity, blobDensity), radius, 0.5));
+    }
+}
+
+//--------------------------------------------------------------
+void ofApp::addFlowPoints(const DepthFrame& _frame) {
+    // velocities relative to the field, like the blob forces, each point covering its stretch of the
+    // contour, which is wider than the parameter asks when the contours are longer than the points allow
+    float sourceWidth = depthSource->getWidth();
+    float sourceHeight = depthSource->getHeight();
+    float radius = flowPointRadius * 0.5 * _frame.flowPointSpacing / sourceWidth;
+    for (const FlowPoint& point : _frame.flowPoints) {
+        ofVec2f position(point.position.x / sourceWidth, point.position.y / sourceHeight);
+        ofVec2f velocity(point.velocity.x / sourceWidth, point.velocity.y / sourceHeight);
+        if (doFlipCamera) {
+            position.x = 1 - position.x;
+            velocity.x = -velocity.x;
+        }
+        if (velocity != ofVec2f())
+            flowSplatter.add(PointForce(FT_VELOCITY, position, ofFloatColor(velocity.x * flowPointVelocity, velocity.y * flowPointVelocity, 0, 0), radius));
+    }
+}
+
+//--------------------------------------------------------------
+ofTexture& ofApp::getFlowVelocity(bool _decayed) {
+    // the splats are held until the next depth frame, they stand in for both
+    if (isSparseFlow())
+        return flowSplatter.getTexture(FT_VELOCITY);
+    return _decayed ? opticalFlow.getOpticalFlowDecay() : opticalFlow.getOpticalFlow();
+}
+
+//--------------------------------------------------------------
+void ofApp::updateIdle() {
+    float now = ofGetElapsedTimef();
+    if (isIdle || now - lastInputTime < idleDelay || now < nextIdleCheckTime)
+        return;
+    
+    // the read back waits for the GPU, twice a second is plenty
+    nextIdleCheckTime = now + 0.5;
+    if (isFieldStill())
+        setIdle(true);
+}
+
+//--------------------------------------------------------------
+bool ofApp::isFieldStill() {
+    int numCells = idleReader.getWidth() * idleReader.getHeight();
+    
+    const float* velocity = idleReader.read(fluidSimulation->getVelocity());
+    float maxVelocity2 = idleVelocity * idleVelocity;
+    for (int i=0; i<numCells; i++) {
+        if (velocity[i * 4] * velocity[i * 4] + velocity[i * 4 + 1] * velocity[i * 4 + 1] > maxVelocity2)
+            return false;
+    }
+    
+    // nothing visible left either, idling freezes the last frame on screen
+    const float* density = idleReader.read(fluidSimulation->getDensity());
+    for (int i=0; i<numCells; i++) {
+        if (max(density[i * 4], max(density[i * 4 + 1], density[i * 4 + 2])) > 0.02)
+            return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+void ofApp::setIdle(bool _value) {
+    if (_value == isIdle)
+        return;
+    isIdle = _value;
+    guiIdleState.set(isIdle ? "idle" : "active");
+    // awake it runs uncapped again, as it starts
+    if (!isOffline())
+        ofSetFrameRate(isIdle ? idleFrameRate.get() : 0);
+    ofLogNotice() << (isIdle ? "idle, nothing moved for " + ofToString(idleDelay.get()) + "s" : "active");
+}
+
+//--------------------------------------------------------------
+void ofApp::updateQuality() {
+    // benchmarks measure and renders show one fixed quality
+    if (!doAdaptiveQuality || isOffline()) {
+        if (qualityGovernor.getLevel() > 0) {
+            qualityGovernor.reset();
+            ofLogNotice() << "quality " << qualityGovernor.getLevel() << ": adaptive quality off";
+            applyQuality(qualityGovernor.getQuality());
         }
+        return;
+    }
+    // idle frames say nothing about the load
+    if (isIdle || profiler.getFrameStats().getCount() == 0)
+        return;
+    
+    // with the GPU behind, little CPU time is spent per frame; the longer of the two bounds the frame
+    float frameMillis = max(profiler.getFrameStats().getLast(), profiler.getGpuFrameStats().getLast());
+    qualityGovernor.setBudget(frameBudget, budgetPercentile);
+    if (!qualityGovernor.update(frameMillis, ofGetElapsedTimef()))
+        return;
+    
+    ofLogNotice() << "quality " << qualityGovernor.getLevel() << ": " << qualityGovernor.getReason();
+    applyQuality(qualityGovernor.getQuality());
+}
+
+//--------------------------------------------------------------
+void ofApp::applyQuality(const QualityLevel& _quality) {
+    quality = _quality;
+    updateResolution(true);
+    
+    // the gui value is what full quality goes back to
+    ofParameter<int>& iterations = fluidSimulation->getIterations();
+    if (quality.iterationScale < 1) {
+        if (baseIterations == 0)
+            baseIterations = iterations;
+        iterations = max((int)(baseIterations * quality.iterationScale + 0.5), 1);
+    }
+    else if (baseIterations > 0) {
+        iterations = baseIterations;
+        baseIterations = 0;
     }
     
-    fluidSimulation.update();
+    particleFlow->setBudget(quality.particleScale);
     
-    if (particleFlow.isActive()) {
-        particleFlow.setSpeed(fluidSimulation.getSpeed());
-        particleFlow.setCellSize(fluidSimulation.getCellSize());
-        particleFlow.addFlowVelocity(opticalFlow.getOpticalFlow());
-        particleFlow.addFluidVelocity(fluidSimulation.getVelocity());
-        //		particleFlow.addDensity(fluidSimulation.getDensity());
-        particleFlow.setObstacle(fluidSimulation.getObstacle());
+    guiQualityLevel.set(ofToString(qualityGovernor.getLevel()) + " / " + ofToString(qualityGovernor.getNumLevels() - 1));
+    ofLogNotice() << "quality: flow " << flowWidth << "x" << flowHeight << ", " << iterations << " iterations, "
+                  << quality.particleScale * 100 << "% particles, fields " << fieldWidth << "x" << fieldHeight;
+}
+
+//--------------------------------------------------------------
+void ofApp::updateResolution(bool _now) {
+    // sliders are applied once they have been left alone for a moment, not on every step of a drag
+    if (!_now && (resolutionChangeTime < 0 || ofGetElapsedTimef() - resolutionChangeTime < 0.5))
+        return;
+    resolutionChangeTime = -1;
+    
+    int width = targetDrawWidth;
+    int height = targetDrawHeight;
+    int newFlowWidth = max((int)(width / flowDivisor * quality.flowScale), 8);
+    int newFlowHeight = max((int)(height / flowDivisor * quality.flowScale), 8);
+    if (width != drawWidth || height != drawHeight || newFlowWidth != flowWidth || newFlowHeight != flowHeight)
+        setResolution(width, height, newFlowWidth, newFlowHeight);
+    else
+        setupFieldVisualizers();
+}
+
+//--------------------------------------------------------------
+static void copyTexture(ofTexture& _texture, ofFbo& _fbo) {
+    if (!_fbo.isAllocated() || _fbo.getWidth() != _texture.getWidth() || _fbo.getHeight() != _texture.getHeight())
+        _fbo.allocate(_texture.getWidth(), _texture.getHeight(), GL_RGBA32F);
+    
+    // blending would scale the values by alpha
+    ofPushStyle();
+    ofEnableBlendMode(OF_BLENDMODE_DISABLED);
+    _fbo.begin();
+    ofClear(0, 0);
+    ofSetColor(255);
+    _texture.draw(0, 0, _fbo.getWidth(), _fbo.getHeight());
+    _fbo.end();
+    ofPopStyle();
+}
+
+//--------------------------------------------------------------
+void ofApp::setResolution(int _drawWidth, int _drawHeight, int _flowWidth, int _flowHeight) {
+    // the fields are kept at their old size and added to the new, empty ones, which resamples them;
+    // velocities are relative to the grid size and need no scaling
+    bool bResample = flowWidth > 0;
+    if (bResample) {
+        copyTexture(fluidSimulation->getVelocity(), resampleFbos[0]);
+        copyTexture(fluidSimulation->getDensity(), resampleFbos[1]);
+        copyTexture(fluidSimulation->getTemperature(), resampleFbos[2]);
     }
-    particleFlow.update();
     
+    bool bDrawChanged = _drawWidth != drawWidth || _drawHeight != drawHeight;
+    bool bFlowChanged = _flowWidth != flowWidth || _flowHeight != flowHeight;
+    drawWidth = _drawWidth;
+    drawHeight = _drawHeight;
+    flowWidth = _flowWidth;
+    flowHeight = _flowHeight;
+    
+    if (bDrawChanged)
+        velocityMask.setup(drawWidth, drawHeight);
+    if (bFlowChanged)
+        opticalFlow.setup(flowWidth, flowHeight);
+    setupSimulation();
+    if (bResample) {
+        fluidSimulation->addVelocity(resampleFbos[0].getTexture());
+        fluidSimulation->addDensity(resampleFbos[1].getTexture());
+        fluidSimulation->addTemperature(resampleFbos[2].getTexture());
+    }
+    
+    if (bFlowChanged) {
+        displayScalar.setup(flowWidth, flowHeight);
+        idleReader.allocate(max(flowWidth / 8, 1), max(flowHeight / 8, 1));
+    }
+    setupFieldVisualizers();
+    renderCache.invalidate();
+    
+    ofLogNotice() << "resolution: draw " << drawWidth << "x" << drawHeight << ", flow " << flowWidth << "x" << flowHeight
+                  << ", fields " << fieldWidth << "x" << fieldHeight;
+}
+
+//--------------------------------------------------------------
+void ofApp::setupSimulation() {
+    fluidSimulation->setup(flowWidth, flowHeight, drawWidth, drawHeight, simulation.precision);
+    particleFlow->setup(flowWidth, flowHeight, drawWidth, drawHeight, simulation.precision);
+    // the splats go into the fluid, finer ones than it keeps would only cost bandwidth
+    FieldPrecision stored = getStoredPrecision(simulation.precision);
+    forceSplatter.setup(flowWidth, flowHeight, stored);
+    flowSplatter.setup(flowWidth, flowHeight, stored);
+    if (obstacleImage.isAllocated())
+        fluidSimulation->addObstacle(obstacleImage.getTexture());
+    obstacleMap.setup(flowWidth, flowHeight);
+}
+
+//--------------------------------------------------------------
+FieldPrecision ofApp::getStoredPrecision(const FieldPrecision& _precision) const {
+    // each backend only changes its own fields
+    return particleFlow->getStoredPrecision(fluidSimulation->getStoredPrecision(_precision));
+}
+
+//--------------------------------------------------------------
+void ofApp::logPrecision() const {
+    FieldPrecision stored = getStoredPrecision(simulation.precision);
+    if (stored == simulation.precision) {
+        ofLogNotice() << "field precision " << simulation.precision.getName();
+        return;
+    }
+    ofLogWarning() << "field precision " << simulation.precision.getName() << ", stored as " << stored.getName()
+                   << " by the " << fluidSimulation->getName() << " fluid and " << particleFlow->getName() << " particles";
+}
+
+//--------------------------------------------------------------
+void ofApp::skipStoredPrecisions() {
+    // a precision the backends store like an earlier run would only measure the same formats again
+    vector<FieldPrecision> precisions;
+    vector<FieldPrecision> stored(1, getStoredPrecision(simulation.precision));
+    for (const FieldPrecision& precision : benchmark.validatePrecisions) {
+        FieldPrecision storedAs = getStoredPrecision(precision);
+        if (find(stored.begin(), stored.end(), storedAs) != stored.end()) {
+            ofLogWarning() << "skipping " << precision.getName() << ", the " << fluidSimulation->getName() << " fluid and "
+                           << particleFlow->getName() << " particles store it as " << storedAs.getName() << " like an earlier run";
+            continue;
+        }
+        precisions.push_back(precision);
+        stored.push_back(storedAs);
+    }
+    if (precisions.empty())
+        ofLogWarning() << "no precision left to validate, only benchmarking the reference";
+    benchmark.validatePrecisions = precisions;
+}
+
+//--------------------------------------------------------------
+void ofApp::updateDepthObstacle(bool _isDepthFrameNew) {
+    // the static obstacle stays where it is, this one follows the bodies in front of the sensor
+    if (!doDepthObstacles) {
+        if (obstacleMap.getNumCells() == 0)
+            return;
+        obstacleMap.clear();
+    }
+    else if (!_isDepthFrameNew || !obstacleMap.update(depthCapture.getFrame().obstacle, doFlipCamera)) {
+        return;
+    }
+    fluidSimulation->setDynamicObstacle(obstacleMap.getPixels(), obstacleMap.getDirtyTiles());
+}
+
+//--------------------------------------------------------------
+void ofApp::setupFieldVisualizers() {
+    int divisor = fieldDivisor > 0 ? fieldDivisor.get() : 4;
+    int width = max((int)(flowWidth * quality.fieldScale / divisor), 1);
+    int height = max((int)(flowHeight * quality.fieldScale / divisor), 1);
+    if (width == fieldWidth && height == fieldHeight)
+        return;
+    fieldWidth = width;
+    fieldHeight = height;
+    velocityField.setup(fieldWidth, fieldHeight);
+    temperatureField.setup(fieldWidth, fieldHeight);
+    pressureField.setup(fieldWidth, fieldHeight);
+    velocityTemperatureField.setup(fieldWidth, fieldHeight);
 }
 
 //--------------------------------------------------------------
@@ -294,6 +974,10 @@ void ofApp::keyPressed(int key){
         case 'F': doFullScreen.set(!doFullScreen.get()); break;
         case 'c':
         case 'C': doDrawCamBackground.set(!doDrawCamBackground.get()); break;
+        case 'd':
+        case 'D': doRecordDepth.set(!doRecordDepth.get()); break;
+        case 'p':
+        case 'P': showStats.set(!showStats.get()); break;
             
         case '1': drawMode.set(DRAW_COMPOSITE); break;
         case '2': drawMode.set(DRAW_FLUID_FIELDS); break;
@@ -306,15 +990,78 @@ void ofApp::keyPressed(int key){
             
         case 'r':
         case 'R':
-            fluidSimulation.reset();
-            fluidSimulation.addObstacle(obstacleImage.getTexture());
+            fluidSimulation->reset();
+            if (obstacleImage.isAllocated())
+                fluidSimulation->addObstacle(obstacleImage.getTexture());
             mouseForces.reset();
+            renderCache.invalidate();
             break;
             
         default: break;
     }
 }
 
+//--------------------------------------------------------------
+void ofApp::setRecordDepth(bool &_value) {
+    // started by finishStartup() once the source is open
+    if (!isStarted)
+        return;
+    if (!_value) {
+        if (depthCapture.isRecording()) {
+            depthCapture.stopRecording();
+            const DepthRecorder& depthRecorder = depthCapture.getRecorder();
+            ofLogNotice() << "recorded " << depthRecorder.getNumFrames() << " frames to " << depthRecorder.getPath()
+                          << " (" << depthRecorder.getBytesWritten() / (1024 * 1024) << "MB, "
+                          << ofToString(depthRecorder.getRawBytes() / (double)max<uint64_t>(depthRecorder.getBytesWritten(), 1), 1) << ":1, "
+                          << depthRecorder.getNumDropped() << " dropped" << (depthRecorder.hasFailed() ? ", stopped by a failed write" : "") << ")";
+        }
+        return;
+    }
+    
+    string path = recordDepthPath;
+    recordDepthPath.clear();    // the command line path is only used once
+    if (path.empty()) {
+        ofDirectory::createDirectory("recordings", true, true);
+        path = "recordings/depth_" + ofGetTimestampString("%Y-%m-%d_%H-%M-%S") + ".fdr";
+    }
+    
+    if (depthCapture.startRecording(ofToDataPath(path, true)))
+        ofLogNotice() << "recording depth to " << path;
+    else {
+        ofLogError() << "could not record depth to " << path;
+        doRecordDepth.set(false);
+    }
+}
+
+//--------------------------------------------------------------
+void ofApp::exit() {
+    if (startupLoader.joinable())
+        startupLoader.join();
+    doRecordDepth = false;
+    depthCapture.stop();
+    frameWriter.close();
+    fieldExporter.close();
+    
+    if (!simulation.particleExportPath.empty()) {
+        if (particleFlow->savePositions(simulation.particleExportPath))
+            ofLogNotice() << "saved particle positions to " << simulation.particleExportPath;
+        else
+            ofLogError() << "could not save particle positions to " << simulation.particleExportPath;
+    }
+    
+    DepthCapture::Stats stats = depthCapture.getStats();
+    ofLogNotice() << "captured " << stats.numCaptured << " depth frames, skipped " << stats.numSkippedStill << " still, dropped " << stats.numDroppedAtSource << " at the source, "
+                  << stats.numDroppedAtHandoff << " at the handoff and " << stats.numDroppedAtRecorder << " at the recorder"
+                  << (stats.bRecorderFailed ? ", the recording stopped on a failed write" : "");
+    memoryMonitor.update();
+    ofLogNotice() << "peak memory " << getMemoryString();
+    if (depthCapture.isSupervised()) {
+        SourceSupervisor::Status sourceStatus = depthCapture.getSourceStatus();
+        ofLogNotice() << "depth source " << SourceSupervisor::getStateName(sourceStatus.state) << ", reconnected " << sourceStatus.numReconnects << " times in "
+                      << sourceStatus.numAttempts << " attempts, " << sourceStatus.numGaps << " frame gaps, longest " << ofToString(sourceStatus.longestGapMillis, 0) << " ms";
+    }
+}
+
 //--------------------------------------------------------------
 void ofApp::drawModeSetName(int &_value) {
     switch(_value) {
@@ -338,36 +1085,393 @@ void ofApp::drawModeSetName(int &_value) {
 
 //--------------------------------------------------------------
 void ofApp::draw(){
-    ofClear(0,0);
-    if (doDrawCamBackground.get())
-        drawSource();
+    if (!isStarted) {
+        drawHoldingFrame();
+        return;
+    }
+    if (startupTimes.firstFrame < 0) {
+        startupTimes.firstFrame = getMillisSinceLaunch();
+        ofLogNotice() << "first frame " << ofToString(startupTimes.firstFrame, 0) << " ms after launch (window " << ofToString(startupTimes.window, 0)
+                      << ", constructors and shaders " << ofToString(startupTimes.constructed - startupTimes.window, 0)
+                      << ", setup " << ofToString(startupTimes.setupDone - startupTimes.constructed, 0)
+                      << ", source and assets ready " << ofToString(startupTimes.started, 0) << ")";
+    }
     
+    if (isBenchmarking()) {
+        drawBenchmark();
+        return;
+    }
+    if (isRendering()) {
+        drawRender();
+        return;
+    }
+    
+    ofClear(0,0);
+    int mode = toggleGuiDraw ? drawMode.get() : DRAW_COMPOSITE;
+    profiler.begin(STAGE_DRAW + mode);
+    if (isCachedMode(mode)) {
+        drawCached(mode);
+    }
+    else {
+        if (doDrawCamBackground.get())
+            drawSource();
+        drawByMode(mode);
+    }
+    profiler.end(STAGE_DRAW + mode);
     
     if (!toggleGuiDraw) {
         ofHideCursor();
-        drawComposite();
     }
     else {
         ofShowCursor();
-        switch(drawMode.get()) {
-            case DRAW_COMPOSITE: drawComposite(); break;
-            case DRAW_PARTICLES: drawParticles(); break;
-            case DRAW_FLUID_FIELDS: drawFluidFields(); break;
-            case DRAW_FLUID_DENSITY: drawFluidDensity(); break;
-            case DRAW_FLUID_VELOCITY: drawFluidVelocity(); break;
-            case DRAW_FLUID_PRESSURE: drawFluidPressure(); break;
-            case DRAW_FLUID_TEMPERATURE: drawFluidTemperature(); break;
-            case DRAW_FLUID_DIVERGENCE: drawFluidDivergence(); break;
-            case DRAW_FLUID_VORTICITY: drawFluidVorticity(); break;
-            case DRAW_FLUID_BUOYANCY: drawFluidBuoyance(); break;
-            case DRAW_FLUID_OBSTACLE: drawFluidObstacle(); break;
-            case DRAW_FLOW_MASK: drawMask(); break;
-            case DRAW_OPTICAL_FLOW: drawOpticalFlow(); break;
-            case DRAW_SOURCE: drawSource(); break;
-            case DRAW_MOUSE: drawMouseForces(); break;
-        }
         drawGui();
     }
+    if (showStats)
+        drawStats();
+    
+    profiler.endFrame();
+    
+    if (!stats.path.empty() && ofGetElapsedTimef() >= nextStatsTime) {
+        saveStats();
+        nextStatsTime = ofGetElapsedTimef() + stats.interval;
+    }
+}
+
+//--------------------------------------------------------------
+void ofApp::drawHoldingFrame() {
+    if (startupTimes.holdingFrame < 0)
+        startupTimes.holdingFrame = getMillisSinceLaunch();
+    ofClear(0, 255);
+    ofPushStyle();
+    if (startupError.empty()) {
+        ofSetColor(96);
+        ofDrawBitmapString("starting " + depthSource->getName(), 20, ofGetWindowHeight() - 20);
+    }
+    else {
+        ofSetColor(ofColor::red);
+        ofDrawBitmapString(startupError, 20, ofGetWindowHeight() - 20);
+    }
+    ofPopStyle();
+}
+
+//--------------------------------------------------------------
+void ofApp::drawStats() {
+    const RollingStats& interval = profiler.getIntervalStats();
+    const RollingStats& frame = profiler.getFrameStats();
+    
+    stringstream text;
+    text << fixed << setprecision(2);
+    text << "last " << interval.getCount() << " frames          p50     p99     max ms" << endl;
+    text << "interval              " << setw(6) << interval.getPercentile(50) << "  " << setw(6) << interval.getPercentile(99) << "  " << setw(6) << interval.getMax() << endl;
+    text << "update + draw         " << setw(6) << frame.getPercentile(50) << "  " << setw(6) << frame.getPercentile(99) << "  " << setw(6) << frame.getMax() << endl;
+    text << "depth skipped still   " << depthCapture.getStats().numSkippedStill << (isIdle ? ", idle" : "") << endl;
+    if (depthCapture.isSupervised()) {
+        SourceSupervisor::Status sourceStatus = depthCapture.getSourceStatus();
+        text << "depth source          " << SourceSupervisor::getStateName(sourceStatus.state);
+        if (sourceStatus.state != SOURCE_CONNECTED)
+            text << " " << ofToString(sourceStatus.secondsLost, 1) << "s, retry in " << ofToString(sourceStatus.secondsToRetry, 1) << "s";
+        text << ", " << sourceStatus.numReconnects << " reconnects, " << sourceStatus.numGaps << " gaps, longest " << ofToString(sourceStatus.longestGapMillis, 0) << " ms" << endl;
+    }
+    text << "simulation steps      " << simulationClock.getNumSteps() << ", " << simulationClock.getNumDropped() << " dropped at " << ofToString(1.0 / simulationClock.getStep(), 0) << " per second" << endl;
+    text << "quality level         " << qualityGovernor.getLevel() << " / " << qualityGovernor.getNumLevels() - 1 << ", p" << budgetPercentile.get() << " "
+         << qualityGovernor.getLoad() << " of " << frameBudget.get() << endl;
+    if (isSparseFlow()) {
+        const ForceSplatter::Stats& flowStats = flowSplatter.getStats();
+        text << "sparse flow           " << depthCapture.getFrame().flowPoints.size() << " points, " << flowStats.numSplatted << " splatted" << endl;
+    }
+    text << "flow region           " << (flowRegion.isEnabled() ? ofToString(flowRegion.getCoverage() * 100, 0) + "%" : "off") << endl;
+    text << "first frame           " << ofToString(startupTimes.firstFrame, 0) << " ms after launch" << endl;
+    text << "field export          " << (fieldExporter.isOpen() ? fieldExporter.getName() + ", " + ofToString(fieldExporter.getNumPublished()) + " published" : string("off")) << endl;
+    const ForceSplatter::Stats& forceStats = forceSplatter.getStats();
+    text << "blob forces           " << (doBlobForces ? ofToString(forceStats.numSplatted) + " of " + ofToString(forceStats.numAdded) + " splatted, " + ofToString(forceStats.numMerged) + " merged, "
+                                         + ofToString(forceStats.numDropped) + " dropped" : "off") << endl;
+    text << "memory peak           " << getMemoryString() << endl;
+    DepthCapture::Stats captureStats = depthCapture.getStats();
+    text << "frame pools           " << captureStats.numPoolBuffers << " buffers, " << ofToString(captureStats.poolBytes / (1024 * 1024.0), 1) << " MB" << endl;
+    text << "draw cache            " << renderCache.getNumHits() << " hits, " << renderCache.getNumRenders() << " renders" << endl;
+    text << "depth obstacle        " << (doDepthObstacles ? ofToString(obstacleMap.getNumCells()) + " cells, " + ofToString(obstacleMap.getDirtyTiles().size()) + " / "
+                                         + ofToString(obstacleMap.getNumTiles()) + " tiles changed" : "off") << endl;
+    text << endl << "                      cpu p50 / p99     gpu p50 / p99" << endl;
+    for (int i=0; i<profiler.getNumStages(); i++) {
+        const RollingStats& cpu = profiler.getCpuStats(i);
+        const RollingStats& gpu = profiler.getGpuStats(i);
+        if (cpu.getCount() == 0)
+            continue;
+        string name = profiler.getName(i);
+        name.resize(20, ' ');
+        text << name << "  " << setw(6) << cpu.getPercentile(50) << " / " << setw(6) << cpu.getPercentile(99)
+             << "   " << setw(6) << gpu.getPercentile(50) << " / " << setw(6) << gpu.getPercentile(99) << endl;
+    }
+    
+    ofPushStyle();
+    ofEnableBlendMode(OF_BLENDMODE_ALPHA);
+    ofDrawBitmapStringHighlight(text.str(), ofGetWindowWidth() - 440, 20, ofColor(0, 0, 0, 160), ofColor::white);
+    ofPopStyle();
+}
+
+//--------------------------------------------------------------
+void ofApp::saveStats() {
+    bool saved;
+    if (ofFilePath::getFileExt(stats.path) == "csv") {
+        saved = profiler.appendCsv(stats.path);
+    }
+    else {
+        vector<pair<string, string> > info;
+        info.push_back(make_pair("time", ofGetTimestampString("%Y-%m-%d %H:%M:%S")));
+        info.push_back(make_pair("source", depthSource->getName()));
+        info.push_back(make_pair("windowSeconds", ofToString(profiler.getWindow())));
+        info.push_back(make_pair("peakCpuBytes", ofToString(memoryMonitor.getPeakCpuBytes())));
+        info.push_back(make_pair("peakGpuBytes", ofToString(memoryMonitor.getPeakGpuBytes())));
+        saved = profiler.saveJson(stats.path, info);
+    }
+    if (!saved)
+        ofLogWarning() << "could not write stats to " << stats.path;
+}
+
+//--------------------------------------------------------------
+string ofApp::getMemoryString() const {
+    const double mb = 1024 * 1024;
+    string text = "cpu " + ofToString(memoryMonitor.getPeakCpuBytes() / mb, 0) + " MB, gpu ";
+    if (memoryMonitor.getGpuTotalBytes() > 0)
+        text += ofToString(memoryMonitor.getPeakGpuBytes() / mb, 0) + " of " + ofToString(memoryMonitor.getGpuTotalBytes() / mb, 0) + " MB on the device";
+    else if (memoryMonitor.hasGpuInfo())
+        text += ofToString(memoryMonitor.getGpuFreeBytes() / mb, 0) + " MB free";
+    else
+        text += "not reported";
+    return text;
+}
+
+//--------------------------------------------------------------
+void ofApp::drawByMode(int _mode) {
+    switch(_mode) {
+        case DRAW_COMPOSITE: drawComposite(); break;
+        case DRAW_PARTICLES: drawParticles(); break;
+        case DRAW_FLUID_FIELDS: drawFluidFields(); break;
+        case DRAW_FLUID_DENSITY: drawFluidDensity(); break;
+        case DRAW_FLUID_VELOCITY: drawFluidVelocity(); break;
+        case DRAW_FLUID_PRESSURE: drawFluidPressure(); break;
+        case DRAW_FLUID_TEMPERATURE: drawFluidTemperature(); break;
+        case DRAW_FLUID_DIVERGENCE: drawFluidDivergence(); break;
+        case DRAW_FLUID_VORTICITY: drawFluidVorticity(); break;
+        case DRAW_FLUID_BUOYANCY: drawFluidBuoyance(); break;
+        case DRAW_FLUID_OBSTACLE: drawFluidObstacle(); break;
+        case DRAW_FLOW_MASK: drawMask(); break;
+        case DRAW_OPTICAL_FLOW: drawOpticalFlow(); break;
+        case DRAW_SOURCE: drawSource(); break;
+        case DRAW_MOUSE: drawMouseForces(); break;
+    }
+}
+
+//--------------------------------------------------------------
+bool ofApp::isCachedMode(int _mode) const {
+    // the visualizer modes, everything else is a plain texture draw or changes every frame anyway
+    return (_mode >= DRAW_FLUID_FIELDS && _mode <= DRAW_FLUID_BUOYANCY) || _mode == DRAW_OPTICAL_FLOW;
+}
+
+//--------------------------------------------------------------
+void ofApp::drawCached(int _mode) {
+    // the visualizers only change with a simulation step, a depth frame they show or one of their settings
+    bool bShowsDepth = _mode == DRAW_OPTICAL_FLOW || doDrawCamBackground;
+    vector<double> key = { (double)_mode, (double)simulationClock.getNumSteps(), bShowsDepth ? (double)numDepthFrames : 0.0,
+        (double)doDrawCamBackground, (double)showScalar, (double)showField, displayScalarScale, velocityFieldScale,
+        temperatureFieldScale, pressureFieldScale, (double)velocityLineSmooth, (double)fieldWidth, (double)fieldHeight };
+    
+    renderCache.setup(ofGetWindowWidth(), ofGetWindowHeight());
+    if (renderCache.begin(key)) {
+        ofClear(0,0);
+        if (doDrawCamBackground.get())
+            drawSource();
+        drawByMode(_mode);
+        renderCache.end();
+    }
+    
+    ofPushStyle();
+    ofEnableBlendMode(OF_BLENDMODE_DISABLED);
+    ofSetColor(255);
+    renderCache.draw(0, 0);
+    ofPopStyle();
+}
+
+//--------------------------------------------------------------
+void ofApp::drawBenchmark() {
+    // every draw mode once per frame, each timed on its own
+    for (int mode=DRAW_COMPOSITE; mode<=DRAW_MOUSE; mode++) {
+        ofClear(0,0);
+        profiler.begin(STAGE_DRAW + mode);
+        drawByMode(mode);
+        profiler.end(STAGE_DRAW + mode);
+    }
+    profiler.endFrame();
+    
+    benchmarkFrame++;
+    if (benchmarkFrame % 100 == 0)
+        ofLogNotice() << "benchmark frame " << benchmarkFrame << " / " << benchmark.warmupFrames + benchmark.numFrames;
+    if (benchmarkFrame < benchmark.warmupFrames + benchmark.numFrames)
+        return;
+    if (isValidating())
+        finishValidationRun();
+    else
+        finishBenchmark();
+}
+
+//--------------------------------------------------------------
+vector<pair<string, string> > ofApp::getBenchmarkInfo() {
+    vector<pair<string, string> > info;
+    info.push_back(make_pair("source", depthSource->getName()));
+    info.push_back(make_pair("sourceSize", ofToString(depthSource->getWidth()) + "x" + ofToString(depthSource->getHeight())));
+    info.push_back(make_pair("flowSize", ofToString(flowWidth) + "x" + ofToString(flowHeight)));
+    info.push_back(make_pair("drawSize", ofToString(drawWidth) + "x" + ofToString(drawHeight)));
+    info.push_back(make_pair("fieldSize", ofToString(fieldWidth) + "x" + ofToString(fieldHeight)));
+    info.push_back(make_pair("deltaTime", ofToString(benchmark.deltaTime)));
+    info.push_back(make_pair("firstFrameMillis", ofToString(startupTimes.firstFrame, 0)));
+    info.push_back(make_pair("warmupFrames", ofToString(benchmark.warmupFrames)));
+    info.push_back(make_pair("capture", depthCapture.isThreaded() ? "threaded" : "inline"));
+    info.push_back(make_pair("flow", isSparseFlow() ? "sparse" : "dense"));
+    info.push_back(make_pair("fluid", fluidSimulation->getName()));
+    info.push_back(make_pair("particles", particleFlow->getName()));
+    info.push_back(make_pair("threads", ofToString(threadPool.getNumThreads())));
+    memoryMonitor.update();
+    info.push_back(make_pair("peakCpuBytes", ofToString(memoryMonitor.getPeakCpuBytes())));
+    info.push_back(make_pair("peakGpuBytes", ofToString(memoryMonitor.getPeakGpuBytes())));
+    info.push_back(make_pair("peakPoolBytes", ofToString(depthCapture.getStats().peakPoolBytes)));
+    info.push_back(make_pair("glVendor", (const char*)glGetString(GL_VENDOR)));
+    info.push_back(make_pair("glRenderer", (const char*)glGetString(GL_RENDERER)));
+    info.push_back(make_pair("glVersion", (const char*)glGetString(GL_VERSION)));
+    return info;
+}
+
+//--------------------------------------------------------------
+void ofApp::finishBenchmark() {
+    vector<pair<string, string> > info = getBenchmarkInfo();
+    info.push_back(make_pair("precision", simulation.precision.getName()));
+    info.push_back(make_pair("storedPrecision", getStoredPrecision(simulation.precision).getName()));
+    
+    for (int i=0; i<profiler.getNumStages(); i++) {
+        StageProfiler::Summary cpu = profiler.getCpuSummary(i);
+        StageProfiler::Summary gpu = profiler.getGpuSummary(i);
+        if (cpu.count > 0)
+            ofLogNotice() << profiler.getName(i) << ": cpu " << cpu.mean << " / " << cpu.p99 << " ms, gpu " << gpu.mean << " / " << gpu.p99 << " ms (mean / p99)";
+    }
+    StageProfiler::Summary frame = profiler.getFrameSummary();
+    ofLogNotice() << "frame: " << frame.mean << " / " << frame.p99 << " ms (mean / p99)";
+    
+    if (profiler.saveJson(benchmark.outputPath, info))
+        ofLogNotice() << "benchmark written to " << benchmark.outputPath;
+    else
+        ofLogError() << "could not write " << benchmark.outputPath;
+    
+    benchmark.numFrames = 0;
+    ofExit();
+}
+
+//--------------------------------------------------------------
+void ofApp::finishValidationRun() {
+    // drawn into float fbos and read back, so every format compares as four float channels
+    const char* names[4] = { "velocity", "density", "temperature", "pressure" };
+    ofTexture* textures[4] = { &fluidSimulation->getVelocity(), &fluidSimulation->getDensity(), &fluidSimulation->getTemperature(), &fluidSimulation->getPressure() };
+    vector<pair<string, ofFloatPixels> > fields(4);
+    for (int i=0; i<4; i++) {
+        copyTexture(*textures[i], validationFbo);
+        fields[i].first = names[i];
+        validationFbo.getTexture().readToPixels(fields[i].second);
+    }
+    
+    string name = simulation.precision.getName();
+    string storedName = getStoredPrecision(simulation.precision).getName();
+    StageProfiler::Summary frame = profiler.getFrameSummary();
+    if (!precisionValidator.addRun(name, storedName, frame.mean, fields)) {
+        ofLogError() << "the fields of " << name << " don't match the reference";
+    }
+    else {
+        const PrecisionValidator::Run& run = precisionValidator.getRuns().back();
+        ofLogNotice() << name << " (stored as " << storedName << "): " << frame.mean << " ms per frame, " << ofToString(run.speedup, 2) << "x";
+        for (const PrecisionValidator::FieldError& error : run.errors)
+            ofLogNotice() << "    " << error.name << " max " << error.maxError << ", rms " << error.rmsError << " (" << ofToString(error.relativeRmsError * 100, 3) << "%)";
+    }
+    
+    validationRun++;
+    if (validationRun <= (int)benchmark.validatePrecisions.size()) {
+        simulation.precision = benchmark.validatePrecisions[validationRun - 1];
+        restartSimulation();
+        return;
+    }
+    
+    simulation.precision = FieldPrecision::getTier("fp32");
+    vector<pair<string, string> > info = getBenchmarkInfo();
+    info.push_back(make_pair("frames", ofToString(benchmark.numFrames)));
+    if (precisionValidator.saveJson(benchmark.outputPath, info))
+        ofLogNotice() << "precision validation written to " << benchmark.outputPath;
+    else
+        ofLogError() << "could not write " << benchmark.outputPath;
+    
+    benchmark.numFrames = 0;
+    ofExit();
+}
+
+//--------------------------------------------------------------
+void ofApp::restartSimulation() {
+    // the same frames from a clean slate, only the precision differs
+    setupSimulation();
+    opticalFlow.setup(flowWidth, flowHeight);
+    flowRegion.setup(depthSource->getWidth(), depthSource->getHeight());
+    depthSource->restart();
+    depthCapture.setup(depthSource, depthCapture.isThreaded());
+    simulationClock.reset();
+    profiler.clear();
+    benchmarkFrame = 0;
+    ofLogNotice() << "validating " << simulation.precision.getName() << " (stored as " << getStoredPrecision(simulation.precision).getName() << ") against fp32";
+}
+
+//--------------------------------------------------------------
+void ofApp::setupRender() {
+    ofSetFrameRate(0);
+    renderFbo.allocate(render.width, render.height, GL_RGBA);
+    string path = ofToDataPath(render.path, true);
+    if (!frameWriter.open(path, render.width, render.height, render.fps)) {
+        ofLogError() << "could not write a render to " << path;
+        ofExit(1);
+        return;
+    }
+    renderStartTime = ofGetElapsedTimef();
+    ofLogNotice() << "render: " << (render.numFrames > 0 ? ofToString(render.numFrames) + " frames" : string("until the recording ends"))
+                  << " of " << render.width << "x" << render.height << " at " << render.fps << " fps to " << path;
+}
+
+//--------------------------------------------------------------
+void ofApp::drawRender() {
+    if (!frameWriter.isOpen())
+        return;
+    
+    // the composite at the output size, whatever the window
+    renderFbo.begin();
+    ofClear(0, 255);
+    drawComposite(0, 0, render.width, render.height);
+    renderFbo.end();
+    frameWriter.addFrame(renderFbo.getTexture());
+    renderFrame++;
+    
+    if (renderFrame % 100 == 0)
+        ofLogNotice() << "render frame " << renderFrame << (render.numFrames > 0 ? " / " + ofToString(render.numFrames) : string());
+    
+    shared_ptr<DepthFilePlayer> player = dynamic_pointer_cast<DepthFilePlayer>(depthSource);
+    bool bEnded = render.numFrames == 0 && player && player->isFinished();
+    if ((render.numFrames > 0 && renderFrame >= (uint64_t)render.numFrames) || bEnded)
+        finishRender();
+}
+
+//--------------------------------------------------------------
+void ofApp::finishRender() {
+    frameWriter.close();
+    float seconds = ofGetElapsedTimef() - renderStartTime;
+    float duration = renderFrame / render.fps;
+    ofLogNotice() << "rendered " << renderFrame << " frames (" << duration << "s) in " << seconds << "s, "
+                  << ofToString(duration / max(seconds, 0.001f), 2) << "x real time, " << frameWriter.getWaitMillis() << " ms waiting for the writer";
+    if (frameWriter.getNumFailed() > 0) {
+        ofLogError() << frameWriter.getNumFailed() << " of " << frameWriter.getNumWritten() << " frames could not be written to " << frameWriter.getPath();
+        ofExit(1);
+        return;
+    }
+    ofExit();
 }
 
 //--------------------------------------------------------------
@@ -375,13 +1479,13 @@ void ofApp::drawComposite(int _x, int _y, int _width, int _height) {
     ofPushStyle();
     
     ofEnableBlendMode(OF_BLENDMODE_ADD);
-    fluidSimulation.draw(_x, _y, _width, _height);
+    fluidSimulation->draw(_x, _y, _width, _height);
     
     ofEnableBlendMode(OF_BLENDMODE_ADD);
-    if (particleFlow.isActive())
-        particleFlow.draw(_x, _y, _width, _height);
+    if (particleFlow->isActive())
+        particleFlow->draw(_x, _y, _width, _height);
     
-    if (showObstacle) {
+    if (showObstacle && obstacleImage.isAllocated()) {
         obstacleImage.draw(_x, _y, _width, _height);
     }
     
@@ -392,8 +1496,8 @@ void ofApp::drawComposite(int _x, int _y, int _width, int _height) {
 void ofApp::drawParticles(int _x, int _y, int _width, int _height) {
     ofPushStyle();
     ofEnableBlendMode(OF_BLENDMODE_ALPHA);
-    if (particleFlow.isActive())
-        particleFlow.draw(_x, _y, _width, _height);
+    if (particleFlow->isActive())
+        particleFlow->draw(_x, _y, _width, _height);
     ofPopStyle();
 }
 
@@ -402,12 +1506,11 @@ void ofApp::drawFluidFields(int _x, int _y, int _width, int _height) {
     ofPushStyle();
     
     ofEnableBlendMode(OF_BLENDMODE_ALPHA);
-    pressureField.setPressure(fluidSimulation.getPressure());
+    pressureField.setPressure(fluidSimulation->getPressure());
     pressureField.draw(_x, _y, _width, _height);
-    velocityTemperatureField.setVelocity(fluidSimulation.getVelocity());
-    velocityTemperatureField.setTemperature(fluidSimulation.getTemperature());
+    velocityTemperatureField.setVelocity(fluidSimulation->getVelocity());
+    velocityTemperatureField.setTemperature(fluidSimulation->getTemperature());
     velocityTemperatureField.draw(_x, _y, _width, _height);
-    temperatureField.setTemperature(fluidSimulation.getTemperature());
     
     ofPopStyle();
 }
@@ -416,7 +1519,7 @@ void ofApp::drawFluidFields(int _x, int _y, int _width, int _height) {
 void ofApp::drawFluidDensity(int _x, int _y, int _width, int _height) {
     ofPushStyle();
     
-    fluidSimulation.draw(_x, _y, _width, _height);
+    fluidSimulation->draw(_x, _y, _width, _height);
     
     ofPopStyle();
 }
@@ -427,12 +1530,12 @@ void ofApp::drawFluidVelocity(int _x, int _y, int _width, int _height) {
     if (showScalar.get()) {
         ofEnableBlendMode(OF_BLENDMODE_DISABLED);
         //		ofEnableBlendMode(OF_BLENDMODE_ALPHA); // altenate mode
-        displayScalar.setSource(fluidSimulation.getVelocity());
+        displayScalar.setSource(fluidSimulation->getVelocity());
         displayScalar.draw(_x, _y, _width, _height);
     }
     if (showField.get()) {
         ofEnableBlendMode(OF_BLENDMODE_ADD);
-        velocityField.setVelocity(fluidSimulation.getVelocity());
+        velocityField.setVelocity(fluidSimulation->getVelocity());
         velocityField.draw(_x, _y, _width, _height);
     }
     ofPopStyle();
@@ -444,12 +1547,12 @@ void ofApp::drawFluidPressure(int _x, int _y, int _width, int _height) {
     ofClear(128);
     if (showScalar.get()) {
         ofEnableBlendMode(OF_BLENDMODE_DISABLED);
-        displayScalar.setSource(fluidSimulation.getPressure());
+        displayScalar.setSource(fluidSimulation->getPressure());
         displayScalar.draw(_x, _y, _width, _height);
     }
     if (showField.get()) {
         ofEnableBlendMode(OF_BLENDMODE_ALPHA);
-        pressureField.setPressure(fluidSimulation.getPressure());
+        pressureField.setPressure(fluidSimulation->getPressure());
         pressureField.draw(_x, _y, _width, _height);
     }
     ofPopStyle();
@@ -460,12 +1563,12 @@ void ofApp::drawFluidTemperature(int _x, int _y, int _width, int _height) {
     ofPushStyle();
     if (showScalar.get()) {
         ofEnableBlendMode(OF_BLENDMODE_DISABLED);
-        displayScalar.setSource(fluidSimulation.getTemperature());
+        displayScalar.setSource(fluidSimulation->getTemperature());
         displayScalar.draw(_x, _y, _width, _height);
     }
     if (showField.get()) {
         ofEnableBlendMode(OF_BLENDMODE_ADD);
-        temperatureField.setTemperature(fluidSimulation.getTemperature());
+        temperatureField.setTemperature(fluidSimulation->getTemperature());
         temperatureField.draw(_x, _y, _width, _height);
     }
     ofPopStyle();
@@ -476,12 +1579,12 @@ void ofApp::drawFluidDivergence(int _x, int _y, int _width, int _height) {
     ofPushStyle();
     if (showScalar.get()) {
         ofEnableBlendMode(OF_BLENDMODE_DISABLED);
-        displayScalar.setSource(fluidSimulation.getDivergence());
+        displayScalar.setSource(fluidSimulation->getDivergence());
         displayScalar.draw(_x, _y, _width, _height);
     }
     if (showField.get()) {
         ofEnableBlendMode(OF_BLENDMODE_ADD);
-        temperatureField.setTemperature(fluidSimulation.getDivergence());
+        temperatureField.setTemperature(fluidSimulation->getDivergence());
         temperatureField.draw(_x, _y, _width, _height);
     }
     ofPopStyle();
@@ -492,13 +1595,13 @@ void ofApp::drawFluidVorticity(int _x, int _y, int _width, int _height) {
     ofPushStyle();
     if (showScalar.get()) {
         ofEnableBlendMode(OF_BLENDMODE_DISABLED);
-        displayScalar.setSource(fluidSimulation.getConfinement());
+        displayScalar.setSource(fluidSimulation->getConfinement());
         displayScalar.draw(_x, _y, _width, _height);
     }
     if (showField.get()) {
         ofEnableBlendMode(OF_BLENDMODE_ADD);
         ofSetColor(255, 255, 255, 255);
-        velocityField.setVelocity(fluidSimulation.getConfinement());
+        velocityField.setVelocity(fluidSimulation->getConfinement());
         velocityField.draw(_x, _y, _width, _height);
     }
     ofPopStyle();
@@ -509,12 +1612,12 @@ void ofApp::drawFluidBuoyance(int _x, int _y, int _width, int _height) {
     ofPushStyle();
     if (showScalar.get()) {
         ofEnableBlendMode(OF_BLENDMODE_DISABLED);
-        displayScalar.setSource(fluidSimulation.getSmokeBuoyancy());
+        displayScalar.setSource(fluidSimulation->getSmokeBuoyancy());
         displayScalar.draw(_x, _y, _width, _height);
     }
     if (showField.get()) {
         ofEnableBlendMode(OF_BLENDMODE_ADD);
-        velocityField.setVelocity(fluidSimulation.getSmokeBuoyancy());
+        velocityField.setVelocity(fluidSimulation->getSmokeBuoyancy());
         velocityField.draw(_x, _y, _width, _height);
     }
     ofPopStyle();
@@ -524,7 +1627,7 @@ void ofApp::drawFluidBuoyance(int _x, int _y, int _width, int _height) {
 void ofApp::drawFluidObstacle(int _x, int _y, int _width, int _height) {
     ofPushStyle();
     ofEnableBlendMode(OF_BLENDMODE_DISABLED);
-    fluidSimulation.getObstacle().draw(_x, _y, _width, _height);
+    fluidSimulation->getObstacle().draw(_x, _y, _width, _height);
     ofPopStyle();
 }
 
@@ -544,12 +1647,12 @@ void ofApp::drawOpticalFlow(int _x, int _y, int _width, int _height) {
     
     if (showScalar.get()) {
         ofEnableBlendMode(OF_BLENDMODE_DISABLED);
-        displayScalar.setSource(opticalFlow.getOpticalFlowDecay());
+        displayScalar.setSource(getFlowVelocity(true));
         displayScalar.draw(0, 0, _width, _height);
     }
     if (showField.get()) {
         ofEnableBlendMode(OF_BLENDMODE_ADD);
-        velocityField.setVelocity(opticalFlow.getOpticalFlowDecay());
+        velocityField.setVelocity(getFlowVelocity(true));
         velocityField.draw(0, 0, _width, _height);
     }
     ofPopStyle();
@@ -606,19 +1709,14 @@ void ofApp::drawMouseForces(int _x, int _y, int _width, int _height) {
 void ofApp::drawGui() {
     guiFPS = (int)(ofGetFrameRate() + 0.5);
     
-    // calculate minimum fps
-    deltaTimeDeque.push_back(deltaTime);
-    
-    while (deltaTimeDeque.size() > guiFPS.get())
-        deltaTimeDeque.pop_front();
-    
-    float longestTime = 0;
-    for (int i=0; i<deltaTimeDeque.size(); i++){
-        if (deltaTimeDeque[i] > longestTime)
-            longestTime = deltaTimeDeque[i];
-    }
+    // minimum fps over the profiler's rolling window
+    float longestTime = profiler.getIntervalStats().getMax();
+    guiMinFPS.set(longestTime > 0 ? 1000.0 / longestTime : 0);
     
-    guiMinFPS.set(1.0 / longestTime);
+    DepthCapture::Stats captureStats = depthCapture.getStats();
+    guiCaptureDrops.set(ofToString(captureStats.numDroppedAtSource) + " / " + ofToString(captureStats.numDroppedAtHandoff) + " / " + ofToString(captureStats.numDroppedAtRecorder)
+                        + (captureStats.bRecorderFailed ? " failed" : ""));
+    guiSimulationSteps.set(ofToString(simulationClock.getNumSteps()) + " / " + ofToString(simulationClock.getNumDropped()));
     
     
     ofPushStyle();
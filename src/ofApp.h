@@ -2,17 +2,31 @@
 
 #include "ofMain.h"
 #include "ofxGui.h"
-#include "ofxCv.h"
-#include "ofxKinect.h"
 #include "ofxFlowTools.h"
+#include "DepthSource.h"
+#include "DepthCapture.h"
+#include "StageProfiler.h"
+#include "ThreadPool.h"
+#include "FluidSimulation.h"
+#include "ParticleFlow.h"
+#include "TextureReader.h"
+#include "DirtyRegion.h"
+#include "ObstacleMap.h"
+#include "ForceSplatter.h"
+#include "RenderCache.h"
+#include "FrameWriter.h"
+#include "FieldExporter.h"
+#include "QualityGovernor.h"
+#include "SimulationClock.h"
+#include "MemoryMonitor.h"
+#include "PrecisionValidator.h"
+#include "StageGraph.h"
+#include "ProgramCache.h"
 
 
 #define USE_PROGRAMMABLE_GL					// Maybe there is a reason you would want to
-#define USE_FASTER_INTERNAL_FORMATS			// About 15% faster but gives errors from ofGLUtils
 
 
-using namespace cv;
-using namespace ofxCv;
 using namespace flowTools;
 
 enum drawModeEnum{
@@ -33,6 +47,85 @@ enum drawModeEnum{
     DRAW_MOUSE
 };
 
+enum profileStageEnum{
+    STAGE_SOURCE = 0,
+    STAGE_DEPTH_IMAGE,
+    STAGE_BAND_PASS,
+    STAGE_OBSTACLE_GRID,
+    STAGE_BLOBS,
+    STAGE_SPARSE_FLOW,
+    STAGE_DEPTH_UPLOAD,
+    STAGE_CAMERA_FBO,
+    STAGE_FLOW_REGION,
+    STAGE_OPTICAL_FLOW,
+    STAGE_FLOW_SPLAT,
+    STAGE_VELOCITY_MASK,
+    STAGE_FORCE_SPLAT,
+    STAGE_FLUID_INPUT,
+    STAGE_FLUID,
+    STAGE_PARTICLES,
+    STAGE_DRAW              // followed by one stage per draw mode
+};
+
+struct BenchmarkSettings {
+    BenchmarkSettings() : numFrames(0), warmupFrames(30), deltaTime(1.0 / 60.0), outputPath("benchmark.json") {}
+    
+    int     numFrames;      // measured frames, 0 runs the app normally
+    int     warmupFrames;   // run first and not measured, lets the driver settle and the fluid fill up
+    float   deltaTime;      // fixed time step fed to the simulation
+    string  outputPath;
+    vector<FieldPrecision> validatePrecisions; // each run after an fp32 reference and compared to it, empty only benchmarks
+};
+
+struct RenderSettings {
+    RenderSettings() : width(1920), height(1080), numFrames(0), fps(60) {}
+    
+    string  path;           // .y4m video or a folder of PNGs, empty runs the app normally
+    int     width;
+    int     height;
+    int     numFrames;      // 0 renders until the recording ends
+    float   fps;            // of the output, also the fixed simulation step
+};
+
+struct ExportSettings {
+    ExportSettings() : width(160), height(90) {}
+    
+    string  name;           // shared memory the fields are published to, empty exports nothing
+    int     width;          // of the exported fields
+    int     height;
+};
+
+struct StartupTimes {
+    StartupTimes() : window(-1), constructed(-1), setupDone(-1), holdingFrame(-1), started(-1), firstFrame(-1) {}
+    
+    // milliseconds since launch, -1 until reached
+    float   window;         // created
+    float   constructed;    // the app, flowtools compiles its shaders in its constructors
+    float   setupDone;      // setup() returned, the source may still be opening
+    float   holdingFrame;   // drawn while the source opens
+    float   started;        // source and assets ready
+    float   firstFrame;     // the first live frame drawn
+};
+
+struct StatsSettings {
+    StatsSettings() : interval(10) {}
+    
+    string  path;           // periodic dump of the rolling frame statistics, .csv appends a line, .json overwrites
+    float   interval;       // seconds
+};
+
+struct SimulationSettings {
+    SimulationSettings() : fluidBackend(FLUID_BACKEND_GPU), particleBackend(PARTICLE_BACKEND_GPU), flowMode(FLOW_MODE_DENSE), numThreads(0), maxParticles(0) {}
+    
+    fluidBackendEnum fluidBackend;
+    particleBackendEnum particleBackend;
+    flowModeEnum flowMode;      // of the optical flow
+    int     numThreads;     // for the CPU backends, 0 uses every core
+    int     maxParticles;   // CPU particles, 0 uses four per flow cell
+    string  particleExportPath; // CPU particles, live particles written as csv on exit
+    FieldPrecision precision;   // storage of the fields
+};
+
 class ofApp : public ofBaseApp {
     
 public:
@@ -40,19 +133,33 @@ public:
     void	 update();
     void	 draw();
     
-    // Kinect & ofxCv
-    ofxKinect           kinect;
-    ContourFinder       contourFinder;
+    // Depth source
+    DepthSourceSettings depthSourceSettings;   // set from the command line before setup()
+    shared_ptr<DepthSource> depthSource;
+    DepthCapture        depthCapture;          // source, recording, band pass and blobs off the render thread
+    ofTexture           depthTexture;
     ofParameterGroup    kinectParameters;
+    void                exit();
     
-    ofImage colorImg;
-    ofImage grayImage;         // grayscale depth image
-    ofImage grayThreshNear;    // the near thresholded image
-    ofImage grayThreshFar;     // the far thresholded image
-    ofImage grayPreprocImage;  // grayscale pre-processed image
-    
-    ofParameter<int> nearThreshold;
+    ofParameter<int> nearThreshold;            // millimetres
     ofParameter<int> farThreshold;
+    ofParameter<int> maskDilation;
+    ofParameter<bool> doMotionGate;            // skip depth frames where nothing moved
+    ofParameter<float> motionThreshold;
+    ofParameter<int> motionArea;               // change of the occupied area that passes a frame, in the gate's 8 pixel blocks
+    ofParameter<bool> doFlowRegion;            // run the flow and mask only around the blobs
+    ofParameter<float> flowRegionPadding;
+    ofParameter<int> flowRegionHold;           // depth frames
+    ofParameter<bool> doDepthObstacles;        // the bodies in front of the sensor block the fluid
+    ObstacleMap         obstacleMap;
+    void                updateDepthObstacle(bool _isDepthFrameNew);
+    ofParameter<float> sourceLostFade;         // seconds over which the flow input fades out while the sensor is gone
+    float               sourceInputScale;      // of the flow input, 1 while the sensor delivers
+    
+    // Depth recording
+    string              recordDepthPath;       // record from startup when set from the command line
+    ofParameter<bool>   doRecordDepth;
+    void                setRecordDepth(bool& _value);
     
     bool                didCamUpdate;
     ftFbo				cameraFbo;
@@ -60,18 +167,157 @@ public:
     
     // Time
     float				lastTime;
-    float				deltaTime;
+    float				deltaTime;             // of the display frame
+    float               lastFlowTime;
+    uint64_t            numDepthFrames;        // taken from the capture
+    SimulationClock     simulationClock;       // fixed simulation steps, decoupled from the display rate
+    ofParameterGroup    clockParameters;
+    ofParameter<float>  simulationRate;        // steps per second
+    ofParameter<int>    maxSimulationSteps;    // per display frame, the rest is dropped
+    ofParameter<string> guiSimulationSteps;
+    vector<bool>        pendingMouseForces;    // changed since the last step
+    void                addSimulationInput();
+    
+    // Pipeline
+    StageGraph          depthGraph;            // per new depth frame
+    StageGraph          stepGraph;             // per simulation step
+    float               flowDeltaTime;         // of the current depth frame
+    float               stepTime;
+    ofParameterGroup    pipelineParameters;
+    vector<ofParameter<bool> > stageToggles;   // the capture's stages, then the depth frame's, then the step's
+    void                setupPipeline();
+    void                applyStageToggles();
+    
+    // Startup
+    chrono::steady_clock::time_point launchTime;   // set from main()
+    StartupTimes        startupTimes;          // the first two set from main()
+    thread              startupLoader;         // opens the source and loads the assets
+    atomic<bool>        isStartupLoaded;
+    bool                isSourceOpened;        // set by the loader before isStartupLoaded
+    string              startupError;          // held on the holding frame instead of starting
+    bool                isStarted;
+    ofPixels            obstaclePixels;
+    bool                finishStartup();      // false if the source can't be used
+    float               getMillisSinceLaunch() const;
+    void                drawHoldingFrame();
+    
+    // Benchmark
+    BenchmarkSettings   benchmark;             // set from the command line before setup()
+    StageProfiler       profiler;
+    int                 benchmarkFrame;
+    bool                isBenchmarking() const { return benchmark.numFrames > 0; }
+    void                setupProfiler();
+    void                drawBenchmark();
+    void                finishBenchmark();
+    vector<pair<string, string> > getBenchmarkInfo();
+    PrecisionValidator  precisionValidator;
+    int                 validationRun;         // 0 is the fp32 reference, then one per precision
+    bool                isValidating() const   { return !benchmark.validatePrecisions.empty(); }
+    void                finishValidationRun();
+    ofFbo               validationFbo;
+    void                restartSimulation();
+    bool                isOffline() const      { return isBenchmarking() || isRendering(); }	// fixed steps, as fast as possible
+    float               getOfflineStep() const { return isBenchmarking() ? benchmark.deltaTime : 1.0 / render.fps; }
+    
+    // Offline render
+    RenderSettings      render;                // set from the command line before setup()
+    ofFbo               renderFbo;
+    FrameWriter         frameWriter;
+    uint64_t            renderFrame;
+    float               renderStartTime;
+    bool                isRendering() const    { return !render.path.empty(); }
+    void                setupRender();
+    void                drawRender();
+    void                finishRender();
+    
+    // Field export
+    ExportSettings      exportSettings;        // set from the command line before setup()
+    FieldExporter       fieldExporter;
+    int                 exportFramesLeft;      // to publish, the read back lags a few of them
+    void                updateExport(bool _isNew);
+    
+    // Frame statistics
+    StatsSettings       stats;                 // set from the command line before setup()
+    float               nextStatsTime;
+    ofParameter<bool>   showStats;
+    void                drawStats();
+    void                saveStats();
+    MemoryMonitor       memoryMonitor;
+    float               nextMemoryTime;
+    string              getMemoryString() const;
+    
+    // Idle
+    ofParameterGroup    idleParameters;
+    ofParameter<bool>   doIdle;                // stop simulating once the fluid has faded out
+    ofParameter<float>  idleVelocity;
+    ofParameter<float>  idleDelay;
+    ofParameter<int>    idleFrameRate;
+    ofParameter<string> guiIdleState;
+    bool                isIdle;
+    float               lastInputTime;
+    float               nextIdleCheckTime;
+    TextureReader       idleReader;
+    void                updateIdle();
+    bool                isFieldStill();
+    void                setIdle(bool _value);
+    
+    // Quality
+    ofParameterGroup    qualityParameters;
+    ofParameter<bool>   doAdaptiveQuality;     // trade quality for frame time under load
+    ofParameter<float>  frameBudget;           // milliseconds
+    ofParameter<float>  budgetPercentile;
+    ofParameter<string> guiQualityLevel;
+    QualityGovernor     qualityGovernor;
+    QualityLevel        quality;               // currently applied
+    int                 baseIterations;        // the gui's solver iterations while lowered, 0 otherwise
+    void                updateQuality();
+    void                applyQuality(const QualityLevel& _quality);
     
     // FlowTools
     int					flowWidth;
     int					flowHeight;
     int					drawWidth;
     int					drawHeight;
+    int                 fieldWidth;            // of the field visualizers
+    int                 fieldHeight;
+    void                setupFieldVisualizers();
+    
+    // Resolution
+    ofParameterGroup    resolutionParameters;
+    ofParameter<int>    targetDrawWidth;       // density and mask
+    ofParameter<int>    targetDrawHeight;
+    ofParameter<int>    flowDivisor;           // the flow grid is the draw size divided by this, at full quality
+    ofParameter<int>    fieldDivisor;          // the field visualizer grids are the flow grid divided by this
+    float               resolutionChangeTime;  // of the last gui change, negative once applied
+    void                resolutionChanged(int& _value) { resolutionChangeTime = ofGetElapsedTimef(); }
+    void                updateResolution(bool _now = false);
+    // reallocates everything sized by them, the fluid is carried over resampled
+    void                setResolution(int _drawWidth, int _drawHeight, int _flowWidth, int _flowHeight);
+    void                setupSimulation();     // the fluid, particles and splats at the current size and precision
+    FieldPrecision      getStoredPrecision(const FieldPrecision& _precision) const; // what the backends make of a precision
+    void                logPrecision() const;  // warns when the backends can't store it as asked
+    void                skipStoredPrecisions(); // drops the precisions to validate that are stored like an earlier one
+    ofFbo               resampleFbos[3];       // velocity, density and temperature while reallocating
     
     ftOpticalFlow		opticalFlow;
+    ForceSplatter       flowSplatter;          // the sparse flow's points as velocities, in place of the dense flow
+    ofParameterGroup    sparseFlowParameters;
+    ofParameter<float>  flowPointSpacing;      // pixels of the source along the contours
+    ofParameter<int>    maxFlowPoints;
+    ofParameter<int>    flowWindowRadius;      // pixels of the source
+    ofParameter<int>    flowLevels;
+    ofParameter<float>  flowPointVelocity;
+    ofParameter<float>  flowPointRadius;       // of the point spacing
+    bool                isSparseFlow() const   { return simulation.flowMode == FLOW_MODE_SPARSE; }
+    void                addFlowPoints(const DepthFrame& _frame);
+    ofTexture&          getFlowVelocity(bool _decayed);	// the dense flow or the sparse flow's splats
     ftVelocityMask		velocityMask;
-    ftFluidSimulation	fluidSimulation;
-    ftParticleFlow		particleFlow;
+    DirtyRegion         flowRegion;
+    SimulationSettings  simulation;            // set from the command line before setup()
+    ThreadPool          threadPool;
+    shared_ptr<FluidSimulation> fluidSimulation;
+    shared_ptr<ParticleFlow> particleFlow;
+    ProgramCache        programCache;          // binaries of the shaders the app compiles itself
     
     ofImage				obstacleImage;
     ofParameter<bool>   showObstacle;
@@ -79,6 +325,17 @@ public:
     // MouseDraw
     ftDrawMouseForces	mouseForces;
     
+    // Blob forces
+    ForceSplatter       forceSplatter;         // the point forces of a depth frame, one add pass per field
+    ofParameterGroup    forceParameters;
+    ofParameter<bool>   doBlobForces;          // push the fluid along with the tracked blobs
+    ofParameter<float>  blobVelocity;
+    ofParameter<float>  blobDensity;
+    ofParameter<float>  blobRadius;            // of half the blob size
+    ofParameter<int>    maxForces;             // per field, more are merged and then dropped
+    ofParameter<float>  forceMergeDistance;
+    void                addBlobForces(const DepthFrame& _frame);
+    
     // Visualisations
     ofParameterGroup	visualizeParameters;
     ftDisplayScalar		displayScalar;
@@ -108,7 +365,7 @@ public:
     ofParameter<bool>   toggleGuiDraw;
     ofParameter<float>  guiFPS;
     ofParameter<float>  guiMinFPS;
-    deque<float>        deltaTimeDeque;
+    ofParameter<string> guiCaptureDrops;
     ofParameter<bool>	doFullScreen;
     void				setFullScreen(bool& _value) { ofSetFullscreen(_value);}
     
@@ -118,6 +375,10 @@ public:
     ofParameter<int>	drawMode;
     void				drawModeSetName(int& _value) ;
     ofParameter<string> drawName;
+    void				drawByMode(int _mode);
+    RenderCache         renderCache;           // the visible visualizer mode, rendered once per step
+    bool                isCachedMode(int _mode) const;
+    void                drawCached(int _mode);
     
     void				drawComposite()			{ drawComposite(0, 0, ofGetWindowWidth(), ofGetWindowHeight()); }
     void				drawComposite(int _x, int _y, int _width, int _height);